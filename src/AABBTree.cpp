@@ -0,0 +1,331 @@
+#include "AABBTree.h"
+#include <cfloat>
+
+//
+// helpers
+//
+
+bool AABBTree::IsBounded(const glm::vec3& a_min, const glm::vec3& a_max)
+{
+	return (-FLT_MAX < a_min.x && -FLT_MAX < a_min.y && -FLT_MAX < a_min.z &&
+			FLT_MAX > a_max.x && FLT_MAX > a_max.y && FLT_MAX > a_max.z);
+}
+
+// surface area, used as the cost of a node when choosing where to insert
+float AABBTree::Area(const glm::vec3& a_min, const glm::vec3& a_max)
+{
+	glm::vec3 size = a_max - a_min;
+	return (size.x*size.y + size.y*size.z + size.z*size.x) * 2;
+}
+
+bool AABBTree::SlabTest(const glm::vec3& a_origin, const glm::vec3& a_inverseDirection,
+						const glm::vec3& a_min, const glm::vec3& a_max, float a_maxDistance)
+{
+	float tMin = 0, tMax = a_maxDistance;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		// ray parallel to the slab only hits if it starts between the planes
+		if (FLT_MAX < fabs(a_inverseDirection[i]))
+		{
+			if (a_origin[i] < a_min[i] || a_origin[i] > a_max[i])
+				return false;
+			continue;
+		}
+		float t1 = (a_min[i] - a_origin[i]) * a_inverseDirection[i];
+		float t2 = (a_max[i] - a_origin[i]) * a_inverseDirection[i];
+		tMin = fmax(tMin, fmin(t1, t2));
+		tMax = fmin(tMax, fmax(t1, t2));
+		if (tMin > tMax)
+			return false;
+	}
+	return true;
+}
+
+//
+// node pool
+//
+
+int AABBTree::AllocateNode()
+{
+	if (NULL_NODE == m_freeList)
+	{
+		m_nodes.push_back(Node());
+		m_freeList = m_nodes.size() - 1;
+		m_nodes[m_freeList].parent = NULL_NODE;
+	}
+	int index = m_freeList;
+	Node& node = m_nodes[index];
+	m_freeList = node.parent;
+	node.parent = node.child1 = node.child2 = NULL_NODE;
+	node.height = 0;
+	node.actor = nullptr;
+	return index;
+}
+
+void AABBTree::FreeNode(int a_node)
+{
+	m_nodes[a_node].parent = m_freeList;
+	m_nodes[a_node].height = -1;
+	m_freeList = a_node;
+}
+
+//
+// proxies
+//
+
+int AABBTree::CreateProxy(Actor* a_actor, const glm::vec3& a_min, const glm::vec3& a_max)
+{
+	int proxy = AllocateNode();
+	Node& node = m_nodes[proxy];
+	node.actor = a_actor;
+	node.min = a_min;
+	node.max = a_max;
+	if (!IsBounded(a_min, a_max))
+	{
+		node.height = -2;
+		m_unbounded.push_back(proxy);
+		return proxy;
+	}
+	node.min -= glm::vec3(m_margin);
+	node.max += glm::vec3(m_margin);
+	InsertLeaf(proxy);
+	return proxy;
+}
+
+void AABBTree::DestroyProxy(int a_proxy)
+{
+	if (0 > a_proxy || m_nodes.size() <= (unsigned int)a_proxy)
+		return;
+	if (-2 == m_nodes[a_proxy].height)
+	{
+		for (unsigned int i = 0; i < m_unbounded.size(); ++i)
+		{
+			if (a_proxy == m_unbounded[i])
+			{
+				m_unbounded[i] = m_unbounded.back();
+				m_unbounded.pop_back();
+				break;
+			}
+		}
+	}
+	else
+	{
+		RemoveLeaf(a_proxy);
+	}
+	FreeNode(a_proxy);
+}
+
+void AABBTree::Clear()
+{
+	m_nodes.clear();
+	m_unbounded.clear();
+	m_root = m_freeList = NULL_NODE;
+}
+
+bool AABBTree::MoveProxy(int a_proxy, const glm::vec3& a_min, const glm::vec3& a_max,
+						 const glm::vec3& a_displacement)
+{
+	Node& node = m_nodes[a_proxy];
+	if (-2 == node.height)
+	{
+		node.min = a_min;
+		node.max = a_max;
+		return false;
+	}
+	if (node.min.x <= a_min.x && node.min.y <= a_min.y && node.min.z <= a_min.z &&
+		node.max.x >= a_max.x && node.max.y >= a_max.y && node.max.z >= a_max.z)
+		return false;
+
+	// reinsert with a margin all round, plus extra room in the direction of motion
+	RemoveLeaf(a_proxy);
+	glm::vec3 displacement = a_displacement * m_displacementMultiplier;
+	node.min = a_min - glm::vec3(m_margin);
+	node.max = a_max + glm::vec3(m_margin);
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (0 > displacement[i])
+			node.min[i] += displacement[i];
+		else
+			node.max[i] += displacement[i];
+	}
+	InsertLeaf(a_proxy);
+	return true;
+}
+
+//
+// tree maintenance
+//
+
+void AABBTree::InsertLeaf(int a_leaf)
+{
+	if (NULL_NODE == m_root)
+	{
+		m_root = a_leaf;
+		m_nodes[a_leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// walk down the tree, choosing the child that would grow the least
+	glm::vec3 leafMin = m_nodes[a_leaf].min;
+	glm::vec3 leafMax = m_nodes[a_leaf].max;
+	int index = m_root;
+	while (!m_nodes[index].IsLeaf())
+	{
+		const Node& node = m_nodes[index];
+		float area = Area(node.min, node.max);
+		float combinedArea = Area(glm::min(node.min, leafMin), glm::max(node.max, leafMax));
+
+		// cost of pairing the leaf with this node, and the cost pushed down to children
+		float cost = 2 * combinedArea;
+		float inheritanceCost = 2 * (combinedArea - area);
+		float childCosts[2];
+		int children[2] = { node.child1, node.child2 };
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			const Node& child = m_nodes[children[i]];
+			float grownArea = Area(glm::min(child.min, leafMin), glm::max(child.max, leafMax));
+			childCosts[i] = inheritanceCost +
+				(child.IsLeaf() ? grownArea : grownArea - Area(child.min, child.max));
+		}
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+		index = (childCosts[0] < childCosts[1] ? children[0] : children[1]);
+	}
+
+	// make a new parent for the leaf and its chosen sibling
+	int sibling = index;
+	int oldParent = m_nodes[sibling].parent;
+	int newParent = AllocateNode();
+	Node& parent = m_nodes[newParent];
+	parent.parent = oldParent;
+	parent.min = glm::min(m_nodes[sibling].min, leafMin);
+	parent.max = glm::max(m_nodes[sibling].max, leafMax);
+	parent.height = m_nodes[sibling].height + 1;
+	parent.child1 = sibling;
+	parent.child2 = a_leaf;
+	if (NULL_NODE != oldParent)
+	{
+		if (m_nodes[oldParent].child1 == sibling)
+			m_nodes[oldParent].child1 = newParent;
+		else
+			m_nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		m_root = newParent;
+	}
+	m_nodes[sibling].parent = newParent;
+	m_nodes[a_leaf].parent = newParent;
+
+	Refit(m_nodes[a_leaf].parent);
+}
+
+void AABBTree::RemoveLeaf(int a_leaf)
+{
+	if (a_leaf == m_root)
+	{
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// replace the leaf's parent with the leaf's sibling
+	int parent = m_nodes[a_leaf].parent;
+	int grandParent = m_nodes[parent].parent;
+	int sibling = (m_nodes[parent].child1 == a_leaf ? m_nodes[parent].child2 : m_nodes[parent].child1);
+	if (NULL_NODE != grandParent)
+	{
+		if (m_nodes[grandParent].child1 == parent)
+			m_nodes[grandParent].child1 = sibling;
+		else
+			m_nodes[grandParent].child2 = sibling;
+		m_nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		Refit(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	}
+}
+
+// rebalance and recompute bounds from the given node up to the root
+void AABBTree::Refit(int a_node)
+{
+	int index = a_node;
+	while (NULL_NODE != index)
+	{
+		index = Balance(index);
+		Node& node = m_nodes[index];
+		const Node& child1 = m_nodes[node.child1];
+		const Node& child2 = m_nodes[node.child2];
+		node.height = 1 + glm::max(child1.height, child2.height);
+		node.min = glm::min(child1.min, child2.min);
+		node.max = glm::max(child1.max, child2.max);
+		index = node.parent;
+	}
+}
+
+// if one child of the node is more than one level taller than the other,
+// rotate the taller child up to take the node's place and return its index
+int AABBTree::Balance(int a_node)
+{
+	Node& a = m_nodes[a_node];
+	if (a.IsLeaf() || 2 > a.height)
+		return a_node;
+
+	int indexB = a.child1;
+	int indexC = a.child2;
+	int balance = m_nodes[indexC].height - m_nodes[indexB].height;
+	if (-1 <= balance && balance <= 1)
+		return a_node;
+
+	// the taller child moves up, and the node takes the taller grandchild's sibling
+	bool rotateC = (1 < balance);
+	int indexUp = (rotateC ? indexC : indexB);
+	int indexStay = (rotateC ? indexB : indexC);
+	Node& up = m_nodes[indexUp];
+	int indexTall = up.child1;
+	int indexShort = up.child2;
+	if (m_nodes[indexTall].height < m_nodes[indexShort].height)
+	{
+		indexTall = up.child2;
+		indexShort = up.child1;
+	}
+
+	// swap the node and the child moving up
+	up.child1 = a_node;
+	up.parent = a.parent;
+	a.parent = indexUp;
+	if (NULL_NODE != up.parent)
+	{
+		if (m_nodes[up.parent].child1 == a_node)
+			m_nodes[up.parent].child1 = indexUp;
+		else
+			m_nodes[up.parent].child2 = indexUp;
+	}
+	else
+	{
+		m_root = indexUp;
+	}
+
+	// the taller grandchild stays with the child moving up, the shorter one moves to the node
+	up.child2 = indexTall;
+	if (rotateC)
+		a.child2 = indexShort;
+	else
+		a.child1 = indexShort;
+	m_nodes[indexShort].parent = a_node;
+
+	const Node& stay = m_nodes[indexStay];
+	const Node& shorter = m_nodes[indexShort];
+	const Node& taller = m_nodes[indexTall];
+	a.min = glm::min(stay.min, shorter.min);
+	a.max = glm::max(stay.max, shorter.max);
+	a.height = 1 + glm::max(stay.height, shorter.height);
+	up.min = glm::min(a.min, taller.min);
+	up.max = glm::max(a.max, taller.max);
+	up.height = 1 + glm::max(a.height, taller.height);
+	return indexUp;
+}
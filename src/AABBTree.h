@@ -0,0 +1,159 @@
+#ifndef _AABB_TREE_H_
+#define _AABB_TREE_H_
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+#include <vector>
+
+class Actor;
+
+// Dynamic bounding volume hierarchy of axis-aligned boxes.  Leaves hold
+// slightly enlarged ("fat") boxes, so small movements don't require the tree
+// to be touched at all, and the tree is kept height-balanced with rotations
+// so queries stay O(log n).  Unbounded proxies (infinite planes) are kept in
+// a separate list and reported by every query.
+class AABBTree
+{
+public:
+
+	static const int NULL_NODE = -1;
+
+	AABBTree(float a_margin = 0.1f, float a_displacementMultiplier = 2.0f)
+		: m_root(NULL_NODE), m_freeList(NULL_NODE), m_margin(a_margin),
+		  m_displacementMultiplier(a_displacementMultiplier) {}
+
+	int CreateProxy(Actor* a_actor, const glm::vec3& a_min, const glm::vec3& a_max);
+	void DestroyProxy(int a_proxy);
+	void Clear();
+
+	// returns false if the proxy's fat box still holds the new bounds
+	bool MoveProxy(int a_proxy, const glm::vec3& a_min, const glm::vec3& a_max,
+				   const glm::vec3& a_displacement = glm::vec3(0));
+
+	Actor* GetActor(int a_proxy) const { return m_nodes[a_proxy].actor; }
+	const glm::vec3& GetFatMin(int a_proxy) const { return m_nodes[a_proxy].min; }
+	const glm::vec3& GetFatMax(int a_proxy) const { return m_nodes[a_proxy].max; }
+	int GetHeight() const { return NULL_NODE == m_root ? 0 : m_nodes[m_root].height; }
+
+	// calls a_callback(proxy) for each leaf whose box overlaps the given box;
+	// traversal stops if the callback returns false
+	template <typename Callback>
+	void Query(const glm::vec3& a_min, const glm::vec3& a_max, Callback a_callback) const;
+
+	// calls a_callback(proxy, maxDistance) for each leaf whose box, grown by
+	// a_radius, is hit by the ray before the current maximum distance.  The
+	// callback returns the new maximum distance: zero stops the traversal and
+	// the distance to a hit clips the rest of the search to nearer leaves.
+	template <typename Callback>
+	void Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+				 float a_maxDistance, float a_radius, Callback a_callback) const;
+
+private:
+
+	struct Node
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		Actor* actor;
+		int parent;	// doubles as the next link in the free list
+		int child1;
+		int child2;
+		int height;	// leaf = 0, free = -1, unbounded = -2
+
+		bool IsLeaf() const { return NULL_NODE == child1; }
+	};
+
+	static bool IsBounded(const glm::vec3& a_min, const glm::vec3& a_max);
+	static float Area(const glm::vec3& a_min, const glm::vec3& a_max);
+	static bool SlabTest(const glm::vec3& a_origin, const glm::vec3& a_inverseDirection,
+						 const glm::vec3& a_min, const glm::vec3& a_max, float a_maxDistance);
+
+	int AllocateNode();
+	void FreeNode(int a_node);
+	void InsertLeaf(int a_leaf);
+	void RemoveLeaf(int a_leaf);
+	int Balance(int a_node);
+	void Refit(int a_node);
+
+	std::vector<Node> m_nodes;
+	std::vector<int> m_unbounded;
+	mutable std::vector<int> m_stack;
+	int m_root;
+	int m_freeList;
+	float m_margin;
+	float m_displacementMultiplier;
+};
+
+template <typename Callback>
+void AABBTree::Query(const glm::vec3& a_min, const glm::vec3& a_max, Callback a_callback) const
+{
+	for (auto proxy : m_unbounded)
+	{
+		if (!a_callback(proxy))
+			return;
+	}
+	if (NULL_NODE == m_root)
+		return;
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while (!m_stack.empty())
+	{
+		int index = m_stack.back();
+		m_stack.pop_back();
+		const Node& node = m_nodes[index];
+		if (node.min.x > a_max.x || a_min.x > node.max.x ||
+			node.min.y > a_max.y || a_min.y > node.max.y ||
+			node.min.z > a_max.z || a_min.z > node.max.z)
+			continue;
+		if (node.IsLeaf())
+		{
+			if (!a_callback(index))
+				return;
+		}
+		else
+		{
+			m_stack.push_back(node.child1);
+			m_stack.push_back(node.child2);
+		}
+	}
+}
+
+template <typename Callback>
+void AABBTree::Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+					   float a_maxDistance, float a_radius, Callback a_callback) const
+{
+	float maxDistance = a_maxDistance;
+	for (auto proxy : m_unbounded)
+	{
+		maxDistance = a_callback(proxy, maxDistance);
+		if (0 >= maxDistance)
+			return;
+	}
+	if (NULL_NODE == m_root)
+		return;
+	glm::vec3 inverseDirection(1.0f / a_direction.x, 1.0f / a_direction.y, 1.0f / a_direction.z);
+	glm::vec3 grow(a_radius);
+	m_stack.clear();
+	m_stack.push_back(m_root);
+	while (!m_stack.empty())
+	{
+		int index = m_stack.back();
+		m_stack.pop_back();
+		const Node& node = m_nodes[index];
+		if (!SlabTest(a_origin, inverseDirection, node.min - grow, node.max + grow, maxDistance))
+			continue;
+		if (node.IsLeaf())
+		{
+			maxDistance = a_callback(index, maxDistance);
+			if (0 >= maxDistance)
+				return;
+		}
+		else
+		{
+			m_stack.push_back(node.child1);
+			m_stack.push_back(node.child2);
+		}
+	}
+}
+
+#endif	// _AABB_TREE_H_
@@ -1,56 +1,299 @@
 #include "Actor.h"
 
+// how far below the bottom of a sphere the face supporting it is looked for
+static const float SUPPORT_DEPTH = 0.01f;
+// speed away from its support that a sphere is knocked off it at
+static const float SUPPORT_LIFT_SPEED = 0.1f;
+
+//
+// Store
+//
+
+void Actor::Store::Append(const Store& a_store, unsigned int a_index)
+{
+	geometries.push_back(a_store.geometries[a_index]);
+	velocities.push_back(a_store.velocities[a_index]);
+	angularVelocities.push_back(a_store.angularVelocities[a_index]);
+	forces.push_back(a_store.forces[a_index]);
+	torques.push_back(a_store.torques[a_index]);
+	massProperties.push_back(a_store.massProperties[a_index]);
+	worldInverseInertias.push_back(a_store.worldInverseInertias[a_index]);
+	supports.push_back(a_store.supports[a_index]);
+	activities.push_back(a_store.activities[a_index]);
+	materials.push_back(a_store.materials[a_index]);
+	appearances.push_back(a_store.appearances[a_index]);
+}
+void Actor::Store::Remove(unsigned int a_index)
+{
+	unsigned int last = size() - 1;
+	if (a_index != last)
+	{
+		geometries[a_index] = geometries[last];
+		velocities[a_index] = velocities[last];
+		angularVelocities[a_index] = angularVelocities[last];
+		forces[a_index] = forces[last];
+		torques[a_index] = torques[last];
+		massProperties[a_index] = massProperties[last];
+		worldInverseInertias[a_index] = worldInverseInertias[last];
+		supports[a_index] = supports[last];
+		activities[a_index] = activities[last];
+		materials[a_index] = materials[last];
+		appearances[a_index] = appearances[last];
+	}
+	geometries.pop_back();
+	velocities.pop_back();
+	angularVelocities.pop_back();
+	forces.pop_back();
+	torques.pop_back();
+	massProperties.pop_back();
+	worldInverseInertias.pop_back();
+	supports.pop_back();
+	activities.pop_back();
+	materials.pop_back();
+	appearances.pop_back();
+}
+void Actor::Store::clear()
+{
+	geometries.clear();
+	velocities.clear();
+	angularVelocities.clear();
+	forces.clear();
+	torques.clear();
+	massProperties.clear();
+	worldInverseInertias.clear();
+	supports.clear();
+	activities.clear();
+	materials.clear();
+	appearances.clear();
+}
+
+//
+// Actor
+//
+
+void Actor::Init(const Geometry& a_geometry, const Mesh& a_mesh, bool a_dynamic, const Material& a_material,
+				 const Texture& a_texture, const glm::vec3& a_velocity, const glm::vec3& a_angularVelocity,
+				 float a_minSpeed, float a_minAngularSpeed)
+{
+	Support support = { nullptr, glm::vec3(0), 0 };
+	Activity activity = { a_dynamic, a_dynamic, 0, a_minSpeed * a_minSpeed, a_minAngularSpeed * a_minAngularSpeed };
+	Appearance appearance = { a_mesh, a_texture, glm::vec4(1), a_geometry.position, a_geometry.orientation() };
+	m_ownStore.geometries.push_back(Geometry::Variant(a_geometry));
+	m_ownStore.velocities.push_back(a_velocity);
+	m_ownStore.angularVelocities.push_back(a_angularVelocity);
+	m_ownStore.forces.push_back(glm::vec3(0));
+	m_ownStore.torques.push_back(glm::vec3(0));
+	m_ownStore.massProperties.push_back(MassProperties());
+	m_ownStore.worldInverseInertias.push_back(glm::mat3(0));
+	m_ownStore.supports.push_back(support);
+	m_ownStore.activities.push_back(activity);
+	m_ownStore.materials.push_back(a_material);
+	m_ownStore.appearances.push_back(appearance);
+	UpdateMassProperties();
+}
+
+void Actor::SetStore(Store* a_store)
+{
+	Store* store = (nullptr != a_store ? a_store : &m_ownStore);
+	if (store == m_store)
+		return;
+	store->Append(*m_store, m_index);
+	if (&m_ownStore == m_store)
+		m_ownStore.clear();
+	m_store = store;
+	m_index = store->size() - 1;
+}
+
 void Actor::Update(double a_deltaTime, const glm::vec3& a_gravity)
 {
-	if (nullptr != m_geometry)
+	if (!geometry().IsEmpty())
 	{
+		// spheres on a support roll along it until they leave it
+		if (activity().dynamic && nullptr != support().actor && Roll(a_deltaTime, a_gravity))
+		{
+			UpdateWorldInertia();
+			return;
+		}
+
 		// static movement
-		Spin(m_angularVelocity * a_deltaTime);
-		Move(m_velocity * a_deltaTime);
+		Spin(angularVelocity() * a_deltaTime);
+		Move(velocity() * a_deltaTime);
 
-		if (m_dynamic)
+		if (activity().dynamic)
 		{
 			// linear force
-			glm::vec3 force = m_force + a_gravity;
-			if (0 < m_material.linearDrag)
-				force -= GetVelocity() * m_material.linearDrag;
+			glm::vec3 netForce = force() + a_gravity;
+			if (0 < material().linearDrag)
+				netForce -= GetVelocity() * material().linearDrag;
 
 			// linear acceleration
 			float m = GetMass();
-			if (glm::vec3(0) != force && 0 != m)
+			if (glm::vec3(0) != netForce && 0 != m)
 			{
-				glm::vec3 deltaV = (force / m) * a_deltaTime;
+				glm::vec3 deltaV = (netForce / m) * a_deltaTime;
 				Move(0.5f * deltaV * a_deltaTime);
 				Accelerate(deltaV);
 			}
 
-			// angular force
-			glm::vec3 torque = m_torque;
-			if (0 < m_material.rotationalDrag)
-			{
-				torque -= GetAngularVelocity() * m_material.rotationalDrag;
-			}
-
-			// angular acceleration
-			float i = GetRotationalInertia(torque);
-			if (0 != i)
-			{
-				glm::vec3 deltaAV = torque * a_deltaTime / i;
-				Spin(0.5f * deltaAV * a_deltaTime);
-				AccelerateRotation(deltaAV);
-			}
-
+			IntegrateRotation(a_deltaTime);
 			EnforceMinSpeed();
 		}
+		UpdateWorldInertia();
+	}
+}
+
+void Actor::IntegrateRotation(double a_deltaTime)
+{
+	// angular force
+	glm::vec3 netTorque = torque();
+	if (0 < material().rotationalDrag)
+	{
+		netTorque -= GetAngularVelocity() * material().rotationalDrag;
+	}
+
+	// angular acceleration
+	float i = GetRotationalInertia(netTorque);
+	if (0 != i)
+	{
+		glm::vec3 deltaAV = netTorque * a_deltaTime / i;
+		Spin(0.5f * deltaAV * a_deltaTime);
+		AccelerateRotation(deltaAV);
+	}
+}
+
+bool Actor::SetSupport(const Actor* a_support, const glm::vec3& a_normal)
+{
+	if (!activity().dynamic || Geometry::SPHERE != geometry()->GetShape() || nullptr == a_support ||
+		a_support->IsDynamic() || (Geometry::BOX != a_support->GetGeometry().GetShape() &&
+								   Geometry::PLANE != a_support->GetGeometry().GetShape()))
+		return false;
+	float radius = static_cast<const Geometry::Sphere&>(*geometry()).radius;
+	support().actor = a_support;
+	support().normal = a_normal;
+	support().height = glm::dot(a_normal, a_support->GetGeometry().ClosestSurfacePointTo(
+										  GetPosition() - a_normal * radius));
+	if (!IsOverSupport())
+	{
+		support().actor = nullptr;
+		return false;
+	}
+	return true;
+}
+
+// planes go on forever, but the sphere has to be over a box's face
+bool Actor::IsOverSupport() const
+{
+	const Geometry& geometry = support().actor->GetGeometry();
+	if (Geometry::PLANE == geometry.GetShape())
+		return true;
+	return geometry.Contains(GetPosition() - support().normal *
+							 (glm::dot(support().normal, GetPosition()) - support().height + SUPPORT_DEPTH));
+}
+
+// The sphere is held on the face, so only its motion along it is integrated.
+// What presses it onto the face is the load friction and rolling resistance
+// work against, and both are applied as impulses worked out for the whole
+// step.
+bool Actor::Roll(double a_deltaTime, const glm::vec3& a_gravity)
+{
+	const glm::vec3& n = support().normal;
+	glm::vec3 netForce = force() + a_gravity;
+	if (0 < material().linearDrag)
+		netForce -= GetVelocity() * material().linearDrag;
+	float load = -glm::dot(netForce, n);
+	if (0 > load || SUPPORT_LIFT_SPEED < glm::dot(velocity(), n) || !IsOverSupport())
+	{
+		support().actor = nullptr;
+		return false;
+	}
+
+	// move along the face, and keep the sphere on it
+	float radius = static_cast<const Geometry::Sphere&>(*geometry()).radius;
+	Accelerate(-n * glm::dot(velocity(), n));
+	Spin(angularVelocity() * a_deltaTime);
+	Move(velocity() * a_deltaTime);
+	float m = GetMass();
+	if (0 != m)
+	{
+		glm::vec3 deltaV = ((netForce + n * load) / m) * a_deltaTime;
+		Move(0.5f * deltaV * a_deltaTime);
+		Accelerate(deltaV);
+	}
+	Move(n * (support().height + radius - glm::dot(n, GetPosition())));
+	IntegrateRotation(a_deltaTime);
+
+	const Material& surface = support().actor->GetMaterial();
+	RollOnFace(velocity(), angularVelocity(), n, radius, m, GetInertiaTensor(), worldInverseInertia(),
+			   (material().dynamicFriction + surface.dynamicFriction) / 2,
+			   (material().rollingResistance + surface.rollingResistance) / 2,
+			   load * (float)a_deltaTime);
+	EnforceMinSpeed();
+	return true;
+}
+
+// Friction at the contact point takes out as much of the sliding as the
+// load allows, and once the sphere rolls without sliding, rolling
+// resistance slows it down as a whole - along with any spin about the
+// normal, which friction at a single point can't touch.
+void Actor::RollOnFace(glm::vec3& a_velocity, glm::vec3& a_angularVelocity,
+					   const glm::vec3& a_normal, float a_radius, float a_mass,
+					   const glm::mat3& a_inertiaTensor, const glm::mat3& a_inverseInertia,
+					   float a_friction, float a_resistance, float a_loadImpulse)
+{
+	const glm::vec3& n = a_normal;
+	float inverseMass = (0 != a_mass ? 1.0f / a_mass : 0);
+	glm::vec3 r = -n * a_radius;
+	glm::vec3 slip = a_velocity + glm::cross(a_angularVelocity, r);
+	float slipSpeed = Geometry::Length(slip);
+	bool rolling = true;
+	if (0 < slipSpeed)
+	{
+		glm::vec3 t = slip / slipSpeed;
+		float denominator = inverseMass + glm::dot(t, glm::cross(a_inverseInertia * glm::cross(r, t), r));
+		float maxImpulse = a_friction * a_loadImpulse;
+		float impulse = (0 != denominator ? slipSpeed / denominator : 0);
+		rolling = (impulse <= maxImpulse);
+		glm::vec3 J = -t * fmin(impulse, maxImpulse);
+		a_velocity += J * inverseMass;
+		a_angularVelocity += a_inverseInertia * glm::cross(r, J);
+	}
+	if (0 >= a_resistance)
+		return;
+
+	float spin = glm::dot(a_angularVelocity, n);
+	float spinInertia = glm::dot(n, a_inertiaTensor * n);
+	if (0 != spin && 0 < spinInertia)
+	{
+		float deltaSpin = a_resistance * a_loadImpulse * a_radius / spinInertia;
+		a_angularVelocity -= n * (0 < spin ? fmin(spin, deltaSpin) : fmax(spin, -deltaSpin));
+	}
+	float speed = Geometry::Length(a_velocity);
+	if (rolling && 0 < speed)
+	{
+		glm::vec3 axis = Geometry::Normalize(glm::cross(n, a_velocity));
+		float rollingMass = a_mass + glm::dot(axis, a_inertiaTensor * axis) / (a_radius * a_radius);
+		float newSpeed = fmax(0.0f, speed - a_resistance * a_loadImpulse / rollingMass);
+		a_velocity *= newSpeed / speed;
+		a_angularVelocity = n * glm::dot(a_angularVelocity, n) + glm::cross(n, a_velocity) / a_radius;
 	}
 }
 
 void Actor::ResolveCollision(Actor* a_actor1, Actor* a_actor2)
 {
 	Geometry::Collision collision;
+	collision.separatingAxis = glm::vec3(0);
 	if (nullptr != a_actor1 && nullptr != a_actor2 && a_actor1 != a_actor2 &&
 		(a_actor1->IsDynamic() || a_actor2->IsDynamic()) &&
 		Geometry::DetectCollision(a_actor1->GetGeometry(), a_actor2->GetGeometry(), &collision))
+		ResolveCollision(a_actor1, a_actor2, collision);
+}
+
+void Actor::ResolveCollision(Actor* a_actor1, Actor* a_actor2,
+							 const Geometry::Collision& a_collision)
+{
+	Geometry::Collision collision = a_collision;
+	if (nullptr != a_actor1 && nullptr != a_actor2 && a_actor1 != a_actor2 &&
+		(a_actor1->IsDynamic() || a_actor2->IsDynamic()))
 	{
 		// resolve interpenetration
 		if (a_actor1->IsDynamic() && a_actor2->IsDynamic())
@@ -70,15 +313,15 @@ void Actor::ResolveCollision(Actor* a_actor1, Actor* a_actor2)
 		}
 
 		// (in)elastic collision
-		float e = 1.0f + fmin(a_actor1->m_material.elasticity, a_actor2->m_material.elasticity);
+		float e = 1.0f + fmin(a_actor1->material().elasticity, a_actor2->material().elasticity);
 		glm::vec3 n = collision.normal;
 		glm::vec3 Vr = a_actor2->GetVelocity() - a_actor1->GetVelocity();
-		float invM = (a_actor1->IsDynamic() ? 1.0f / a_actor1->GetMass() : 0) +
-					 (a_actor2->IsDynamic() ? 1.0f / a_actor2->GetMass() : 0);
+		float invM = (a_actor1->IsDynamic() ? a_actor1->GetInverseMass() : 0) +
+					 (a_actor2->IsDynamic() ? a_actor2->GetInverseMass() : 0);
 		glm::vec3 r1 = collision.point - a_actor1->GetPosition();
 		glm::vec3 r2 = collision.point - a_actor2->GetPosition();
-		glm::mat3 invI1 = (a_actor1->IsDynamic() ? glm::inverse(a_actor1->GetInertiaTensor()) : glm::mat3(0));
-		glm::mat3 invI2 = (a_actor2->IsDynamic() ? glm::inverse(a_actor2->GetInertiaTensor()) : glm::mat3(0));
+		glm::mat3 invI1 = (a_actor1->IsDynamic() ? a_actor1->GetInverseInertia() : glm::mat3(0));
+		glm::mat3 invI2 = (a_actor2->IsDynamic() ? a_actor2->GetInverseInertia() : glm::mat3(0));
 		glm::vec3 J = -e * n * glm::dot(Vr, n) /
 					  (invM + glm::dot(n, glm::cross(invI1 * glm::cross(r1, n), r1)) +
 							  glm::dot(n, glm::cross(invI2 * glm::cross(r2, n), r2)));
@@ -95,16 +338,16 @@ void Actor::ResolveCollision(Actor* a_actor1, Actor* a_actor2)
 		Vs -= n * glm::dot(n, Vs);
 		if (glm::vec3(0) == Vs)
 			return;
-		glm::vec3 t = glm::normalize(Vs);
-		float us = (a_actor1->m_material.staticFriction + a_actor2->m_material.staticFriction) / 2;
-		float ud = (a_actor1->m_material.dynamicFriction + a_actor2->m_material.dynamicFriction) / 2;
+		glm::vec3 t = Geometry::Normalize(Vs);
+		float us = (a_actor1->material().staticFriction + a_actor2->material().staticFriction) / 2;
+		float ud = (a_actor1->material().dynamicFriction + a_actor2->material().dynamicFriction) / 2;
 		float denominator = invM + glm::dot(t, glm::cross(invI1 * glm::cross(r1, t), r1)) +
 								   glm::dot(t, glm::cross(invI2 * glm::cross(r2, t), r2));
 		if (0 == denominator)
 			return;
 		glm::vec3 Jtan = -Vs / denominator;
 		if (glm::length2(Jtan) > glm::length2(J * us))
-			Jtan = -Vs * ud * glm::length(J);
+			Jtan = -Vs * ud * Geometry::Length(J);
 		if (a_actor1->IsDynamic())
 			a_actor1->ApplyImpulse(Jtan, collision.point);
 		if (a_actor2->IsDynamic())
@@ -112,13 +355,89 @@ void Actor::ResolveCollision(Actor* a_actor1, Actor* a_actor2)
 	}
 }
 
+Actor::Motion Actor::GetMotion(const glm::vec3& a_gravity) const
+{
+	// the same forces as Update, with what it would skip zeroed so that
+	// applying them changes nothing
+	Motion motion;
+	motion.force = force() + a_gravity;
+	motion.mass = GetMass();
+	motion.linearDrag = (0 < material().linearDrag ? material().linearDrag : 0);
+	if (0 == motion.mass)
+	{
+		motion.force = glm::vec3(0);
+		motion.mass = 1;
+		motion.linearDrag = 0;
+	}
+	motion.torque = torque();
+	if (0 < material().rotationalDrag)
+		motion.torque -= GetAngularVelocity() * material().rotationalDrag;
+	motion.rotationalInertia = GetRotationalInertia(motion.torque);
+	if (0 == motion.rotationalInertia)
+	{
+		motion.torque = glm::vec3(0);
+		motion.rotationalInertia = 1;
+	}
+	return motion;
+}
+
+void Actor::SetMotion(const glm::vec3& a_position, const glm::quat& a_orientation,
+					  const glm::vec3& a_velocity, const glm::vec3& a_angularVelocity)
+{
+	geometry()->position = a_position;
+	velocity() = a_velocity;
+	angularVelocity() = a_angularVelocity;
+	if (a_orientation != geometry()->orientation())
+	{
+		geometry()->orientation(a_orientation);
+		UpdateWorldInertia();
+	}
+}
+
 glm::vec3 Actor::GetPointVelocity(const glm::vec3& a_point, bool a_ignoreOutside) const
 {
-	if (a_ignoreOutside && !m_geometry->Contains(a_point))
+	if (a_ignoreOutside && !geometry().Contains(a_point))
 		return glm::vec3(0);
-	if (a_point == GetPosition() || glm::vec3(0) == m_angularVelocity)
-		return m_velocity;
-	return m_velocity + glm::cross(m_angularVelocity, a_point - GetPosition());
+	if (a_point == GetPosition() || glm::vec3(0) == angularVelocity())
+		return velocity();
+	return velocity() + glm::cross(angularVelocity(), a_point - GetPosition());
+}
+void Actor::UpdateMassProperties()
+{
+	MassProperties& properties = massProperties();
+	properties.mass = (0 != m_mass ? m_mass : material().density * geometry()->volume());
+	properties.inverseMass = (0 != properties.mass ? 1.0f / properties.mass : 0);
+	properties.inertiaTensor = (glm::mat3(0) != m_inertiaTensor ? m_inertiaTensor :
+								geometry()->interiaTensorDividedByMass() * properties.mass);
+	properties.inverseInertia = (0 != glm::determinant(properties.inertiaTensor) ?
+								 glm::inverse(properties.inertiaTensor) : glm::mat3(0));
+	const glm::mat3& inverse = properties.inverseInertia;
+	properties.isotropic = (glm::mat3(inverse[0][0]) == inverse);
+	UpdateWorldInertia();
+}
+
+void Actor::UpdateWorldInertia()
+{
+	if (massProperties().isotropic)
+	{
+		worldInverseInertia() = massProperties().inverseInertia;
+		return;
+	}
+	const glm::mat3& rotation = geometry()->rotationMatrix();
+	worldInverseInertia() = rotation * massProperties().inverseInertia * glm::transpose(rotation);
+}
+
+void Actor::QueueMesh(float a_blend) const
+{
+	if (1 <= a_blend)
+	{
+		Renderer::QueueMesh(appearance().mesh, appearance().texture, geometry()->modelMatrix());
+		return;
+	}
+	glm::vec3 position = glm::mix(appearance().previousPosition, geometry()->position, a_blend);
+	glm::quat orientation = glm::slerp(appearance().previousOrientation, geometry()->orientation(), a_blend);
+	Renderer::QueueMesh(appearance().mesh, appearance().texture, glm::translate(position) * glm::mat4_cast(orientation) *
+										   glm::scale(geometry()->scale()));
 }
 
 static bool validImpulse(const glm::vec3& a_vec3, float a_threshold = 0.0001f)
@@ -131,6 +450,7 @@ void Actor::ApplyLinearImpulse(const glm::vec3& a_impulse)
 {
 	if (validImpulse(a_impulse))
 	{
+		Wake();
 		float m = GetMass();
 		if (0 != m)
 			Accelerate(a_impulse / m);
@@ -141,9 +461,8 @@ void Actor::ApplyAngularImpulse(const glm::vec3& a_angularImpulse)
 {
 	if (validImpulse(a_angularImpulse))
 	{
-		float i = GetRotationalInertia(a_angularImpulse);
-		if (0 != i)
-			AccelerateRotation(glm::inverse(GetInertiaTensor()) * a_angularImpulse);
+		Wake();
+		AccelerateRotation(worldInverseInertia() * a_angularImpulse);
 		EnforceMinSpeed();
 	}
 }
@@ -152,7 +471,7 @@ void Actor::ApplyImpulse(const glm::vec3& a_impulse, const glm::vec3& contactPoi
 	if (validImpulse(a_impulse))
 	{
 		glm::vec3 r = GetPosition() - contactPoint;
-		glm::vec3 d = glm::normalize(r);
+		glm::vec3 d = Geometry::Normalize(r);
 		if (glm::vec3(0) == r)
 		{
 			ApplyLinearImpulse(a_impulse);
@@ -168,8 +487,39 @@ void Actor::ApplyImpulse(const glm::vec3& a_impulse, const glm::vec3& contactPoi
 
 void Actor::EnforceMinSpeed()
 {
-	if (glm::length2(m_velocity) < m_minSpeed2)
-		m_velocity = glm::vec3(0);
-	if (glm::length2(m_angularVelocity) < m_minAngularSpeed2)
-		m_angularVelocity = glm::vec3(0);
+	if (glm::length2(velocity()) < activity().minSpeed2)
+		velocity() = glm::vec3(0);
+	if (glm::length2(angularVelocity()) < activity().minAngularSpeed2)
+		angularVelocity() = glm::vec3(0);
+}
+
+void Actor::Wake()
+{
+	if (!activity().dynamic)
+		return;
+	activity().stillTime = 0;
+	if (!activity().awake)
+	{
+		activity().awake = true;
+		if (nullptr != m_awakeCounter)
+			++*m_awakeCounter;
+	}
+}
+void Actor::Sleep()
+{
+	if (!activity().awake)
+		return;
+	activity().awake = false;
+	velocity() = angularVelocity() = glm::vec3(0);
+	activity().stillTime = 0;
+	if (nullptr != m_awakeCounter)
+		--*m_awakeCounter;
+}
+void Actor::SetAwakeCounter(std::atomic<unsigned int>* a_counter)
+{
+	if (activity().awake && nullptr != m_awakeCounter)
+		--*m_awakeCounter;
+	m_awakeCounter = a_counter;
+	if (activity().awake && nullptr != m_awakeCounter)
+		++*m_awakeCounter;
 }
@@ -7,6 +7,8 @@
 #include "Renderer.h"
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
+#include <atomic>
+#include <vector>
 
 class Actor
 {
@@ -20,12 +22,15 @@ public:
 		float rotationalDrag;
 		float staticFriction;
 		float dynamicFriction;
+		float rollingResistance;	// of a sphere rolling on a support
 		Material(float a_density = 1.0f, float a_elasticity = 0.9f,
 				 float a_staticFriction = 1.0f, float a_dynamicFriction = 1.0f,
-				 float a_linearDrag = 0.5f, float a_rotationalDrag = 0.5f)
+				 float a_linearDrag = 0.5f, float a_rotationalDrag = 0.5f,
+				 float a_rollingResistance = 0.0f)
 			: density(a_density), elasticity(a_elasticity),
 			  linearDrag(a_linearDrag), rotationalDrag(a_rotationalDrag),
-			  staticFriction(a_staticFriction), dynamicFriction(a_dynamicFriction) {}
+			  staticFriction(a_staticFriction), dynamicFriction(a_dynamicFriction),
+			  rollingResistance(a_rollingResistance) {}
 	};
 
 	Actor(const Geometry& a_geometry,
@@ -39,10 +44,12 @@ public:
 		  const glm::mat3& a_inertiaTensor = glm::mat3(0),
 		  float a_minSpeed = 0.1f,
 		  float a_minAngularSpeed = 0.05f)
-		: m_mesh(a_mesh), m_texture(a_texture), m_geometry(a_geometry.Clone()), m_dynamic(a_dynamic),
-		  m_material(a_material), m_velocity(a_velocity), m_angularVelocity(a_angularVelocity),
-		  m_mass(a_mass), m_inertiaTensor(a_inertiaTensor), m_force(0), m_torque(0),
-		  m_minSpeed2(a_minSpeed * a_minSpeed), m_minAngularSpeed2(a_minAngularSpeed * a_minAngularSpeed) {}
+		: m_store(&m_ownStore), m_index(0), m_awakeCounter(nullptr), m_sceneSlot(-1),
+		  m_mass(a_mass), m_inertiaTensor(a_inertiaTensor)
+	{
+		Init(a_geometry, a_mesh, a_dynamic, a_material, a_texture, a_velocity, a_angularVelocity,
+			 a_minSpeed, a_minAngularSpeed);
+	}
 	Actor(const Geometry& a_geometry,
 		  const Mesh& a_mesh,
 		  const Material& a_material,
@@ -53,31 +60,130 @@ public:
 		  const glm::mat3& a_inertiaTensor = glm::mat3(0),
 		  float a_minSpeed = 0.1f,
 		  float a_minAngularSpeed = 0.05f)
-		: m_mesh(a_mesh), m_texture(a_texture), m_geometry(a_geometry.Clone()), m_dynamic(true),
-		  m_material(a_material), m_velocity(a_velocity), m_angularVelocity(a_angularVelocity),
-		  m_mass(a_mass), m_inertiaTensor(a_inertiaTensor), m_force(0), m_torque(0),
-		  m_minSpeed2(a_minSpeed * a_minSpeed), m_minAngularSpeed2(a_minAngularSpeed * a_minAngularSpeed) {}
-	~Actor() { delete m_geometry; m_geometry = nullptr; }
-
-	virtual void Update(double a_deltaTime, const glm::vec3& a_gravity = glm::vec3(0));
-	void QueueMesh() const { Renderer::QueueMesh(m_mesh, m_texture, m_geometry->modelMatrix()); }
-
-	const glm::vec3& GetPosition() const { return m_geometry->position; }
-	const glm::quat& GetOrientation() const { return m_geometry->orientation(); }
-	const Geometry& GetGeometry() const { return *m_geometry; }
-	Geometry& GetGeometry() { return *m_geometry; }
-	const glm::vec3& GetVelocity() const { return m_velocity; }
-	const glm::vec3& GetAngularVelocity() const { return m_angularVelocity; }
-	glm::vec3 GetPointVelocity(const glm::vec3& a_point, bool a_ignoreOutside = true) const;
-	float GetMass() const
+		: m_store(&m_ownStore), m_index(0), m_awakeCounter(nullptr), m_sceneSlot(-1),
+		  m_mass(a_mass), m_inertiaTensor(a_inertiaTensor)
 	{
-		return (0 != m_mass ? m_mass : m_material.density * m_geometry->volume());
+		Init(a_geometry, a_mesh, true, a_material, a_texture, a_velocity, a_angularVelocity,
+			 a_minSpeed, a_minAngularSpeed);
 	}
-	glm::mat3 GetInertiaTensor() const
+
+	Actor(const Actor&) = delete;
+	Actor& operator=(const Actor&) = delete;
+
+	struct MassProperties
+	{
+		float mass;
+		float inverseMass;
+		glm::mat3 inertiaTensor;	// in the actor's own space
+		glm::mat3 inverseInertia;
+		bool isotropic;	// the same about every axis, so rotating it changes nothing
+	};
+
+	struct Support
+	{
+		const Actor* actor;	// nullptr if the actor isn't supported
+		glm::vec3 normal;	// of the face, away from the support
+		float height;	// of the face along its normal
+	};
+
+	struct Activity
 	{
-		return glm::mat3(0) != m_inertiaTensor ? m_inertiaTensor :
-				m_geometry->interiaTensorDividedByMass() * GetMass();
+		bool dynamic;
+		bool awake;
+		float stillTime;
+		float minSpeed2;
+		float minAngularSpeed2;
+	};
+
+	// what's only needed for drawing
+	struct Appearance
+	{
+		Mesh mesh;
+		Texture texture;
+		glm::vec4 color;
+		glm::vec3 previousPosition;	// pose at the start of the last step, to blend from
+		glm::quat previousOrientation;
+	};
+
+	// Actor state in parallel arrays, one entry per actor.  A scene keeps the
+	// actors it holds in one store, in body order, so a step walks each kind
+	// of state through contiguous memory, and the drawing data is in an array
+	// of its own that the step never touches.  An actor outside a scene keeps
+	// its state in a one-entry store of its own.
+	struct Store
+	{
+		// read and written every step
+		std::vector<Geometry::Variant> geometries;
+		std::vector<glm::vec3> velocities;
+		std::vector<glm::vec3> angularVelocities;
+		std::vector<glm::vec3> forces;
+		std::vector<glm::vec3> torques;
+		std::vector<MassProperties> massProperties;
+		std::vector<glm::mat3> worldInverseInertias;
+		std::vector<Support> supports;
+		std::vector<Activity> activities;
+		std::vector<Material> materials;
+		// only read for drawing
+		std::vector<Appearance> appearances;
+
+		unsigned int size() const { return geometries.size(); }
+		void Append(const Store& a_store, unsigned int a_index);
+		void Remove(unsigned int a_index);	// moves the last entry into its place
+		void clear();
+	};
+
+	// moves the actor's state to the end of a scene's store, or back into its
+	// own with nullptr
+	void SetStore(Store* a_store);
+	// where its state is in the store, once the scene has moved it
+	void SetStoreIndex(unsigned int a_index) { m_index = a_index; }
+
+	// what a step of integration needs of an actor, so that the scene can
+	// integrate free actors together instead of calling Update on each
+	struct Motion
+	{
+		glm::vec3 force;	// including gravity - zero if the actor has no mass
+		float mass;	// one if it has none
+		float linearDrag;
+		glm::vec3 torque;	// including drag - zero if it has no rotational inertia
+		float rotationalInertia;	// about the torque, or one if it has none
+	};
+
+	void Update(double a_deltaTime, const glm::vec3& a_gravity = glm::vec3(0));
+	// dynamic, awake and unsupported, so Update does nothing but integrate it
+	bool IsFree() const
+	{
+		return activity().dynamic && activity().awake && nullptr == support().actor && !geometry().IsEmpty();
 	}
+	Motion GetMotion(const glm::vec3& a_gravity) const;
+	// the result of integrating a free actor - unlike the setters this
+	// doesn't wake it, or move the pose it's drawn blending from
+	void SetMotion(const glm::vec3& a_position, const glm::quat& a_orientation,
+				   const glm::vec3& a_velocity, const glm::vec3& a_angularVelocity);
+	// a_blend runs from the pose stored at the start of the last step to the current one
+	void QueueMesh(float a_blend = 1.0f) const;
+	void StorePose()
+	{
+		appearance().previousPosition = geometry()->position;
+		appearance().previousOrientation = geometry()->orientation();
+	}
+
+	const glm::vec3& GetPosition() const { return geometry()->position; }
+	const glm::quat& GetOrientation() const { return geometry()->orientation(); }
+	const Geometry& GetGeometry() const { return *geometry(); }
+	Geometry& GetGeometry() { return *geometry(); }
+	glm::vec3 GetAxisAlignedExtents() const { return geometry().AxisAlignedExtents(); }
+	const glm::vec3& GetVelocity() const { return velocity(); }
+	const glm::vec3& GetAngularVelocity() const { return angularVelocity(); }
+	glm::vec3 GetPointVelocity(const glm::vec3& a_point, bool a_ignoreOutside = true) const;
+	// mass properties are worked out when the actor is built or its mass is
+	// set - call UpdateMassProperties after resizing its geometry
+	float GetMass() const { return massProperties().mass; }
+	const glm::mat3& GetInertiaTensor() const { return massProperties().inertiaTensor; }
+	float GetInverseMass() const { return massProperties().inverseMass; }
+	const glm::mat3& GetInverseInertia() const { return worldInverseInertia(); }	// in world space
+	void UpdateMassProperties();
+	void UpdateWorldInertia();	// from the current orientation
 	float GetRotationalInertia(const glm::vec3& a_axis) const
 	{
 		if (glm::vec3(0) == a_axis)
@@ -85,40 +191,86 @@ public:
 		glm::vec3 axis = glm::normalize(a_axis);
 		return glm::dot(axis, GetInertiaTensor() * axis);
 	}
-	bool IsDynamic() const { return m_dynamic; }
+	const Material& GetMaterial() const { return material(); }
+	bool IsDynamic() const { return activity().dynamic; }
+
+	// sleeping actors are left out of integration and collision detection
+	// until an impulse, a contact or a new position or velocity wakes them
+	bool IsAwake() const { return activity().awake; }
+	float GetMinSpeed() const { return sqrt(activity().minSpeed2); }	// slower than this counts as stopped
+	float GetMinAngularSpeed() const { return sqrt(activity().minAngularSpeed2); }
+	float GetMinSpeed2() const { return activity().minSpeed2; }
+	float GetMinAngularSpeed2() const { return activity().minAngularSpeed2; }
+	bool IsStill() const
+	{
+		return (glm::length2(velocity()) < activity().minSpeed2 &&
+				glm::length2(angularVelocity()) < activity().minAngularSpeed2);
+	}
+	float GetStillTime() const { return activity().stillTime; }
+	void UpdateStillTime(float a_deltaTime) { activity().stillTime = (IsStill() ? activity().stillTime + a_deltaTime : 0); }
+	void Wake();
+	void Sleep();
+	void SetAwakeCounter(std::atomic<unsigned int>* a_counter);	// counter of awake actors to keep up to date
+	int GetSceneSlot() const { return m_sceneSlot; }
+	void SetSceneSlot(int a_slot) { m_sceneSlot = a_slot; }	// in the handle table of the scene it's in, or -1
+
+	// a dynamic sphere resting on the flat face of a static box or plane can
+	// be supported by it, and then rolls along the face in Update with no
+	// contact between them - the support is let go as soon as the sphere is
+	// no longer over the face or is knocked off it
+	const Actor* GetSupport() const { return support().actor; }
+	const glm::vec3& GetSupportNormal() const { return support().normal; }
+	bool SetSupport(const Actor* a_support, const glm::vec3& a_normal);	// false if it can't be supported
+	void ClearSupport() { support().actor = nullptr; }
 
-	void SetMass(float a_mass = 0.0f) { m_mass = a_mass; }
+	void SetMass(float a_mass = 0.0f)
+	{
+		m_mass = a_mass;
+		UpdateMassProperties();
+	}
 	void SetPosition(const glm::vec3& a_position = glm::vec3(0))
 	{
-		m_geometry->position = a_position;
+		geometry()->position = a_position;
+		appearance().previousPosition = a_position;
+		support().actor = nullptr;
+		Wake();
 	}
 	void SetOrientation(const glm::quat& a_orientation = glm::quat(0, glm::vec3(0)))
 	{
-		m_geometry->orientation(a_orientation);
+		geometry()->orientation(a_orientation);
+		appearance().previousOrientation = geometry()->orientation();
+		UpdateWorldInertia();
+		Wake();
 	}
 	void SetVelocity(const glm::vec3& a_velocity = glm::vec3(0))
 	{
-		m_velocity = a_velocity;
+		velocity() = a_velocity;
+		Wake();
 	}
 	void SetAngularVelocity(const glm::vec3& a_angularVelocity = glm::vec3(0))
 	{
-		m_angularVelocity = a_angularVelocity;
+		angularVelocity() = a_angularVelocity;
+		Wake();
 	}
 	void Move(const glm::vec3& a_displacement = glm::vec3(0))
 	{
-		m_geometry->position += a_displacement;
+		geometry()->position += a_displacement;
 	}
 	void Spin(const glm::vec3& a_rotation = glm::vec3(0))
 	{
-		m_geometry->spin(a_rotation);
+		geometry()->spin(a_rotation);
+	}
+	void Spin(const glm::quat& a_rotation)
+	{
+		geometry()->spin(a_rotation);
 	}
 	void Accelerate(const glm::vec3& a_deltaV = glm::vec3(0))
 	{
-		m_velocity += a_deltaV;
+		velocity() += a_deltaV;
 	}
 	void AccelerateRotation(const glm::vec3& a_deltaAV = glm::vec3(0))
 	{
-		m_angularVelocity += a_deltaAV;
+		angularVelocity() += a_deltaAV;
 	}
 
 	void ApplyImpulse(const glm::vec3& a_impulse, const glm::vec3& contactPoint);
@@ -127,24 +279,57 @@ public:
 
 	void EnforceMinSpeed();
 
+	// friction and rolling resistance over a step on a sphere rolling on a
+	// face, pressed onto it by a_loadImpulse
+	static void RollOnFace(glm::vec3& a_velocity, glm::vec3& a_angularVelocity,
+						   const glm::vec3& a_normal, float a_radius, float a_mass,
+						   const glm::mat3& a_inertiaTensor, const glm::mat3& a_inverseInertia,
+						   float a_friction, float a_resistance, float a_loadImpulse);
+
 	static void ResolveCollision(Actor* a_actor1, Actor* a_actor2);
+	static void ResolveCollision(Actor* a_actor1, Actor* a_actor2,
+								 const Geometry::Collision& a_collision);
 
 protected:
 
-	glm::vec4 m_color;
-	Geometry* m_geometry;
-	Mesh m_mesh;
-	bool m_dynamic;
-	float m_mass;
+	void Init(const Geometry& a_geometry, const Mesh& a_mesh, bool a_dynamic, const Material& a_material,
+			  const Texture& a_texture, const glm::vec3& a_velocity, const glm::vec3& a_angularVelocity,
+			  float a_minSpeed, float a_minAngularSpeed);
+	void IntegrateRotation(double a_deltaTime);
+	bool IsOverSupport() const;
+	bool Roll(double a_deltaTime, const glm::vec3& a_gravity);	// false if the sphere leaves its support
+
+	// the actor's entries in its store
+	Geometry::Variant& geometry() { return m_store->geometries[m_index]; }
+	const Geometry::Variant& geometry() const { return m_store->geometries[m_index]; }
+	glm::vec3& velocity() { return m_store->velocities[m_index]; }
+	const glm::vec3& velocity() const { return m_store->velocities[m_index]; }
+	glm::vec3& angularVelocity() { return m_store->angularVelocities[m_index]; }
+	const glm::vec3& angularVelocity() const { return m_store->angularVelocities[m_index]; }
+	glm::vec3& force() { return m_store->forces[m_index]; }
+	const glm::vec3& force() const { return m_store->forces[m_index]; }
+	glm::vec3& torque() { return m_store->torques[m_index]; }
+	const glm::vec3& torque() const { return m_store->torques[m_index]; }
+	MassProperties& massProperties() { return m_store->massProperties[m_index]; }
+	const MassProperties& massProperties() const { return m_store->massProperties[m_index]; }
+	glm::mat3& worldInverseInertia() { return m_store->worldInverseInertias[m_index]; }
+	const glm::mat3& worldInverseInertia() const { return m_store->worldInverseInertias[m_index]; }
+	Support& support() { return m_store->supports[m_index]; }
+	const Support& support() const { return m_store->supports[m_index]; }
+	Activity& activity() { return m_store->activities[m_index]; }
+	const Activity& activity() const { return m_store->activities[m_index]; }
+	Material& material() { return m_store->materials[m_index]; }
+	const Material& material() const { return m_store->materials[m_index]; }
+	Appearance& appearance() { return m_store->appearances[m_index]; }
+	const Appearance& appearance() const { return m_store->appearances[m_index]; }
+
+	Store* m_store;	// the scene's while the actor is in one, otherwise m_ownStore
+	unsigned int m_index;
+	Store m_ownStore;
+	std::atomic<unsigned int>* m_awakeCounter;
+	int m_sceneSlot;
+	float m_mass;	// as given - zero to work it out from the density
 	glm::mat3 m_inertiaTensor;
-	Material m_material;
-	Texture m_texture;
-	glm::vec3 m_velocity;
-	glm::vec3 m_angularVelocity;
-	glm::vec3 m_force;
-	glm::vec3 m_torque;
-	float m_minSpeed2;
-	float m_minAngularSpeed2;
 };
 
 #endif	// _ACTOR_H_
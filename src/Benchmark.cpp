@@ -0,0 +1,242 @@
+#include "Benchmark.h"
+#include "Scene.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+// cases are repeated until they've run for at least this long, in seconds
+static const double MIN_RUN_TIME = 0.5;
+static const unsigned int BOX_PAIRS = 1000;
+static const unsigned int PLANE_PAIRS = 2000;
+static const unsigned int BODIES = 4096;
+static const unsigned int STEPS = 600;
+static const unsigned int SPHERES = 1024;
+static const unsigned int SOLVER_ITERATIONS = 10;
+static const float TIME_STEP = 1.0f / 60;
+
+// the same random numbers on every run and every compiler
+static unsigned int s_seed = 12345;
+static float Random(float a_min, float a_max)
+{
+	s_seed = s_seed * 1664525 + 1013904223;
+	return a_min + (a_max - a_min) * (float)(s_seed >> 8) / (float)(1 << 24);
+}
+static glm::vec3 RandomVector(float a_min, float a_max)
+{
+	return glm::vec3(Random(a_min, a_max), Random(a_min, a_max), Random(a_min, a_max));
+}
+
+static double Seconds(std::chrono::steady_clock::time_point a_start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - a_start).count();
+}
+
+// nanoseconds per call of the action, which is called with 0 to a_count - 1
+// in turn until the run is long enough
+template<typename Action>
+static double Time(unsigned int a_count, Action a_action)
+{
+	unsigned int calls = 0;
+	auto start = std::chrono::steady_clock::now();
+	double seconds = 0;
+	do
+	{
+		for (unsigned int i = 0; i < a_count; ++i)
+			a_action(i);
+		calls += a_count;
+		seconds = Seconds(start);
+	} while (seconds < MIN_RUN_TIME);
+	return seconds * 1e9 / calls;
+}
+
+void Benchmark::Run()
+{
+	SeparatingAxes();
+	Integration();
+	SphereSteps();
+}
+
+// Random boxes in a small space, so about half the pairs touch, and planes
+// through the same space facing every way.  The hits are counted along with
+// the time, so a faster detector can be seen to find the same ones.
+void Benchmark::SeparatingAxes()
+{
+	s_seed = 12345;
+	std::vector<Geometry::Box> boxes;
+	for (unsigned int i = 0; i < 2 * BOX_PAIRS; ++i)
+	{
+		glm::vec3 angles = RandomVector(-180, 180);
+		boxes.push_back(Geometry::Box(RandomVector(0.25f, 1.25f), RandomVector(0, 3),
+									  angles.x, angles.y, angles.z));
+	}
+	std::vector<Geometry::Plane> planes;
+	for (unsigned int i = 0; i < PLANE_PAIRS; ++i)
+	{
+		glm::vec3 normal = RandomVector(-1, 1);
+		if (glm::vec3(0) == normal)
+			normal = glm::vec3(0, 0, 1);
+		planes.push_back(Geometry::Plane(RandomVector(0, 3), glm::normalize(normal)));
+	}
+
+	Geometry::Collision collision;
+	unsigned int hits = 0;
+	for (unsigned int i = 0; i < BOX_PAIRS; ++i)
+		hits += Geometry::DetectCollision(boxes[2 * i], boxes[2 * i + 1], &collision);
+	double time = Time(BOX_PAIRS, [&](unsigned int a_pair)
+	{
+		Geometry::DetectCollision(boxes[2 * a_pair], boxes[2 * a_pair + 1], &collision);
+	});
+	printf("box/box: %.1f ns per test, %u of %u pairs touching\n", time, hits, BOX_PAIRS);
+
+	hits = 0;
+	for (unsigned int i = 0; i < PLANE_PAIRS; ++i)
+		hits += Geometry::DetectCollision(planes[i], boxes[i % boxes.size()], &collision);
+	time = Time(PLANE_PAIRS, [&](unsigned int a_pair)
+	{
+		Geometry::DetectCollision(planes[a_pair], boxes[a_pair % boxes.size()], &collision);
+	});
+	printf("plane/box: %.1f ns per test, %u of %u pairs touching\n", time, hits, PLANE_PAIRS);
+}
+
+template<typename Real>
+static void FillBodies(Scene::BasicBodies<Real>& a_bodies)
+{
+	s_seed = 54321;
+	a_bodies.resize(BODIES);
+	for (unsigned int i = 0; i < BODIES; ++i)
+	{
+		// spheres and boxes of various sizes, falling and tumbling
+		float mass = Random(1, 5);
+		glm::vec3 position = RandomVector(-10, 10), velocity = RandomVector(-5, 5);
+		glm::vec3 angularVelocity = RandomVector(-10, 10);
+		glm::quat orientation = glm::normalize(glm::quat(Random(-1, 1), RandomVector(-1, 1)));
+		a_bodies.x[i] = position.x;
+		a_bodies.y[i] = position.y;
+		a_bodies.z[i] = position.z;
+		a_bodies.vx[i] = velocity.x;
+		a_bodies.vy[i] = velocity.y;
+		a_bodies.vz[i] = velocity.z;
+		a_bodies.wx[i] = angularVelocity.x;
+		a_bodies.wy[i] = angularVelocity.y;
+		a_bodies.wz[i] = angularVelocity.z;
+		a_bodies.qx[i] = orientation.x;
+		a_bodies.qy[i] = orientation.y;
+		a_bodies.qz[i] = orientation.z;
+		a_bodies.qw[i] = orientation.w;
+		a_bodies.fx[i] = a_bodies.fy[i] = 0;
+		a_bodies.fz[i] = -9.8f * mass;
+		a_bodies.mass[i] = mass;
+		a_bodies.linearDrag[i] = 0.1f;
+		a_bodies.tx[i] = a_bodies.ty[i] = a_bodies.tz[i] = 0;
+		a_bodies.rotationalInertia[i] = mass * (0 == i % 2 ? 0.4f : 0.67f);
+		a_bodies.minSpeed2[i] = a_bodies.minAngularSpeed2[i] = 0;
+	}
+}
+
+// The same bodies stepped in float, as the scene does, and in double as the
+// reference, timed separately and then compared after the whole run.
+void Benchmark::Integration()
+{
+	Scene::BasicBodies<float> floats;
+	Scene::BasicBodies<double> doubles;
+	FillBodies(floats);
+	FillBodies(doubles);
+
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < STEPS; ++i)
+		Scene::IntegrateBodies(floats, 0, BODIES, TIME_STEP);
+	double floatTime = Seconds(start) * 1e9 / (STEPS * BODIES);
+	start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < STEPS; ++i)
+		Scene::IntegrateBodies(doubles, 0, BODIES, (double)TIME_STEP);
+	double doubleTime = Seconds(start) * 1e9 / (STEPS * BODIES);
+
+	double range = 0, positionError = 0, orientationError = 0;
+	for (unsigned int i = 0; i < BODIES; ++i)
+	{
+		glm::dvec3 reference(doubles.x[i], doubles.y[i], doubles.z[i]);
+		glm::dvec3 position(floats.x[i], floats.y[i], floats.z[i]);
+		range = std::max(range, glm::length(reference));
+		positionError = std::max(positionError, glm::length(position - reference));
+		double dot = floats.qx[i] * doubles.qx[i] + floats.qy[i] * doubles.qy[i] +
+					 floats.qz[i] * doubles.qz[i] + floats.qw[i] * doubles.qw[i];
+		orientationError = std::max(orientationError, 1 - fabs(dot));
+	}
+	printf("integration: float %.1f ns, double %.1f ns per body-step\n", floatTime, doubleTime);
+	printf("after %u steps: positions within %g on a range of %g, orientations within %g of 1 - |dot|\n",
+		   STEPS, positionError, range, orientationError);
+}
+
+template<typename Real>
+static void FillSpheres(Scene::BasicSpheres<Real>& a_spheres)
+{
+	s_seed = 24680;
+	a_spheres.resize(SPHERES);
+	a_spheres.planeNormal = typename Geometry::Precision<Real>::vec3(0, 0, 1);
+	a_spheres.planePosition = typename Geometry::Precision<Real>::vec3(0);
+	a_spheres.elasticity = (Real)0.5f;
+	a_spheres.friction = (Real)0.2f;
+	Scene::BasicBodies<Real>& b = a_spheres.bodies;
+	for (unsigned int i = 0; i < SPHERES; ++i)
+	{
+		// balls of a few sizes dropped into a heap on the plane, from low
+		// enough that none fall through it - the batch has no swept tests
+		float radius = Random(0.2f, 0.5f);
+		float mass = 4.0f * radius * radius * radius;
+		glm::vec3 position(Random(-6, 6), Random(-6, 6), Random(0.5f, 4.5f));
+		glm::vec3 velocity = RandomVector(-2, 2);
+		a_spheres.radius[i] = radius;
+		b.x[i] = position.x;
+		b.y[i] = position.y;
+		b.z[i] = position.z;
+		b.vx[i] = velocity.x;
+		b.vy[i] = velocity.y;
+		b.vz[i] = velocity.z;
+		b.wx[i] = b.wy[i] = b.wz[i] = 0;
+		b.qx[i] = b.qy[i] = b.qz[i] = 0;
+		b.qw[i] = 1;
+		b.fx[i] = b.fy[i] = 0;
+		b.fz[i] = -9.8f * mass;
+		b.mass[i] = mass;
+		b.linearDrag[i] = 0.1f;
+		b.tx[i] = b.ty[i] = b.tz[i] = 0;
+		b.rotationalInertia[i] = 0.4f * mass * radius * radius;
+		b.minSpeed2[i] = b.minAngularSpeed2[i] = 0;
+	}
+}
+
+// Whole steps of a heap of spheres, integrated, detected and solved, in
+// float and in double from the same source.  Contacts make the heap chaotic,
+// so the difference is worth reading early on, while it still measures the
+// float step's error rather than where two heaps happened to settle.
+void Benchmark::SphereSteps()
+{
+	Scene::BasicSpheres<float> floats;
+	Scene::BasicSpheres<double> doubles;
+	FillSpheres(floats);
+	FillSpheres(doubles);
+
+	double floatTime = 0, doubleTime = 0;
+	for (unsigned int i = 0; i < STEPS; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		Scene::StepSpheres(floats, TIME_STEP, SOLVER_ITERATIONS);
+		floatTime += Seconds(start);
+		start = std::chrono::steady_clock::now();
+		Scene::StepSpheres(doubles, (double)TIME_STEP, SOLVER_ITERATIONS);
+		doubleTime += Seconds(start);
+		if (0 != (i + 1) % (STEPS / 4))
+			continue;
+		double positionError = 0;
+		for (unsigned int j = 0; j < SPHERES; ++j)
+		{
+			glm::dvec3 reference(doubles.bodies.x[j], doubles.bodies.y[j], doubles.bodies.z[j]);
+			glm::dvec3 position(floats.bodies.x[j], floats.bodies.y[j], floats.bodies.z[j]);
+			positionError = std::max(positionError, glm::length(position - reference));
+		}
+		printf("spheres after %u steps: %u contacts in float, %u in double, positions within %g\n",
+			   i + 1, (unsigned int)floats.contacts.size(), (unsigned int)doubles.contacts.size(), positionError);
+	}
+	printf("sphere steps: float %.1f ns, double %.1f ns per sphere-step\n",
+		   floatTime * 1e9 / (STEPS * SPHERES), doubleTime * 1e9 / (STEPS * SPHERES));
+}
@@ -0,0 +1,18 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+// Timings behind the performance figures given for the separating axis tests,
+// the batch integrator and whole sphere steps in float and double, run with
+// "Billiards -benchmark" in place of the game.  The separating axis cases only
+// go through Geometry::DetectCollision, so building them against an earlier
+// revision gives the numbers to compare against.
+namespace Benchmark
+{
+	void Run();
+
+	void SeparatingAxes();
+	void Integration();
+	void SphereSteps();
+}
+
+#endif	// _BENCHMARK_H_
@@ -3,35 +3,22 @@
 const glm::mat4 Geometry::NO_ROTATION = glm::mat4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
 const glm::quat Geometry::UNROTATED_ORIENTATION = glm::quat(1, 0, 0, 0);
 
-//
-// Collision
-//
+// With fast maths on:
+//  - InverseSqrt, and so Length and Normalize, are within ERR_RSQRT of exact,
+//    relative to the result
+//  - SinCos is within ERR_SINCOS of exact for angles up to a thousand radians
+//  - rotations smaller than SMALL_ROTATION radians get a first order
+//    quaternion, which turns them through an angle short by no more than the
+//    cube of it over twelve - ERR_SMALL at most
+// Running the same scene with it off and on shows how far that moves the
+// trajectories.
+bool Geometry::s_fastMath = false;
+const float Geometry::ERR_RSQRT = 2e-6f;
+const float Geometry::ERR_SINCOS = 5e-7f;
+const float Geometry::ERR_SMALL = 7e-7f;
 
-Geometry::Collision::~Collision()
-{
-	if (nullptr != m_shape1)
-	{
-		delete m_shape1;
-		m_shape1 = nullptr;
-	}
-	if (nullptr != m_shape2)
-	{
-		delete m_shape2;
-		m_shape2 = nullptr;
-	}
-}
-void Geometry::Collision::shape1(const Geometry& a_shape)
-{
-	if (nullptr != m_shape1)
-		delete m_shape1;
-	m_shape1 = a_shape.Clone();
-}
-void Geometry::Collision::shape2(const Geometry& a_shape)
-{
-	if (nullptr != m_shape2)
-		delete m_shape2;
-	m_shape2 = a_shape.Clone();
-}
+// below this, a rotation is turned into a quaternion without sine or cosine
+static const float SMALL_ROTATION = 0.02f;
 
 //
 // Constructors
@@ -39,24 +26,28 @@ void Geometry::Collision::shape2(const Geometry& a_shape)
 
 Geometry::Geometry(const glm::vec3& a_position, Shape a_shape)
 	: position(a_position), m_shape(a_shape), m_rotationMatrix(NO_ROTATION),
-	  m_orientation(UNROTATED_ORIENTATION) {}
+	  m_absRotationMatrix(NO_ROTATION), m_axisAligned(true), m_orientation(UNROTATED_ORIENTATION) {}
 Geometry::Geometry(const glm::vec3& a_position,
 				   const glm::mat4& a_rotation,
 				   Shape a_shape)
-	: position(a_position), m_rotationMatrix(a_rotation), m_shape(a_shape),
-	  m_orientation(glm::quat_cast(a_rotation)) {}
+	: position(a_position), m_shape(a_shape), m_orientation(glm::quat_cast(a_rotation))
+{
+	UpdateRotation();
+}
 Geometry::Geometry(const glm::vec3& a_position,
 				   const glm::quat& a_orientation,
 				   Shape a_shape)
-	: position(a_position), m_rotationMatrix(glm::mat4_cast(a_orientation)),
-	  m_shape(a_shape), m_orientation(a_orientation) {}
+	: position(a_position), m_shape(a_shape), m_orientation(a_orientation)
+{
+	UpdateRotation();
+}
 Geometry::Geometry(const glm::vec3& a_position,
 				   const glm::vec3& a_forward, const glm::vec3& a_up,
 				   Shape a_shape)
 	: position(a_position), m_shape(a_shape),
-	  m_rotationMatrix(glm::orientation(a_forward, a_up))
+	  m_orientation(glm::quat_cast(glm::orientation(a_forward, a_up)))
 {
-	m_orientation = glm::quat_cast(m_rotationMatrix);
+	UpdateRotation();
 }
 Geometry::Geometry(const glm::vec3& a_position,
 				   const glm::vec3& a_axis, float a_angle,
@@ -64,7 +55,7 @@ Geometry::Geometry(const glm::vec3& a_position,
 	: position(a_position), m_shape(a_shape)
 {
 	AxisAngle(m_orientation, a_angle, a_axis);
-	m_rotationMatrix = glm::mat4_cast(m_orientation);
+	UpdateRotation();
 }
 Geometry::Geometry(const glm::vec3& a_position,
 				   float a_yaw, float a_pitch, float a_roll,
@@ -74,7 +65,7 @@ Geometry::Geometry(const glm::vec3& a_position,
 	: position(a_position), m_shape(a_shape)
 {
 	YawPitchRoll(m_orientation, a_yaw, a_pitch, a_roll, a_yawAxis, a_rollAxis);
-	m_rotationMatrix = glm::mat4_cast(m_orientation);
+	UpdateRotation();
 }
 Geometry::Geometry(const glm::vec3& a_position,
 				   float a_yaw, float a_pitch, float a_roll,
@@ -82,7 +73,7 @@ Geometry::Geometry(const glm::vec3& a_position,
 	: position(a_position), m_shape(a_shape)
 {
 	YawPitchRoll(m_orientation, a_yaw, a_pitch, a_roll);
-	m_rotationMatrix = glm::mat4_cast(m_orientation);
+	UpdateRotation();
 }
 
 //
@@ -91,6 +82,21 @@ Geometry::Geometry(const glm::vec3& a_position,
 
 void Geometry::Rotation(glm::quat& a_orientation, const glm::vec3& a_rotation)
 {
+	if (s_fastMath)
+	{
+		float angle2 = glm::dot(a_rotation, a_rotation);
+		if (SMALL_ROTATION * SMALL_ROTATION > angle2)
+		{
+			float inverseLength = InverseSqrt(1 + angle2 / 4);
+			a_orientation = glm::quat(inverseLength, a_rotation * (0.5f * inverseLength));
+			return;
+		}
+		float inverseAngle = InverseSqrt(angle2);
+		float sine, cosine;
+		SinCos(angle2 * inverseAngle / 2, sine, cosine);
+		a_orientation = glm::quat(cosine, a_rotation * (sine * inverseAngle));
+		return;
+	}
 	float angle = glm::length(a_rotation);
 	AxisAngle(a_orientation, angle, a_rotation);
 }
@@ -108,6 +114,15 @@ void Geometry::AxisAngle(glm::quat& a_orientation,
 		a_orientation = UNROTATED_ORIENTATION;
 		return;
 	}
+	if (s_fastMath)
+	{
+		// no need to wrap the angle first, but keep w positive as wrapping does
+		float sine, cosine;
+		SinCos(a_angle / 2, sine, cosine);
+		float sign = (0 > cosine ? -1.0f : 1.0f);
+		a_orientation = glm::quat(sign * cosine, Normalize(a_axis) * (sign * sine));
+		return;
+	}
 	float angle = a_angle;
 	while (angle > glm::pi<float>())
 		angle -= glm::pi<float>() * 2;
@@ -121,6 +136,31 @@ glm::quat Geometry::AxisAngle(float a_angle, const glm::vec3& a_axis)
 	AxisAngle(result, a_angle, a_axis);
 	return result;
 }
+void Geometry::SinCos(float a_angle, float& a_sin, float& a_cos)
+{
+	if (!s_fastMath)
+	{
+		a_sin = glm::sin(a_angle);
+		a_cos = glm::cos(a_angle);
+		return;
+	}
+
+	// take off whole quarter turns, in double so that big angles don't lose
+	// what's left, leaving at most an eighth of a turn either way - where the
+	// Taylor series below are good to float precision
+	double quarters = floor(a_angle * (2 / glm::pi<double>()) + 0.5);
+	float x = (float)(a_angle - quarters * (glm::pi<double>() / 2));
+	float x2 = x * x;
+	float sine = x + x * x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040)));
+	float cosine = 1 + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320))));
+	switch ((int)(quarters - 4 * floor(quarters / 4)))
+	{
+	case 0: a_sin = sine; a_cos = cosine; break;
+	case 1: a_sin = cosine; a_cos = -sine; break;
+	case 2: a_sin = -sine; a_cos = -cosine; break;
+	default: a_sin = -cosine; a_cos = sine; break;
+	}
+}
 void Geometry::YawPitchRoll(glm::quat& a_orientation,
 							float a_yaw, float a_pitch, float a_roll,
 							const glm::vec3& a_yawAxis,
@@ -191,7 +231,8 @@ glm::quat Geometry::YawPitchRoll(float a_yaw, float a_pitch, float a_roll,
 
 glm::vec3 Geometry::ToWorld(const glm::vec3& a_localCoordinate, bool a_isDirection) const
 {
-	return (glm::translate(position) * m_rotationMatrix * glm::vec4(a_localCoordinate, a_isDirection ? 0 : 1)).xyz();
+	glm::vec3 rotated = m_rotationMatrix * a_localCoordinate;
+	return (a_isDirection ? rotated : rotated + position);
 }
 glm::vec3 Geometry::ToWorld(float a_localX, float a_localY, float a_localZ, bool a_isDirection) const
 {
@@ -199,21 +240,40 @@ glm::vec3 Geometry::ToWorld(float a_localX, float a_localY, float a_localZ, bool
 }
 glm::vec3 Geometry::ToLocal(const glm::vec3& a_worldCoordinate, bool a_isDirection) const
 {
-	return (glm::inverse(m_rotationMatrix) * glm::translate(-position) * glm::vec4(a_worldCoordinate, a_isDirection ? 0 : 1)).xyz();
+	// multiplying on the left by the rotation is multiplying by its transpose,
+	// which is its inverse
+	return (a_isDirection ? a_worldCoordinate : a_worldCoordinate - position) * m_rotationMatrix;
 }
 glm::vec3 Geometry::ToLocal(float a_worldX, float a_worldY, float a_worldZ, bool a_isDirection) const
 {
 	return ToLocal(glm::vec3(a_worldX, a_worldY, a_worldZ), a_isDirection);
 }
 
+glm::mat4 Geometry::modelMatrix() const
+{
+	glm::vec3 size = scale();
+	return glm::mat4(glm::vec4(m_rotationMatrix[0] * size.x, 0),
+					 glm::vec4(m_rotationMatrix[1] * size.y, 0),
+					 glm::vec4(m_rotationMatrix[2] * size.z, 0),
+					 glm::vec4(position, 1));
+}
+
 //
 // orientation manipulation
 //
 
+void Geometry::UpdateRotation()
+{
+	m_rotationMatrix = glm::mat3_cast(m_orientation);
+	for (unsigned int i = 0; i < 3; ++i)
+		m_absRotationMatrix[i] = glm::abs(m_rotationMatrix[i]);
+	m_axisAligned = (glm::mat3(1) == m_rotationMatrix);
+}
+
 void Geometry::orientation(const glm::quat& a_orientation)
 {
 	m_orientation = a_orientation;
-	m_rotationMatrix = glm::mat4_cast(m_orientation);
+	UpdateRotation();
 }
 void Geometry::orientation(const glm::vec3& a_rotation)
 {
@@ -226,7 +286,7 @@ void Geometry::orientation(float a_angle, glm::vec3& a_axis)
 void Geometry::spin(const glm::quat& a_rotation)
 {
 	m_orientation = a_rotation * m_orientation;
-	m_rotationMatrix = glm::mat4_cast(m_orientation);
+	UpdateRotation();
 }
 void Geometry::spin(const glm::vec3& a_rotation)
 {
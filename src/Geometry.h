@@ -5,6 +5,11 @@
 #include <glm/ext.hpp>
 #include <vector>
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#include <xmmintrin.h>
+#define GEOMETRY_SSE
+#endif
+
 struct Geometry
 {
 public:
@@ -16,34 +21,49 @@ public:
 		PLANE = 1,
 		SPHERE = 2,
 		BOX = 3,
+		HULL = 4,
 
-		SHAPE_COUNT = 4
+		SHAPE_COUNT = 5
 	};
 
+	// plain data, so buffers of contacts can be reused without allocating -
+	// the shapes are the ones passed to DetectCollision, not copies
 	struct Collision
 	{
-		glm::vec3 point;
+		static const unsigned int MAX_POINTS = 4;
+
+		glm::vec3 point;	// middle of the contact points
 		glm::vec3 normal; // points from shape1 to shape 2
 		float interpenetration;
+		const Geometry* shape1;
+		const Geometry* shape2;
 
-		~Collision();
-
-		const Geometry& shape1() const { return *m_shape1; }
-		Geometry& shape1() { return *m_shape1; }
-		void shape1(const Geometry& a_shape);
-		const Geometry& shape2() const { return *m_shape2; }
-		Geometry& shape2() { return *m_shape2; }
-		void shape2(const Geometry& a_shape);
+		// every point the shapes touch at, each with its own interpenetration -
+		// shapes touching along a face or an edge can have several
+		glm::vec3 points[MAX_POINTS];
+		float depths[MAX_POINTS];
+		unsigned int pointCount;
 
-	private:
-		Geometry* m_shape1 = nullptr;
-		Geometry* m_shape2 = nullptr;
+		// direction from shape1 towards shape2 that the last hull query was
+		// searching along when it ended - passing it back in for the same pair
+		// next time starts the search there, and zero starts from the centers
+		glm::vec3 separatingAxis;
 	};
 
 	// implemented base classes for each shape
 	struct Plane;
 	struct Box;
 	struct Sphere;
+	struct ConvexHull;
+
+	// any one of the shapes, stored inline instead of on the heap
+	struct Variant;
+
+	// calls a_visitor with a_shape cast to its actual type - this is the one
+	// place the list of shapes is spelled out, so adding a shape means adding
+	// a case here and detectors for it in Geometry_DetectCollision.cpp
+	template<typename Visitor>
+	static typename Visitor::Result Visit(const Geometry& a_shape, const Visitor& a_visitor);
 
 	// static functions
 	static void Rotation(glm::quat& a_orientation,
@@ -64,6 +84,44 @@ public:
 	static bool DetectCollision(const Geometry& a_shape1, const Geometry& a_shape2,
 								Geometry::Collision* a_collision = nullptr);
 
+	// The sphere tests are written once for either precision.  Detect runs
+	// them in float, and batches kept in double run the same source as the
+	// reference to measure the float ones against.
+	template<typename Real> struct Precision;	// glm's types for the scalar
+	template<typename Real>
+	struct BasicContact
+	{
+		typename Precision<Real>::vec3 point;
+		typename Precision<Real>::vec3 normal;	// from the first shape to the second
+		Real interpenetration;
+	};
+	template<typename Real>
+	static bool DetectSpheres(const typename Precision<Real>::vec3& a_center1, Real a_radius1,
+							  const typename Precision<Real>::vec3& a_center2, Real a_radius2,
+							  BasicContact<Real>* a_contact = nullptr);
+	// planes are two-sided, so the normal points towards the sphere's side
+	template<typename Real>
+	static bool DetectPlaneSphere(const typename Precision<Real>::vec3& a_planeNormal,
+								  const typename Precision<Real>::vec3& a_planePosition,
+								  const typename Precision<Real>::vec3& a_center, Real a_radius,
+								  BasicContact<Real>* a_contact = nullptr);
+
+	// the hot paths measure, normalize and rotate through these, which are
+	// exact unless fast maths is switched on for a throughput-bound batch run.
+	// It applies to every scene at once, so switch it between runs rather than
+	// during one - Geometry.cpp has the error bounds
+	static const float ERR_RSQRT;	// relative
+	static const float ERR_SINCOS;	// absolute
+	static const float ERR_SMALL;	// radians
+	static void SetFastMath(bool a_fastMath = true) { s_fastMath = a_fastMath; }
+	static bool IsFastMath() { return s_fastMath; }
+	static float InverseSqrt(float a_value);
+	static float Length(const glm::vec3& a_vector);
+	static glm::vec3 Normalize(const glm::vec3& a_vector);
+	static double Length(const glm::dvec3& a_vector) { return glm::length(a_vector); }	// always exact
+	static glm::dvec3 Normalize(const glm::dvec3& a_vector) { return glm::normalize(a_vector); }
+	static void SinCos(float a_angle, float& a_sin, float& a_cos);
+
 	// abstract functions
 	virtual glm::vec3 AxisAlignedExtents() const = 0;
 	virtual glm::vec3 ClosestSurfacePointTo(const glm::vec3& a_point,
@@ -75,6 +133,15 @@ public:
 	virtual glm::vec3 scale() const = 0;
 	virtual glm::mat3 interiaTensorDividedByMass() const = 0;
 
+	// ray and swept sphere tests - the direction must be normalized, and a ray
+	// or sphere that starts inside the shape hits at distance zero
+	virtual bool Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						 float a_maxDistance, float* a_distance = nullptr,
+						 glm::vec3* a_normal = nullptr) const = 0;
+	virtual bool SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							float a_radius, float a_maxDistance, float* a_distance = nullptr,
+							glm::vec3* a_normal = nullptr) const;
+
 	// implemented member functions
 	Shape GetShape() const { return m_shape; }
 	glm::vec3 ToWorld(const glm::vec3& a_localCoordinate, bool a_isDirection = false) const;
@@ -82,13 +149,16 @@ public:
 	glm::vec3 ToLocal(const glm::vec3& a_worldCoordinate, bool a_isDirection = false) const;
 	glm::vec3 ToLocal(float a_worldX, float a_worldY, float a_worldZ, bool a_isDirection = false) const;
 
-	glm::vec3 axis(unsigned int a_index = 2) const { return m_rotationMatrix[a_index % 3].xyz(); }
-	glm::vec3 localXAxis() const { return m_rotationMatrix[0].xyz(); }
-	glm::vec3 localYAxis() const { return m_rotationMatrix[1].xyz(); }
-	glm::vec3 localZAxis() const { return m_rotationMatrix[2].xyz(); }
-	const glm::mat4* rotationMatrix() const { return &m_rotationMatrix; }
+	// the rotation is kept as a 3x3 matrix, whose transpose is its inverse, and
+	// only rebuilt when the orientation changes
+	const glm::vec3& axis(unsigned int a_index = 2) const { return m_rotationMatrix[a_index % 3]; }
+	const glm::vec3& localXAxis() const { return m_rotationMatrix[0]; }
+	const glm::vec3& localYAxis() const { return m_rotationMatrix[1]; }
+	const glm::vec3& localZAxis() const { return m_rotationMatrix[2]; }
+	const glm::mat3& rotationMatrix() const { return m_rotationMatrix; }
 	const glm::quat& orientation() const { return m_orientation; }
-	const glm::mat4 modelMatrix() const { return glm::translate(position) * m_rotationMatrix * glm::scale(scale()); }
+	bool isAxisAligned() const { return m_axisAligned; }	// unrotated, so local axes are world axes
+	glm::mat4 modelMatrix() const;
 	void orientation(const glm::quat& a_orientation);
 	void orientation(const glm::vec3& a_rotation);
 	void orientation(float a_angle, glm::vec3& a_axis = glm::vec3(0, 0, 1));
@@ -128,13 +198,62 @@ protected:
 			 float a_yaw, float a_pitch, float a_roll,
 			 Shape a_shape);
 
+	// rotation with every element made positive - multiplying a box's extents
+	// by it gives the extents of the box's world-space bounding box
+	const glm::mat3& absRotationMatrix() const { return m_absRotationMatrix; }
+
 private:
 
+	void UpdateRotation();	// from the orientation
+
 	glm::quat m_orientation;
-	glm::mat4 m_rotationMatrix;
+	glm::mat3 m_rotationMatrix;
+	glm::mat3 m_absRotationMatrix;
+	bool m_axisAligned;
 	Shape m_shape;
+
+	static bool s_fastMath;
+};
+
+template<> struct Geometry::Precision<float>
+{
+	typedef glm::vec2 vec2;
+	typedef glm::vec3 vec3;
+	typedef glm::mat3 mat3;
+};
+template<> struct Geometry::Precision<double>
+{
+	typedef glm::dvec2 vec2;
+	typedef glm::dvec3 vec3;
+	typedef glm::dmat3 mat3;
 };
 
+inline float Geometry::InverseSqrt(float a_value)
+{
+#ifdef GEOMETRY_SSE
+	if (s_fastMath)
+	{
+		// the estimate is good to about 12 bits, and a Newton step doubles that
+		float estimate = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(a_value)));
+		return estimate * (1.5f - 0.5f * a_value * estimate * estimate);
+	}
+#endif
+	return glm::inversesqrt(a_value);
+}
+inline float Geometry::Length(const glm::vec3& a_vector)
+{
+	if (!s_fastMath)
+		return glm::length(a_vector);
+	float length2 = glm::dot(a_vector, a_vector);
+	return (0 < length2 ? length2 * InverseSqrt(length2) : 0);
+}
+inline glm::vec3 Geometry::Normalize(const glm::vec3& a_vector)
+{
+	if (!s_fastMath)
+		return glm::normalize(a_vector);
+	return a_vector * InverseSqrt(glm::dot(a_vector, a_vector));
+}
+
 #include "Geometry_Shapes.h"
 
 #endif	// _GEOMETRY_H_
@@ -1,103 +1,117 @@
 #include "Geometry.h"
-#include <functional>
+#include <cfloat>
 
-typedef bool(*CollisionDetector)(const Geometry& a_shape1, const Geometry& a_shape2,
-								 Geometry::Collision* a_collision);
-
-static bool Flip(CollisionDetector a_detector,
-				 const Geometry& a_shape1, const Geometry& a_shape2,
-				 Geometry::Collision* a_collision)
+// Detectors take the shapes as their actual types, so there's no casting or
+// virtual dispatch inside them.  Only one order of each pair of shapes needs
+// its own detector - the other order swaps the shapes, calls that detector
+// and flips the result.
+template<typename Shape1, typename Shape2>
+static bool Detect(const Shape1& a_shape1, const Shape2& a_shape2,
+				   Geometry::Collision* a_collision)
 {
-	bool result = a_detector(a_shape2, a_shape1, a_collision);
+	// the axis a hull query starts from goes from shape1 to shape2 as well
+	if (nullptr != a_collision)
+		a_collision->separatingAxis *= -1.0f;
+	bool result = Detect(a_shape2, a_shape1, a_collision);
+	if (nullptr != a_collision)
+		a_collision->separatingAxis *= -1.0f;
 	if (result && nullptr != a_collision)
 	{
-		Geometry* temp = a_collision->shape1().Clone();
-		a_collision->shape1(a_collision->shape2());
-		a_collision->shape2(*temp);
-		delete temp;
+		const Geometry* temp = a_collision->shape1;
+		a_collision->shape1 = a_collision->shape2;
+		a_collision->shape2 = temp;
 		a_collision->normal *= -1.0f;
 	}
 	return result;
 }
 
-static bool PlanePlane(const Geometry& a_shape1, const Geometry& a_shape2,
+template<> bool Detect(const Geometry::Plane& a_plane1, const Geometry::Plane& a_plane2,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::Sphere& a_sphere,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::Box& a_box,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Sphere& a_sphere1, const Geometry::Sphere& a_sphere2,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Sphere& a_sphere, const Geometry::Box& a_box,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Box& a_box1, const Geometry::Box& a_box2,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Sphere& a_sphere, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::Box& a_box, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision);
+template<> bool Detect(const Geometry::ConvexHull& a_hull1, const Geometry::ConvexHull& a_hull2,
 					   Geometry::Collision* a_collision);
-static bool PlaneSphere(const Geometry& a_shape1, const Geometry& a_shape2,
-						Geometry::Collision* a_collision);
-static bool PlaneBox(const Geometry& a_shape1, const Geometry& a_shape2,
-					 Geometry::Collision* a_collision);
-
-static bool SpherePlane(const Geometry& a_shape1, const Geometry& a_shape2,
-						Geometry::Collision* a_collision)
-{
-	return Flip(PlaneSphere, a_shape1, a_shape2, a_collision);
-}
-static bool SphereSphere(const Geometry& a_shape1, const Geometry& a_shape2,
-						 Geometry::Collision* a_collision);
-static bool SphereBox(const Geometry& a_shape1, const Geometry& a_shape2,
-					  Geometry::Collision* a_collision);
 
-static bool BoxPlane(const Geometry& a_shape1, const Geometry& a_shape2,
-					 Geometry::Collision* a_collision)
-{
-	return Flip(PlaneBox, a_shape1, a_shape2, a_collision);
-}
-static bool BoxSphere(const Geometry& a_shape1, const Geometry& a_shape2,
-					  Geometry::Collision* a_collision)
+// visit the first shape, then the second, and call the detector for the two types
+template<typename Shape1>
+struct DetectWith
 {
-	return Flip(SphereBox, a_shape1, a_shape2, a_collision);
-}
-static bool BoxBox(const Geometry& a_shape1, const Geometry& a_shape2,
-				   Geometry::Collision* a_collision);
-
-static CollisionDetector g_collisionFunctions[Geometry::SHAPE_COUNT][Geometry::SHAPE_COUNT] =
+	typedef bool Result;
+	const Shape1& shape1;
+	Geometry::Collision* collision;
+	DetectWith(const Shape1& a_shape1, Geometry::Collision* a_collision)
+		: shape1(a_shape1), collision(a_collision) {}
+	template<typename Shape2>
+	bool operator()(const Shape2& a_shape2) const { return Detect(shape1, a_shape2, collision); }
+};
+struct DetectAgainst
 {
-	{ nullptr, nullptr, nullptr, nullptr },
-	{ nullptr, PlanePlane, PlaneSphere, PlaneBox },
-	{ nullptr, SpherePlane, SphereSphere, SphereBox },
-	{ nullptr, BoxPlane, BoxSphere, BoxBox }
+	typedef bool Result;
+	const Geometry& shape2;
+	Geometry::Collision* collision;
+	DetectAgainst(const Geometry& a_shape2, Geometry::Collision* a_collision)
+		: shape2(a_shape2), collision(a_collision) {}
+	template<typename Shape1>
+	bool operator()(const Shape1& a_shape1) const
+	{
+		return Geometry::Visit(shape2, DetectWith<Shape1>(a_shape1, collision));
+	}
 };
 
 bool Geometry::DetectCollision(const Geometry& a_shape1, const Geometry& a_shape2,
 							   Geometry::Collision* a_collision)
 {
 	// validity check
-	if (&a_shape1 == &a_shape2 ||
-		Geometry::SHAPE_COUNT <= a_shape1.GetShape() ||
-		Geometry::SHAPE_COUNT <= a_shape2.GetShape())
+	if (&a_shape1 == &a_shape2)
 		return false;
 
-	// call appropriate function
-	CollisionDetector f = g_collisionFunctions[a_shape1.GetShape()][a_shape2.GetShape()];
-	if (nullptr == f)
+	// call appropriate function - detectors that find one point leave
+	// filling in the list of points to here
+	if (nullptr != a_collision)
+		a_collision->pointCount = 0;
+	if (!Visit(a_shape1, DetectAgainst(a_shape2, a_collision)))
 		return false;
-	return f(a_shape1, a_shape2, a_collision);
+	if (nullptr != a_collision && 0 == a_collision->pointCount)
+	{
+		a_collision->points[0] = a_collision->point;
+		a_collision->depths[0] = a_collision->interpenetration;
+		a_collision->pointCount = 1;
+	}
+	return true;
 }
 
-bool PlanePlane(const Geometry& a_shape1, const Geometry& a_shape2,
-				Geometry::Collision* a_collision)
+template<> bool Detect(const Geometry::Plane& a_plane1, const Geometry::Plane& a_plane2,
+					   Geometry::Collision* a_collision)
 {
-	// type check
-	const Geometry::Plane* plane1 = dynamic_cast<const Geometry::Plane*>(&a_shape1);
-	const Geometry::Plane* plane2 = dynamic_cast<const Geometry::Plane*>(&a_shape2);
-	if (nullptr == plane1 || nullptr == plane2)
-		return false;
-
 	// the only non-colliding planes are parallel planes with distance between them
-	glm::vec3 normal1 = plane1->normal();
-	glm::vec3 normal2 = plane2->normal();
+	glm::vec3 normal1 = a_plane1.normal();
+	glm::vec3 normal2 = a_plane2.normal();
 	glm::vec3 cross = glm::cross(normal1, normal2);
 	if (glm::vec3(0) == cross &&
-		0 != glm::dot(normal1, plane2->position - plane1->position))
+		0 != glm::dot(normal1, a_plane2.position - a_plane1.position))
 		return false;
 
 	// otherwise, planes always collide
 	if (nullptr != a_collision)
 	{
-		a_collision->shape1(a_shape1);
-		a_collision->shape2(a_shape2);
+		a_collision->shape1 = &a_plane1;
+		a_collision->shape2 = &a_plane2;
 		a_collision->interpenetration = 0;
-		glm::vec3 midpoint = (plane1->position + plane2->position) * 0.5f;
+		glm::vec3 midpoint = (a_plane1.position + a_plane2.position) * 0.5f;
 		if (glm::vec3(0) == cross)
 		{
 			a_collision->normal = normal1;
@@ -107,8 +121,8 @@ bool PlanePlane(const Geometry& a_shape1, const Geometry& a_shape2,
 		{
 			a_collision->normal = glm::normalize(normal1 + (0 > glm::dot(normal1, normal2) ? -normal2 : normal2));
 			glm::vec3 p;
-			float d1 = glm::dot(plane1->position, normal1);
-			float d2 = glm::dot(plane2->position, normal2);
+			float d1 = glm::dot(a_plane1.position, normal1);
+			float d2 = glm::dot(a_plane2.position, normal2);
 			if (0 != cross.z)
 			{
 				p.x = (d1*normal2.y - d2*normal1.y) / cross.z;
@@ -134,106 +148,114 @@ bool PlanePlane(const Geometry& a_shape1, const Geometry& a_shape2,
 	return true;
 }
 
-bool PlaneSphere(const Geometry& a_shape1, const Geometry& a_shape2,
-				 Geometry::Collision* a_collision)
+template<typename Real>
+bool Geometry::DetectPlaneSphere(const typename Precision<Real>::vec3& a_planeNormal,
+								 const typename Precision<Real>::vec3& a_planePosition,
+								 const typename Precision<Real>::vec3& a_center, Real a_radius,
+								 BasicContact<Real>* a_contact)
 {
-	// type check
-	const Geometry::Plane* plane = dynamic_cast<const Geometry::Plane*>(&a_shape1);
-	const Geometry::Sphere* sphere = dynamic_cast<const Geometry::Sphere*>(&a_shape2);
-	if (nullptr == plane || nullptr == sphere)
-		return false;
-
 	// sphere and plane collide if distance between <= radius
-	glm::vec3 normal = plane->normal();
-	glm::vec3 displacement = sphere->position - plane->position;
-	float distance = glm::dot(normal, displacement);
+	typename Precision<Real>::vec3 normal = a_planeNormal;
+	typename Precision<Real>::vec3 displacement = a_center - a_planePosition;
+	Real distance = glm::dot(normal, displacement);
 	if (0 > distance)
 	{
-		normal *= -1.0f;
+		normal *= (Real)-1;
 		distance *= -1;
 	}
-	if (distance <= sphere->radius)
+	if (distance <= a_radius)
 	{
-		if (nullptr != a_collision)
+		if (nullptr != a_contact)
 		{
-			a_collision->shape1(a_shape1);
-			a_collision->shape2(a_shape2);
-			a_collision->normal = normal;
-			a_collision->interpenetration = sphere->radius - distance;
-			a_collision->point = sphere->position - a_collision->normal * distance;
+			a_contact->normal = normal;
+			a_contact->interpenetration = a_radius - distance;
+			a_contact->point = a_center - a_contact->normal * distance;
 		}
 		return true;
 	}
 	return false;
 }
+template bool Geometry::DetectPlaneSphere<float>(const glm::vec3&, const glm::vec3&, const glm::vec3&, float,
+												 BasicContact<float>*);
+template bool Geometry::DetectPlaneSphere<double>(const glm::dvec3&, const glm::dvec3&, const glm::dvec3&, double,
+												  BasicContact<double>*);
 
-static void GetMinAndMax(const std::vector<glm::vec3>& a_points,
-						 std::function<float(const glm::vec3&)> a_distanceFunction,
-						 float& a_min, float& a_max,
-						 glm::vec3& a_minPoint, glm::vec3& a_maxPoint,
-						 float a_tolerance = 0.0001f)
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::Sphere& a_sphere,
+					   Geometry::Collision* a_collision)
 {
-	if (0 > a_tolerance)
-		a_tolerance *= -1;
-	std::vector<glm::vec3> maxPoints, minPoints;
-	bool start = true;
-	for (auto point : a_points)
+	Geometry::BasicContact<float> contact;
+	if (!Geometry::DetectPlaneSphere(a_plane.normal(), a_plane.position, a_sphere.position, a_sphere.radius,
+									 nullptr != a_collision ? &contact : nullptr))
+		return false;
+	if (nullptr != a_collision)
 	{
-		float distance = a_distanceFunction(point);
-		if (start || distance >= a_max - a_tolerance)
-		{
-			if (distance > a_max + a_tolerance)
-				maxPoints.clear();
-			maxPoints.push_back(point);
-			a_max = distance;
-		}
-		if (start || distance <= a_min + a_tolerance)
-		{
-			if (distance < a_min - a_tolerance)
-				minPoints.clear();
-			minPoints.push_back(point);
-			a_min = distance;
-		}
-		start = false;
+		a_collision->shape1 = &a_plane;
+		a_collision->shape2 = &a_sphere;
+		a_collision->normal = contact.normal;
+		a_collision->interpenetration = contact.interpenetration;
+		a_collision->point = contact.point;
 	}
-	a_minPoint = glm::vec3(0);
-	for (auto point : minPoints)
-		a_minPoint += point;
-	a_minPoint /= (float)(minPoints.size());
-	a_maxPoint = glm::vec3(0);
-	for (auto point : maxPoints)
-		a_maxPoint += point;
-	a_maxPoint /= (float)(maxPoints.size());
+	return true;
 }
 
-bool PlaneBox(const Geometry& a_shape1, const Geometry& a_shape2,
-			  Geometry::Collision* a_collision)
+// A box's projection onto an axis comes straight from its extents: its
+// center projects to the middle of the range, and each of its own axes adds
+// its extent times how far it leans along the axis.  The points at each end
+// are the middles of the faces, edges or vertices that project there - any
+// box axis within tolerance of right angles to the axis leaves a whole face
+// or edge at the end.  None of it touches the heap.
+static const float PROJECTION_TOLERANCE = 0.0001f;
+// cross products of box axes shorter than this come from nearly parallel
+// axes, and don't give a direction worth testing
+static const float DEGENERATE_AXIS = 0.000001f;
+
+struct Projection
 {
-	// type check
-	const Geometry::Plane* plane = dynamic_cast<const Geometry::Plane*>(&a_shape1);
-	const Geometry::Box* box = dynamic_cast<const Geometry::Box*>(&a_shape2);
-	if (nullptr == plane || nullptr == box)
-		return false;
+	float min;
+	float max;
+	glm::vec3 minPoint;
+	glm::vec3 maxPoint;
+};
 
+static void ProjectBox(const Geometry::Box& a_box, const glm::vec3& a_axis, Projection& a_projection)
+{
+	float center = glm::dot(a_axis, a_box.position);
+	float radius = 0;
+	glm::vec3 offset(0);	// from the center to the middle of the feature furthest along the axis
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		float lean = glm::dot(a_axis, a_box.axis(i)) * a_box.extents[i];
+		radius += fabs(lean);
+		if (PROJECTION_TOLERANCE < fabs(lean) * 2)
+			offset += a_box.axis(i) * (0 > lean ? -a_box.extents[i] : a_box.extents[i]);
+	}
+	a_projection.min = center - radius;
+	a_projection.max = center + radius;
+	a_projection.minPoint = a_box.position - offset;
+	a_projection.maxPoint = a_box.position + offset;
+}
+
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::Box& a_box,
+					   Geometry::Collision* a_collision)
+{
 	// get distances from plane to vertices, with positive distances in the normal
 	// direction and negative distances in the opposite direction
-	glm::vec3 normal = plane->normal();
-	float max, min;
-	glm::vec3 minPoint, maxPoint;
-	GetMinAndMax(box->vertices(),
-				 [&](const glm::vec3& a_point)
-				 {
-					return glm::dot(normal, a_point - plane->position);
-				 },
-				 min, max, minPoint, maxPoint);
+	glm::vec3 normal = a_plane.normal();
+	Projection projection;
+	ProjectBox(a_box, normal, projection);
+	float offset = glm::dot(normal, a_plane.position);
+	float min = projection.min - offset;
+	float max = projection.max - offset;
+	const glm::vec3& minPoint = projection.minPoint;
+	const glm::vec3& maxPoint = projection.maxPoint;
 
 	// if there are points on both sides, there's an intersection
 	if (0 >= max * min)
 	{
 		if (nullptr != a_collision)
 		{
-			a_collision->shape1(a_shape1);
-			a_collision->shape2(a_shape2);
+			a_collision->shape1 = &a_plane;
+			a_collision->shape2 = &a_box;
 			a_collision->normal = normal * (fabs(min) > max ? -1.0f : 1.0f);
 			a_collision->interpenetration = fmin(fabs(min), max);
 			glm::vec3 p = (fabs(min) > max ? maxPoint : minPoint);
@@ -244,152 +266,1161 @@ bool PlaneBox(const Geometry& a_shape1, const Geometry& a_shape2,
 	return false;
 }
 
-bool SphereSphere(const Geometry& a_shape1, const Geometry& a_shape2,
-				  Geometry::Collision* a_collision)
+template<typename Real>
+bool Geometry::DetectSpheres(const typename Precision<Real>::vec3& a_center1, Real a_radius1,
+							 const typename Precision<Real>::vec3& a_center2, Real a_radius2,
+							 BasicContact<Real>* a_contact)
 {
-	// type check
-	const Geometry::Sphere* sphere1 = dynamic_cast<const Geometry::Sphere*>(&a_shape1);
-	const Geometry::Sphere* sphere2 = dynamic_cast<const Geometry::Sphere*>(&a_shape2);
-	if (nullptr == sphere1 || nullptr == sphere2)
-		return false;
-
 	// spheres collide if center-center distance is <= sum of radii
-	float squareDistance = glm::distance2(sphere1->position, sphere2->position);
-	float collisionDistance = sphere1->radius + sphere2->radius;
+	Real squareDistance = glm::distance2(a_center1, a_center2);
+	Real collisionDistance = a_radius1 + a_radius2;
 	if (squareDistance <= collisionDistance*collisionDistance)
 	{
-		if (nullptr != a_collision)
+		if (nullptr != a_contact)
 		{
-			a_collision->shape1(a_shape1);
-			a_collision->shape2(a_shape2);
-			a_collision->normal = glm::normalize(sphere2->position - sphere1->position);
-			a_collision->interpenetration = collisionDistance - sqrt(squareDistance);
-			float d = sphere1->radius - a_collision->interpenetration / 2;
-			a_collision->point = sphere1->position + a_collision->normal * d;
+			typename Precision<Real>::vec3 centerToCenter = a_center2 - a_center1;
+			a_contact->normal = Normalize(centerToCenter);
+			a_contact->interpenetration = collisionDistance - Length(centerToCenter);
+			Real d = a_radius1 - a_contact->interpenetration / 2;
+			a_contact->point = a_center1 + a_contact->normal * d;
 		}
 		return true;
 	}
 	return false;
 }
+template bool Geometry::DetectSpheres<float>(const glm::vec3&, float, const glm::vec3&, float, BasicContact<float>*);
+template bool Geometry::DetectSpheres<double>(const glm::dvec3&, double, const glm::dvec3&, double,
+											  BasicContact<double>*);
 
-bool SphereBox(const Geometry& a_shape1, const Geometry& a_shape2,
-			   Geometry::Collision* a_collision)
+template<> bool Detect(const Geometry::Sphere& a_sphere1, const Geometry::Sphere& a_sphere2,
+					   Geometry::Collision* a_collision)
 {
-	// type check
-	const Geometry::Sphere* sphere = dynamic_cast<const Geometry::Sphere*>(&a_shape1);
-	const Geometry::Box* box = dynamic_cast<const Geometry::Box*>(&a_shape2);
-	if (nullptr == sphere || nullptr == box)
+	Geometry::BasicContact<float> contact;
+	if (!Geometry::DetectSpheres(a_sphere1.position, a_sphere1.radius, a_sphere2.position, a_sphere2.radius,
+								 nullptr != a_collision ? &contact : nullptr))
 		return false;
+	if (nullptr != a_collision)
+	{
+		a_collision->shape1 = &a_sphere1;
+		a_collision->shape2 = &a_sphere2;
+		a_collision->normal = contact.normal;
+		a_collision->interpenetration = contact.interpenetration;
+		a_collision->point = contact.point;
+	}
+	return true;
+}
+
+// An unrotated box is its own bounding box, so the sphere's center is
+// clamped to its corners directly, with no trip into the box's coordinates
+// and back.  The normal and depth match what the general case gives.
+static bool DetectAligned(const Geometry::Sphere& a_sphere, const Geometry::Box& a_box,
+						  Geometry::Collision* a_collision)
+{
+	glm::vec3 min = a_box.position - a_box.extents;
+	glm::vec3 max = a_box.position + a_box.extents;
+	glm::vec3 closestPoint = glm::clamp(a_sphere.position, min, max);
+	glm::vec3 offset = closestPoint - a_sphere.position;
+	bool inside = (glm::vec3(0) == offset);
+	float distance2 = glm::length2(offset);
+	if (!inside && distance2 > a_sphere.radius * a_sphere.radius)
+		return false;
+	if (nullptr == a_collision)
+		return true;
+
+	// from inside, the nearest face is the way out - even from right on it
+	glm::vec3 normal;
+	float distance;
+	if (inside)
+	{
+		glm::vec3 toMin = a_sphere.position - min;
+		glm::vec3 toMax = max - a_sphere.position;
+		unsigned int axis = 0;
+		distance = FLT_MAX;
+		for (unsigned int i = 0; i < 3; ++i)
+		{
+			float nearest = fmin(toMin[i], toMax[i]);
+			if (nearest < distance)
+			{
+				distance = nearest;
+				axis = i;
+			}
+		}
+		normal = glm::vec3(0);
+		normal[axis] = (toMin[axis] < toMax[axis] ? 1.0f : -1.0f);
+	}
+	else
+	{
+		normal = Geometry::Normalize(offset);
+		distance = Geometry::Length(offset);
+	}
+	a_collision->shape1 = &a_sphere;
+	a_collision->shape2 = &a_box;
+	a_collision->normal = normal;
+	a_collision->interpenetration = a_sphere.radius + (inside ? distance : -distance);
+	float d = a_sphere.radius - a_collision->interpenetration / 2;
+	a_collision->point = a_sphere.position + normal * d;
+	return true;
+}
+
+template<> bool Detect(const Geometry::Sphere& a_sphere, const Geometry::Box& a_box,
+					   Geometry::Collision* a_collision)
+{
+	if (a_box.isAxisAligned())
+		return DetectAligned(a_sphere, a_box, a_collision);
 
 	// find closest point on box surface
-	bool inside = box->Contains(sphere->position);
-	glm::vec3 closestPoint = box->ClosestSurfacePointTo(sphere->position);
+	bool inside = a_box.Contains(a_sphere.position);
+	glm::vec3 closestPoint = a_box.ClosestSurfacePointTo(a_sphere.position);
 
 	// if sphere center is inside box or no more than a radius away from the nearest surface point,
 	// then there's a collision.
-	if (inside || sphere->Contains(closestPoint))
+	if (inside || a_sphere.Contains(closestPoint))
 	{
 		if (nullptr != a_collision)
 		{
-			a_collision->shape1(a_shape1);
-			a_collision->shape2(a_shape2);
+			a_collision->shape1 = &a_sphere;
+			a_collision->shape2 = &a_box;
 			a_collision->normal =
-				glm::normalize(closestPoint - sphere->position) * (inside ? -1.0f : 1.0f);
-			a_collision->interpenetration = sphere->radius +
-				(glm::distance(closestPoint, sphere->position) * (inside ? 1 : -1));
-			float d = sphere->radius - a_collision->interpenetration / 2;
-			a_collision->point = sphere->position + a_collision->normal * d;
+				Geometry::Normalize(closestPoint - a_sphere.position) * (inside ? -1.0f : 1.0f);
+			a_collision->interpenetration = a_sphere.radius +
+				(Geometry::Length(closestPoint - a_sphere.position) * (inside ? 1 : -1));
+			float d = a_sphere.radius - a_collision->interpenetration / 2;
+			a_collision->point = a_sphere.position + a_collision->normal * d;
 		}
 		return true;
 	}
 	return false;
 }
 
-// negative value = no overlap
-static float ProjectionOverlap(const glm::vec3& a_axis,
-							   const std::vector<glm::vec3>& a_group1,
-							   const std::vector<glm::vec3>& a_group2,
-							   glm::vec3& a_midPoint)
+// Box/box contacts come from the axis the boxes overlap least along.  On a
+// face axis, the face of the other box that faces it most directly is
+// clipped to the sides of that reference face, and every clipped corner
+// below it touches - so a box resting on another gets a point under each
+// corner rather than one somewhere in the middle.  On an edge/edge axis the
+// boxes touch at the closest points of the two edges.
+
+// an edge/edge axis has to beat the face axes by this share to be used, so
+// resting boxes don't flip between face and edge contacts
+static const float EDGE_PREFERENCE = 0.95f;
+// most points a clipped face can have - a quad clipped by four planes has
+// eight, and a hull's face with more corners than this is cut short
+static const unsigned int MAX_CLIPPED = 16;
+
+static float BoxRadius(const Geometry::Box& a_box, const glm::vec3& a_axis)
+{
+	return fabs(glm::dot(a_axis, a_box.axis(0))) * a_box.extents.x +
+		   fabs(glm::dot(a_axis, a_box.axis(1))) * a_box.extents.y +
+		   fabs(glm::dot(a_axis, a_box.axis(2))) * a_box.extents.z;
+}
+
+// scale a candidate axis to unit length - without fast math this divides by
+// the exact square root, so the exact results are unchanged
+static glm::vec3 ToUnit(const glm::vec3& a_axis, float a_length2)
 {
-	float min1, min2, max1, max2;
-	glm::vec3 minPoint1, minPoint2, maxPoint1, maxPoint2;
-	auto project = [&](const glm::vec3& a_point)
+	return (Geometry::IsFastMath() ? a_axis * Geometry::InverseSqrt(a_length2)
+								   : a_axis / sqrt(a_length2));
+}
+
+// separating axis test between two boxes, one axis at a time so that the
+// first axis that separates them ends it - the face axes and the edge/edge
+// axes each keep the one the boxes overlap least along
+struct BoxBoxTest
+{
+	const Geometry::Box& box1;
+	const Geometry::Box& box2;
+	glm::vec3 centerToCenter;
+	float faceOverlap;
+	glm::vec3 faceNormal;	// from box1 to box2
+	const Geometry::Box* faceBox;	// whose face it is
+	unsigned int faceAxis;
+	float edgeOverlap;
+	glm::vec3 edgeNormal;
+	unsigned int edgeAxis1;	// axes of each box the edges run along
+	unsigned int edgeAxis2;
+
+	BoxBoxTest(const Geometry::Box& a_box1, const Geometry::Box& a_box2)
+		: box1(a_box1), box2(a_box2), centerToCenter(a_box2.position - a_box1.position),
+		  faceOverlap(FLT_MAX), faceNormal(0), faceBox(nullptr), faceAxis(0),
+		  edgeOverlap(FLT_MAX), edgeNormal(0), edgeAxis1(0), edgeAxis2(0) {}
+
+	// of the boxes' projections onto a unit axis - negative if they don't
+	float Overlap(const glm::vec3& a_axis) const
 	{
-		return glm::dot(a_axis, a_point);
-	};
-	GetMinAndMax(a_group1, project, min1, max1, minPoint1, maxPoint1);
-	GetMinAndMax(a_group2, project, min2, max2, minPoint2, maxPoint2);
-	bool group1First = fabs(max1 - min2) < fabs(max2 - min1);
-	a_midPoint = (group1First ? maxPoint1 + minPoint2 : maxPoint2 + minPoint1) * 0.5f;
-	return (group1First ? max1 - min2 : max2 - min1);
+		return BoxRadius(box1, a_axis) + BoxRadius(box2, a_axis) -
+			   fabs(glm::dot(a_axis, centerToCenter));
+	}
+	glm::vec3 FromBox1(const glm::vec3& a_axis) const
+	{
+		return (0 > glm::dot(centerToCenter, a_axis) ? -a_axis : a_axis);
+	}
+
+	// each returns false if the boxes' projections onto the axis don't overlap
+	bool TestCenters() const
+	{
+		float length2 = glm::length2(centerToCenter);
+		return (DEGENERATE_AXIS > length2 || 0 <= Overlap(ToUnit(centerToCenter, length2)));
+	}
+	bool TestFace(const Geometry::Box& a_box, unsigned int a_axis)
+	{
+		float overlap = Overlap(a_box.axis(a_axis));
+		if (0 > overlap)
+			return false;
+		if (overlap < faceOverlap)
+		{
+			faceOverlap = overlap;
+			faceNormal = FromBox1(a_box.axis(a_axis));
+			faceBox = &a_box;
+			faceAxis = a_axis;
+		}
+		return true;
+	}
+	bool TestEdges(unsigned int a_axis1, unsigned int a_axis2)
+	{
+		glm::vec3 axis = glm::cross(box1.axis(a_axis1), box2.axis(a_axis2));
+		float length2 = glm::length2(axis);
+		if (DEGENERATE_AXIS > length2)
+			return true;
+		axis = ToUnit(axis, length2);
+		float overlap = Overlap(axis);
+		if (0 > overlap)
+			return false;
+		if (overlap < edgeOverlap)
+		{
+			edgeOverlap = overlap;
+			edgeNormal = FromBox1(axis);
+			edgeAxis1 = a_axis1;
+			edgeAxis2 = a_axis2;
+		}
+		return true;
+	}
+};
+
+// keeps the points of a polygon on the inside of a plane, adding the points
+// where its edges cross it
+static unsigned int ClipPolygon(const glm::vec3* a_points, unsigned int a_count,
+								const glm::vec3& a_normal, float a_offset, glm::vec3* a_clipped)
+{
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < a_count && count < MAX_CLIPPED; ++i)
+	{
+		const glm::vec3& point1 = a_points[i];
+		const glm::vec3& point2 = a_points[(i + 1) % a_count];
+		float distance1 = glm::dot(a_normal, point1) - a_offset;
+		float distance2 = glm::dot(a_normal, point2) - a_offset;
+		if (0 >= distance1)
+			a_clipped[count++] = point1;
+		if ((0 > distance1) != (0 > distance2) && count < MAX_CLIPPED)
+			a_clipped[count++] = point1 + (point2 - point1) * (distance1 / (distance1 - distance2));
+	}
+	return count;
 }
 
-bool BoxBox(const Geometry& a_shape1, const Geometry& a_shape2,
-			Geometry::Collision* a_collision)
+// cuts a_count points down to the four that cover the most area - the
+// deepest, the one furthest from it, and the ones furthest out to either side
+// of the line between them
+static unsigned int ReducePoints(glm::vec3* a_points, float* a_depths, unsigned int a_count,
+								 const glm::vec3& a_normal)
 {
-	// type check
-	const Geometry::Box* box1 = dynamic_cast<const Geometry::Box*>(&a_shape1);
-	const Geometry::Box* box2 = dynamic_cast<const Geometry::Box*>(&a_shape2);
-	if (nullptr == box1 || nullptr == box2)
-		return false;
+	if (Geometry::Collision::MAX_POINTS >= a_count)
+		return a_count;
+	unsigned int chosen[Geometry::Collision::MAX_POINTS] = { 0, 0, 0, 0 };
+	for (unsigned int i = 1; i < a_count; ++i)
+	{
+		if (a_depths[i] > a_depths[chosen[0]])
+			chosen[0] = i;
+	}
+	float furthest = -1;
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		float distance2 = glm::distance2(a_points[i], a_points[chosen[0]]);
+		if (distance2 > furthest)
+		{
+			furthest = distance2;
+			chosen[1] = i;
+		}
+	}
+	float maxArea = -FLT_MAX, minArea = FLT_MAX;
+	glm::vec3 line = a_points[chosen[1]] - a_points[chosen[0]];
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		float area = glm::dot(glm::cross(line, a_points[i] - a_points[chosen[0]]), a_normal);
+		if (area > maxArea)
+		{
+			maxArea = area;
+			chosen[2] = i;
+		}
+		if (area < minArea)
+		{
+			minArea = area;
+			chosen[3] = i;
+		}
+	}
+	glm::vec3 points[Geometry::Collision::MAX_POINTS];
+	float depths[Geometry::Collision::MAX_POINTS];
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < Geometry::Collision::MAX_POINTS; ++i)
+	{
+		bool repeated = false;
+		for (unsigned int j = 0; j < i; ++j)
+			repeated = repeated || chosen[j] == chosen[i];
+		if (repeated)
+			continue;
+		points[count] = a_points[chosen[i]];
+		depths[count++] = a_depths[chosen[i]];
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		a_points[i] = points[i];
+		a_depths[i] = depths[i];
+	}
+	return count;
+}
+
+// the points of a clipped polygon below the reference face, each moved
+// halfway to its surface
+static void KeepBelowFace(const glm::vec3* a_polygon, unsigned int a_count,
+						  const glm::vec3& a_normal, float a_offset, Geometry::Collision* a_collision)
+{
+	glm::vec3 points[MAX_CLIPPED];
+	float depths[MAX_CLIPPED];
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		float depth = a_offset - glm::dot(a_normal, a_polygon[i]);
+		if (0 > depth)
+			continue;
+		points[kept] = a_polygon[i] + a_normal * (depth / 2);
+		depths[kept++] = depth;
+	}
+	kept = ReducePoints(points, depths, kept, a_normal);
+	for (unsigned int i = 0; i < kept; ++i)
+	{
+		a_collision->points[i] = points[i];
+		a_collision->depths[i] = depths[i];
+	}
+	a_collision->pointCount = kept;
+}
+
+// a_normal points from the reference box's face towards the incident box
+static void ClipFaces(const Geometry::Box& a_reference, unsigned int a_axis, const glm::vec3& a_normal,
+					  const Geometry::Box& a_incident, Geometry::Collision* a_collision)
+{
+	// the incident face is the one facing most directly against the normal
+	unsigned int incidentAxis = 0;
+	float mostAligned = -1;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		float aligned = fabs(glm::dot(a_incident.axis(i), a_normal));
+		if (aligned > mostAligned)
+		{
+			mostAligned = aligned;
+			incidentAxis = i;
+		}
+	}
+	glm::vec3 incidentNormal = a_incident.axis(incidentAxis);
+	if (0 < glm::dot(incidentNormal, a_normal))
+		incidentNormal = -incidentNormal;
+	unsigned int axis1 = (incidentAxis + 1) % 3, axis2 = (incidentAxis + 2) % 3;
+	glm::vec3 center = a_incident.position + incidentNormal * a_incident.extents[incidentAxis];
+	glm::vec3 side1 = a_incident.axis(axis1) * a_incident.extents[axis1];
+	glm::vec3 side2 = a_incident.axis(axis2) * a_incident.extents[axis2];
+	glm::vec3 polygon[MAX_CLIPPED] = { center + side1 + side2, center - side1 + side2,
+									   center - side1 - side2, center + side1 - side2 };
+	unsigned int count = 4;
+
+	// clip it to the four sides of the reference face
+	glm::vec3 clipped[MAX_CLIPPED];
+	for (unsigned int i = 1; i < 3 && 0 < count; ++i)
+	{
+		const glm::vec3& side = a_reference.axis((a_axis + i) % 3);
+		float offset = glm::dot(side, a_reference.position);
+		float extent = a_reference.extents[(a_axis + i) % 3];
+		count = ClipPolygon(polygon, count, side, offset + extent, clipped);
+		count = ClipPolygon(clipped, count, -side, extent - offset, polygon);
+	}
+
+	// and keep the points below the reference face
+	float faceOffset = glm::dot(a_normal, a_reference.position) + a_reference.extents[a_axis];
+	KeepBelowFace(polygon, count, a_normal, faceOffset, a_collision);
+}
+
+// the edges of each box along the given axes that are furthest towards the
+// other box, and the point halfway between their closest points
+static glm::vec3 ClosestEdgePoint(const Geometry::Box& a_box1, unsigned int a_axis1,
+								  const Geometry::Box& a_box2, unsigned int a_axis2,
+								  const glm::vec3& a_normal)
+{
+	glm::vec3 middle1 = a_box1.position, middle2 = a_box2.position;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (i != a_axis1)
+			middle1 += a_box1.axis(i) * (0 > glm::dot(a_normal, a_box1.axis(i)) ?
+										 -a_box1.extents[i] : a_box1.extents[i]);
+		if (i != a_axis2)
+			middle2 += a_box2.axis(i) * (0 < glm::dot(a_normal, a_box2.axis(i)) ?
+										 -a_box2.extents[i] : a_box2.extents[i]);
+	}
+	const glm::vec3& direction1 = a_box1.axis(a_axis1);
+	const glm::vec3& direction2 = a_box2.axis(a_axis2);
+	glm::vec3 offset = middle1 - middle2;
+	float b = glm::dot(direction1, direction2);
+	float c = glm::dot(direction1, offset);
+	float f = glm::dot(direction2, offset);
+	float denominator = 1 - b * b;	// the axes aren't parallel, or they wouldn't have been tested
+	float s = glm::clamp((b * f - c) / denominator, -a_box1.extents[a_axis1], a_box1.extents[a_axis1]);
+	float t = glm::clamp((f - b * c) / denominator, -a_box2.extents[a_axis2], a_box2.extents[a_axis2]);
+	return ((middle1 + direction1 * s) + (middle2 + direction2 * t)) * 0.5f;
+}
+
+template<> bool Detect(const Geometry::Box& a_box1, const Geometry::Box& a_box2,
+					   Geometry::Collision* a_collision)
+{
+	// two unrotated boxes are their own bounding boxes, so comparing corners
+	// settles whether they touch - only a contact needs the full test
+	if (a_box1.isAxisAligned() && a_box2.isAxisAligned())
+	{
+		glm::vec3 gap = glm::abs(a_box2.position - a_box1.position) - (a_box1.extents + a_box2.extents);
+		if (0 < gap.x || 0 < gap.y || 0 < gap.z)
+			return false;
+		if (nullptr == a_collision)
+			return true;
+	}
 
 	// first check - generalize to sphere to avoid unneccessary calculations
-	float d = glm::distance(box1->extents, glm::vec3(0)) +
-		glm::distance(box2->extents, glm::vec3(0));
-	if (d*d < glm::distance2(box1->position, box2->position))
+	float d = glm::distance(a_box1.extents, glm::vec3(0)) +
+		glm::distance(a_box2.extents, glm::vec3(0));
+	if (d*d < glm::distance2(a_box1.position, a_box2.position))
 		return false;
 
-	// get all the axes to test for separation
-	glm::vec3 centerToCenterAxis = glm::normalize(box2->position - box1->position);
-	std::vector<glm::vec3> axes;
-	axes.push_back(centerToCenterAxis);
+	// test the line between the centers, each box's axes and the cross
+	// products of their axes for separation
+	BoxBoxTest test(a_box1, a_box2);
+	if (!test.TestCenters())
+		return false;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (!test.TestFace(a_box1, i) || !test.TestFace(a_box2, i))
+			return false;
+	}
 	for (unsigned int i = 0; i < 3; ++i)
 	{
-		axes.push_back(box1->axis(i));
-		axes.push_back(box2->axis(i));
 		for (unsigned int j = 0; j < 3; ++j)
-			axes.push_back(glm::cross(box1->axis(i), box2->axis(j)));
+		{
+			if (!test.TestEdges(i, j))
+				return false;
+		}
 	}
+	if (nullptr == a_collision)
+		return true;
 
-	// test for separation
-	auto vertices1 = box1->vertices();
-	auto vertices2 = box2->vertices();
-	float interpenetration = 0;
-	glm::vec3 midPoint;
-	glm::vec3 normal;
-	bool start = true;
-	for (auto axis : axes)
+	// if the projections of each box onto each possible axis always overlap,
+	// then the boxes intersect
+	a_collision->shape1 = &a_box1;
+	a_collision->shape2 = &a_box2;
+	if (test.edgeOverlap < test.faceOverlap * EDGE_PREFERENCE)
+	{
+		a_collision->normal = test.edgeNormal;
+		a_collision->interpenetration = test.edgeOverlap;
+		a_collision->points[0] = ClosestEdgePoint(a_box1, test.edgeAxis1, a_box2, test.edgeAxis2,
+												  test.edgeNormal);
+		a_collision->depths[0] = test.edgeOverlap;
+		a_collision->pointCount = 1;
+	}
+	else
 	{
-		// test for projection overlap along each axis
-		glm::vec3 p;
-		float overlap = ProjectionOverlap(axis, vertices1, vertices2, p);
+		a_collision->normal = test.faceNormal;
+		a_collision->interpenetration = test.faceOverlap;
+		if (&a_box1 == test.faceBox)
+			ClipFaces(a_box1, test.faceAxis, test.faceNormal, a_box2, a_collision);
+		else
+			ClipFaces(a_box2, test.faceAxis, -test.faceNormal, a_box1, a_collision);
+	}
+	if (0 == a_collision->pointCount)
+	{
+		// only rounding can clip every point away - fall back on the middle
+		// of the overlap between the boxes' centers
+		a_collision->points[0] = a_box1.position + test.centerToCenter * 0.5f;
+		a_collision->depths[0] = a_collision->interpenetration;
+		a_collision->pointCount = 1;
+	}
+	a_collision->point = glm::vec3(0);
+	for (unsigned int i = 0; i < a_collision->pointCount; ++i)
+		a_collision->point += a_collision->points[i];
+	a_collision->point /= (float)a_collision->pointCount;
+	return true;
+}
 
-		// if there is no overlap, then there is no collision
-		if (0 > overlap)
+// Hulls are tested with GJK, which finds how far apart two convex shapes are
+// from nothing but the point of each that's furthest along a direction, and
+// EPA, which finds how far they've sunk into each other once GJK finds they
+// overlap.  Both work on the shapes' Minkowski difference - every point of
+// shape1 minus every point of shape2 - which holds the origin exactly when
+// they overlap.  A sphere goes in as its center, with its radius as a margin
+// around it, so it only needs EPA once its center is inside the hull.  The
+// search starts from the collision's separatingAxis, and for shapes that
+// have barely moved since the last step, that's usually already the answer.
+static const unsigned int GJK_ITERATIONS = 32;
+// GJK stops once the next point gets it no closer than this share of the
+// distance, and EPA once its next point is no further out than this
+static const float GJK_TOLERANCE = 0.0001f;
+// rounding keeps GJK from getting much nearer than this to an origin on or
+// just inside the difference's surface, so any nearer counts as touching
+static const float GJK_CONTACT = 0.0001f;
+static const float EPA_TOLERANCE = 0.0001f;
+static const unsigned int EPA_ITERATIONS = 32;
+// room for the points, triangles and horizon edges of EPA's polytope, so it
+// never touches the heap - it stops growing when it runs out
+static const unsigned int EPA_MAX_POINTS = 40;
+static const unsigned int EPA_MAX_FACES = 96;
+static const unsigned int EPA_MAX_EDGES = 48;
+// a reference face has to be this close to the direction the shapes are
+// pushed apart in for their contact to be clipped from faces
+static const float FACE_CONTACT = 0.95f;
+
+// the furthest point along a direction - just the center for a sphere
+static glm::vec3 Support(const Geometry::Sphere& a_sphere, const glm::vec3&)
+{
+	return a_sphere.position;
+}
+static glm::vec3 Support(const Geometry::Box& a_box, const glm::vec3& a_direction)
+{
+	glm::vec3 point = a_box.position;
+	for (unsigned int i = 0; i < 3; ++i)
+		point += a_box.axis(i) * (0 > glm::dot(a_direction, a_box.axis(i)) ? -a_box.extents[i] : a_box.extents[i]);
+	return point;
+}
+static glm::vec3 Support(const Geometry::ConvexHull& a_hull, const glm::vec3& a_direction)
+{
+	return a_hull.Support(a_direction);
+}
+
+// a point of the Minkowski difference and the points of each shape it's from
+struct SupportPoint
+{
+	glm::vec3 point;
+	glm::vec3 point1;
+	glm::vec3 point2;
+};
+template<typename Shape1, typename Shape2>
+static SupportPoint SupportOf(const Shape1& a_shape1, const Shape2& a_shape2, const glm::vec3& a_direction)
+{
+	SupportPoint support;
+	support.point1 = Support(a_shape1, a_direction);
+	support.point2 = Support(a_shape2, -a_direction);
+	support.point = support.point1 - support.point2;
+	return support;
+}
+
+// up to four points, with the weights that give the point closest to the origin
+struct Simplex
+{
+	SupportPoint points[4];
+	float weights[4];
+	unsigned int count;
+
+	glm::vec3 Keep(const SupportPoint& a_point)
+	{
+		points[0] = a_point;
+		weights[0] = 1;
+		count = 1;
+		return a_point.point;
+	}
+	glm::vec3 Keep(const SupportPoint& a_point1, const SupportPoint& a_point2, float a_t)
+	{
+		points[0] = a_point1;
+		points[1] = a_point2;
+		weights[0] = 1 - a_t;
+		weights[1] = a_t;
+		count = 2;
+		return a_point1.point + (a_point2.point - a_point1.point) * a_t;
+	}
+	// the closest points of each shape
+	void Witnesses(glm::vec3& a_point1, glm::vec3& a_point2) const
+	{
+		a_point1 = a_point2 = glm::vec3(0);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			a_point1 += points[i].point1 * weights[i];
+			a_point2 += points[i].point2 * weights[i];
+		}
+	}
+};
+
+// closest point to the origin on a segment or triangle, keeping only the
+// corners of the feature it's on - the triangle's regions are tested in turn
+// as Ericson has it
+static glm::vec3 ClosestOnSegment(const SupportPoint& a_a, const SupportPoint& a_b, Simplex& a_result)
+{
+	glm::vec3 ab = a_b.point - a_a.point;
+	float t = -glm::dot(a_a.point, ab);
+	if (0 >= t)
+		return a_result.Keep(a_a);
+	float length2 = glm::length2(ab);
+	if (t >= length2)
+		return a_result.Keep(a_b);
+	return a_result.Keep(a_a, a_b, t / length2);
+}
+static glm::vec3 ClosestOnTriangle(const SupportPoint& a_a, const SupportPoint& a_b, const SupportPoint& a_c,
+								   Simplex& a_result)
+{
+	glm::vec3 ab = a_b.point - a_a.point, ac = a_c.point - a_a.point;
+	float d1 = -glm::dot(ab, a_a.point), d2 = -glm::dot(ac, a_a.point);
+	if (0 >= d1 && 0 >= d2)
+		return a_result.Keep(a_a);
+	float d3 = -glm::dot(ab, a_b.point), d4 = -glm::dot(ac, a_b.point);
+	if (0 <= d3 && d4 <= d3)
+		return a_result.Keep(a_b);
+	float vc = d1 * d4 - d3 * d2;
+	if (0 >= vc && 0 <= d1 && 0 >= d3)
+		return a_result.Keep(a_a, a_b, d1 / (d1 - d3));
+	float d5 = -glm::dot(ab, a_c.point), d6 = -glm::dot(ac, a_c.point);
+	if (0 <= d6 && d5 <= d6)
+		return a_result.Keep(a_c);
+	float vb = d5 * d2 - d1 * d6;
+	if (0 >= vb && 0 <= d2 && 0 >= d6)
+		return a_result.Keep(a_a, a_c, d2 / (d2 - d6));
+	float va = d3 * d6 - d5 * d4;
+	if (0 >= va && 0 <= d4 - d3 && 0 <= d5 - d6)
+		return a_result.Keep(a_b, a_c, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	float denominator = va + vb + vc;
+	float v = vb / denominator, w = vc / denominator;
+	a_result.points[0] = a_a;
+	a_result.points[1] = a_b;
+	a_result.points[2] = a_c;
+	a_result.weights[0] = 1 - v - w;
+	a_result.weights[1] = v;
+	a_result.weights[2] = w;
+	a_result.count = 3;
+	return a_a.point + ab * v + ac * w;
+}
+// the closest point on the faces the origin is outside of, or the origin
+// itself if it's inside them all
+static glm::vec3 ClosestOnTetrahedron(Simplex& a_simplex)
+{
+	static const unsigned int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+	const SupportPoint* points = a_simplex.points;
+	Simplex closest, candidate;
+	glm::vec3 closestPoint(0);
+	float closestDistance2 = FLT_MAX;
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		const SupportPoint& a = points[faces[i][0]];
+		glm::vec3 normal = glm::cross(points[faces[i][1]].point - a.point, points[faces[i][2]].point - a.point);
+		float origin = -glm::dot(normal, a.point);
+		float opposite = glm::dot(normal, points[faces[i][3]].point - a.point);
+		if (0 != opposite && 0 <= origin * opposite)
+			continue;
+		glm::vec3 point = ClosestOnTriangle(a, points[faces[i][1]], points[faces[i][2]], candidate);
+		float distance2 = glm::length2(point);
+		if (distance2 < closestDistance2)
+		{
+			closestDistance2 = distance2;
+			closestPoint = point;
+			closest = candidate;
+		}
+	}
+	if (FLT_MAX != closestDistance2)
+		a_simplex = closest;
+	return closestPoint;
+}
+
+// Returns false once the shapes are found to be more than a_margin apart.
+// Otherwise a_distance is how far apart they are - zero if they overlap, when
+// a_simplex is left around the origin for EPA.  a_axis comes in as the
+// direction to start looking in and goes out as the last one looked in, both
+// from shape1 towards shape2.
+template<typename Shape1, typename Shape2>
+static bool Gjk(const Shape1& a_shape1, const Shape2& a_shape2, float a_margin,
+				glm::vec3& a_axis, Simplex& a_simplex, float& a_distance)
+{
+	// v is the closest point to the origin found so far
+	glm::vec3 v = -a_axis;
+	if (glm::vec3(0) == v)
+		v = a_shape1.position - a_shape2.position;
+	if (glm::vec3(0) == v)
+		v = glm::vec3(1, 0, 0);
+	a_simplex.count = 0;
+	a_distance = 0;
+	for (unsigned int i = 0; i < GJK_ITERATIONS; ++i)
+	{
+		SupportPoint support = SupportOf(a_shape1, a_shape2, -v);
+		float vDotW = glm::dot(v, support.point);
+		float length2 = glm::length2(v);
+		a_axis = -v;
+
+		// nothing in the difference comes nearer the origin than the margin
+		if (0 < vDotW && vDotW * vDotW > length2 * a_margin * a_margin)
 			return false;
 
-		// store the collision normal that provides the smallest interpenetration
-		if (start || overlap < interpenetration)
+		// no closer than v itself, so v is as close as it gets
+		bool repeated = false;
+		for (unsigned int j = 0; j < a_simplex.count; ++j)
+			repeated = repeated || a_simplex.points[j].point == support.point;
+		if (0 < a_simplex.count && (repeated || length2 - vDotW <= length2 * GJK_TOLERANCE))
+			break;
+
+		// near the surface, rounding can leave the new simplex further away -
+		// then the last one was as close as it gets
+		Simplex previous = a_simplex;
+		glm::vec3 closest = v;
+		a_simplex.points[a_simplex.count++] = support;
+		switch (a_simplex.count)
+		{
+		case 1: v = a_simplex.Keep(support); break;
+		case 2: v = ClosestOnSegment(a_simplex.points[0], a_simplex.points[1], a_simplex); break;
+		case 3: v = ClosestOnTriangle(a_simplex.points[0], a_simplex.points[1], a_simplex.points[2], a_simplex); break;
+		default: v = ClosestOnTetrahedron(a_simplex); break;
+		}
+		if (4 == a_simplex.count || GJK_CONTACT * GJK_CONTACT >= glm::length2(v))
+			return true;
+		if (0 < previous.count && glm::length2(v) >= length2)
+		{
+			a_simplex = previous;
+			v = closest;
+			break;
+		}
+	}
+	a_distance = glm::length(v);
+	a_axis = -v;
+	if (GJK_CONTACT >= a_distance)
+		a_distance = 0;
+	return a_distance <= a_margin;
+}
+
+// barycentric coordinates of a point in the plane of a triangle
+static glm::vec3 Barycentric(const glm::vec3& a_point, const glm::vec3& a_a, const glm::vec3& a_b,
+							 const glm::vec3& a_c)
+{
+	glm::vec3 ab = a_b - a_a, ac = a_c - a_a, ap = a_point - a_a;
+	float d00 = glm::dot(ab, ab), d01 = glm::dot(ab, ac), d11 = glm::dot(ac, ac);
+	float d20 = glm::dot(ap, ab), d21 = glm::dot(ap, ac);
+	float denominator = d00 * d11 - d01 * d01;
+	if (0 == denominator)
+		return glm::vec3(1, 0, 0);
+	float v = (d11 * d20 - d01 * d21) / denominator;
+	float w = (d00 * d21 - d01 * d20) / denominator;
+	return glm::vec3(1 - v - w, v, w);
+}
+
+struct EpaFace
+{
+	unsigned int corners[3];
+	glm::vec3 normal;	// outward
+	float distance;	// of its plane from the origin
+};
+
+// Grows a polytope inside the Minkowski difference out from GJK's simplex,
+// always pushing out its face closest to the origin, until that face is on
+// the difference's surface - the face's normal is the way to push the shapes
+// apart, and its distance how far.  Returns false if the shapes only just
+// touch, so there's no volume to grow it into.
+template<typename Shape1, typename Shape2>
+static bool Epa(const Shape1& a_shape1, const Shape2& a_shape2, const Simplex& a_simplex,
+				glm::vec3& a_normal, float& a_depth, glm::vec3& a_point1, glm::vec3& a_point2)
+{
+	SupportPoint points[EPA_MAX_POINTS];
+	unsigned int pointCount = a_simplex.count;
+	for (unsigned int i = 0; i < pointCount; ++i)
+		points[i] = a_simplex.points[i];
+
+	// a simplex that ended on a corner, edge or face of the difference is
+	// first blown up into a tetrahedron
+	static const glm::vec3 axes[3] = { glm::vec3(1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, 0, 1) };
+	for (unsigned int i = 0; i < 6 && 1 == pointCount; ++i)
+	{
+		SupportPoint support = SupportOf(a_shape1, a_shape2, axes[i / 2] * (0 == i % 2 ? 1.0f : -1.0f));
+		if (DEGENERATE_AXIS < glm::distance2(support.point, points[0].point))
+			points[pointCount++] = support;
+	}
+	if (2 == pointCount)
+	{
+		glm::vec3 line = points[1].point - points[0].point;
+		unsigned int least = 0;
+		for (unsigned int i = 1; i < 3; ++i)
+		{
+			if (fabs(line[i]) < fabs(line[least]))
+				least = i;
+		}
+		glm::vec3 across = glm::cross(line, axes[least]);
+		glm::vec3 directions[4] = { across, -across, glm::cross(line, across), -glm::cross(line, across) };
+		for (unsigned int i = 0; i < 4 && 2 == pointCount; ++i)
+		{
+			SupportPoint support = SupportOf(a_shape1, a_shape2, directions[i]);
+			if (DEGENERATE_AXIS < glm::length2(glm::cross(support.point - points[0].point, line)))
+				points[pointCount++] = support;
+		}
+	}
+	if (3 == pointCount)
+	{
+		glm::vec3 normal = glm::cross(points[1].point - points[0].point, points[2].point - points[0].point);
+		for (unsigned int i = 0; i < 2 && 3 == pointCount; ++i)
+		{
+			SupportPoint support = SupportOf(a_shape1, a_shape2, (0 == i ? normal : -normal));
+			if (DEGENERATE_AXIS < fabs(glm::dot(normal, support.point - points[0].point)))
+				points[pointCount++] = support;
+		}
+	}
+	if (4 != pointCount)
+		return false;
+
+	EpaFace faces[EPA_MAX_FACES];
+	unsigned int faceCount = 0;
+	glm::vec3 middle = (points[0].point + points[1].point + points[2].point + points[3].point) * 0.25f;
+	auto addFace = [&](unsigned int a_a, unsigned int a_b, unsigned int a_c)
+	{
+		EpaFace& face = faces[faceCount++];
+		face.corners[0] = a_a;
+		face.corners[1] = a_b;
+		face.corners[2] = a_c;
+		face.normal = glm::cross(points[a_b].point - points[a_a].point, points[a_c].point - points[a_a].point);
+		float length = glm::length(face.normal);
+		face.normal = (0 < length ? face.normal / length : glm::vec3(0));
+		face.distance = (0 < length ? glm::dot(face.normal, points[a_a].point) : FLT_MAX);
+	};
+	static const unsigned int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 } };
+	for (unsigned int i = 0; i < 4; ++i)
+	{
+		addFace(tetrahedron[i][0], tetrahedron[i][1], tetrahedron[i][2]);
+		EpaFace& face = faces[faceCount - 1];
+		if (0 < glm::dot(face.normal, middle - points[face.corners[0]].point))
+		{
+			std::swap(face.corners[1], face.corners[2]);
+			face.normal = -face.normal;
+			face.distance = -face.distance;
+		}
+	}
+
+	auto closestFace = [&]()
+	{
+		unsigned int closest = 0;
+		for (unsigned int i = 1; i < faceCount; ++i)
 		{
-			interpenetration = overlap;
-			normal = (0 > glm::dot(centerToCenterAxis, axis) ? -axis : axis);
-			midPoint = p;	// not even close to accurate, but I don't know how to get the right one
+			if (faces[i].distance < faces[closest].distance)
+				closest = i;
 		}
-		start = false;
+		return closest;
+	};
+	for (unsigned int i = 0; i < EPA_ITERATIONS && EPA_MAX_POINTS > pointCount; ++i)
+	{
+		const EpaFace& face = faces[closestFace()];
+		SupportPoint support = SupportOf(a_shape1, a_shape2, face.normal);
+		if (glm::dot(face.normal, support.point) - face.distance <= EPA_TOLERANCE)
+			break;
+
+		// every face the new point can see goes, leaving a hole whose rim is
+		// the edges only one of those faces had
+		bool visible[EPA_MAX_FACES];
+		unsigned int edges[EPA_MAX_EDGES][2];
+		unsigned int edgeCount = 0, removed = 0;
+		bool full = false;
+		for (unsigned int j = 0; j < faceCount && !full; ++j)
+		{
+			visible[j] = (0 < glm::dot(faces[j].normal, support.point - points[faces[j].corners[0]].point));
+			if (!visible[j])
+				continue;
+			++removed;
+			for (unsigned int k = 0; k < 3 && !full; ++k)
+			{
+				unsigned int from = faces[j].corners[k], to = faces[j].corners[(k + 1) % 3];
+				unsigned int shared = 0;
+				while (shared < edgeCount && !(edges[shared][0] == to && edges[shared][1] == from))
+					++shared;
+				if (shared < edgeCount)
+				{
+					edges[shared][0] = edges[edgeCount - 1][0];
+					edges[shared][1] = edges[--edgeCount][1];
+				}
+				else if (EPA_MAX_EDGES > edgeCount)
+				{
+					edges[edgeCount][0] = from;
+					edges[edgeCount++][1] = to;
+				}
+				else
+				{
+					full = true;
+				}
+			}
+		}
+		if (full || EPA_MAX_FACES < faceCount - removed + edgeCount)
+			break;
+
+		// which the new point closes up
+		unsigned int kept = 0;
+		for (unsigned int j = 0; j < faceCount; ++j)
+		{
+			if (!visible[j])
+				faces[kept++] = faces[j];
+		}
+		faceCount = kept;
+		points[pointCount] = support;
+		for (unsigned int j = 0; j < edgeCount; ++j)
+			addFace(edges[j][0], edges[j][1], pointCount);
+		++pointCount;
+	}
+	if (0 == faceCount)
+		return false;
+
+	// the shapes' own points under where the origin is closest to that face
+	const EpaFace& face = faces[closestFace()];
+	const SupportPoint& a = points[face.corners[0]];
+	const SupportPoint& b = points[face.corners[1]];
+	const SupportPoint& c = points[face.corners[2]];
+	glm::vec3 weights = Barycentric(face.normal * face.distance, a.point, b.point, c.point);
+	a_normal = face.normal;
+	a_depth = face.distance;
+	a_point1 = a.point1 * weights.x + b.point1 * weights.y + c.point1 * weights.z;
+	a_point2 = a.point2 * weights.x + b.point2 * weights.y + c.point2 * weights.z;
+	return true;
+}
+
+// the face of a box or hull facing most directly along a direction, with its
+// corners counterclockwise seen from outside
+struct ContactFace
+{
+	glm::vec3 normal;
+	glm::vec3 corners[MAX_CLIPPED];
+	unsigned int cornerCount;
+};
+
+static float FaceAlong(const Geometry::Box& a_box, const glm::vec3& a_direction, ContactFace& a_face)
+{
+	unsigned int axis = 0;
+	float mostAligned = -1;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		float aligned = fabs(glm::dot(a_box.axis(i), a_direction));
+		if (aligned > mostAligned)
+		{
+			mostAligned = aligned;
+			axis = i;
+		}
+	}
+	float side = (0 > glm::dot(a_box.axis(axis), a_direction) ? -1.0f : 1.0f);
+	unsigned int axis1 = (axis + 1) % 3, axis2 = (axis + 2) % 3;
+	glm::vec3 center = a_box.position + a_box.axis(axis) * (a_box.extents[axis] * side);
+	glm::vec3 side1 = a_box.axis(axis1) * a_box.extents[axis1];
+	glm::vec3 side2 = a_box.axis(axis2) * (a_box.extents[axis2] * side);
+	a_face.normal = a_box.axis(axis) * side;
+	a_face.corners[0] = center + side1 + side2;
+	a_face.corners[1] = center - side1 + side2;
+	a_face.corners[2] = center - side1 - side2;
+	a_face.corners[3] = center + side1 - side2;
+	a_face.cornerCount = 4;
+	return mostAligned;
+}
+static float FaceAlong(const Geometry::ConvexHull& a_hull, const glm::vec3& a_direction, ContactFace& a_face)
+{
+	const std::vector<Geometry::ConvexHull::Face>& faces = a_hull.faces();
+	if (faces.empty())
+		return -1;
+	glm::vec3 direction = a_hull.ToLocal(a_direction, true);
+	unsigned int best = 0;
+	for (unsigned int i = 1; i < faces.size(); ++i)
+	{
+		if (glm::dot(faces[i].normal, direction) > glm::dot(faces[best].normal, direction))
+			best = i;
+	}
+	const Geometry::ConvexHull::Face& face = faces[best];
+	a_face.normal = a_hull.ToWorld(face.normal, true);
+	a_face.cornerCount = (MAX_CLIPPED < face.cornerCount ? MAX_CLIPPED : face.cornerCount);
+	for (unsigned int i = 0; i < a_face.cornerCount; ++i)
+		a_face.corners[i] = a_hull.ToWorld(a_hull.corner(face, i));
+	return glm::dot(face.normal, direction);
+}
+
+// how far the other shape reaches past a face, against its normal
+template<typename Shape>
+static float FaceDepth(const ContactFace& a_face, const Shape& a_other)
+{
+	return glm::dot(a_face.normal, a_face.corners[0] - Support(a_other, -a_face.normal));
+}
+
+// the incident face clipped to the sides of the reference face, whose normal
+// points towards the incident shape, as box faces are clipped
+static void ClipContactFaces(const ContactFace& a_reference, const ContactFace& a_incident,
+							 Geometry::Collision* a_collision)
+{
+	glm::vec3 polygon[MAX_CLIPPED], clipped[MAX_CLIPPED];
+	unsigned int count = a_incident.cornerCount;
+	for (unsigned int i = 0; i < count; ++i)
+		polygon[i] = a_incident.corners[i];
+	for (unsigned int i = 0; i < a_reference.cornerCount && 0 < count; ++i)
+	{
+		const glm::vec3& corner = a_reference.corners[i];
+		glm::vec3 side = glm::cross(a_reference.corners[(i + 1) % a_reference.cornerCount] - corner,
+									a_reference.normal);
+		count = ClipPolygon(polygon, count, side, glm::dot(side, corner), clipped);
+		for (unsigned int j = 0; j < count; ++j)
+			polygon[j] = clipped[j];
 	}
+	KeepBelowFace(polygon, count, a_reference.normal, glm::dot(a_reference.normal, a_reference.corners[0]),
+				  a_collision);
+}
 
-	// make sure the collision normal points from the first box to the second
-	if (0 > glm::dot(normal, axes[0]))
-		normal *= -1;
+// boxes and hulls against hulls - where the shapes are pushed apart nearly
+// along one of their faces, the other's face against it is clipped to it,
+// and otherwise they touch at the one point EPA finds
+template<typename Shape1, typename Shape2>
+static bool DetectConvex(const Shape1& a_shape1, const Shape2& a_shape2, Geometry::Collision* a_collision)
+{
+	glm::vec3 axis = (nullptr != a_collision ? a_collision->separatingAxis : glm::vec3(0));
+	Simplex simplex;
+	float distance;
+	bool touching = Gjk(a_shape1, a_shape2, 0, axis, simplex, distance);
+	if (nullptr != a_collision)
+		a_collision->separatingAxis = axis;
+	if (!touching || nullptr == a_collision)
+		return touching;
 
-	// if the projections of each box onto each possible axis always overlap, then the boxes intersect
+	// shapes that only just touch push apart along the way GJK last looked
+	glm::vec3 normal, point1, point2;
+	float depth;
+	if (!Epa(a_shape1, a_shape2, simplex, normal, depth, point1, point2))
+	{
+		simplex.Witnesses(point1, point2);
+		normal = (glm::vec3(0) != axis ? glm::normalize(axis) :
+				  a_shape2.position == a_shape1.position ? glm::vec3(0, 1, 0) :
+				  glm::normalize(a_shape2.position - a_shape1.position));
+		depth = 0;
+	}
+	depth = fmax(depth, 0.0f);
+	a_collision->shape1 = &a_shape1;
+	a_collision->shape2 = &a_shape2;
+	a_collision->normal = normal;
+	a_collision->interpenetration = depth;
+	a_collision->separatingAxis = normal;
+
+	// a face is only used if the shapes overlap along it about as little as
+	// along EPA's normal, as box/box prefers face axes over edge/edge ones
+	ContactFace face1, face2, incident;
+	float aligned1 = FaceAlong(a_shape1, normal, face1);
+	float aligned2 = FaceAlong(a_shape2, -normal, face2);
+	if (FACE_CONTACT <= aligned1 && EDGE_PREFERENCE * FaceDepth(face1, a_shape2) > depth + GJK_TOLERANCE)
+		aligned1 = -1;
+	if (FACE_CONTACT <= aligned2 && EDGE_PREFERENCE * FaceDepth(face2, a_shape1) > depth + GJK_TOLERANCE)
+		aligned2 = -1;
+	if (FACE_CONTACT <= aligned1 && aligned1 >= aligned2)
+	{
+		FaceAlong(a_shape2, -face1.normal, incident);
+		a_collision->normal = face1.normal;
+		a_collision->interpenetration = FaceDepth(face1, a_shape2);
+		ClipContactFaces(face1, incident, a_collision);
+	}
+	else if (FACE_CONTACT <= aligned2)
+	{
+		FaceAlong(a_shape1, -face2.normal, incident);
+		a_collision->normal = -face2.normal;
+		a_collision->interpenetration = FaceDepth(face2, a_shape1);
+		ClipContactFaces(face2, incident, a_collision);
+	}
+	if (0 == a_collision->pointCount)
+	{
+		a_collision->points[0] = (point1 + point2) * 0.5f;
+		a_collision->depths[0] = depth;
+		a_collision->pointCount = 1;
+	}
+	a_collision->point = glm::vec3(0);
+	for (unsigned int i = 0; i < a_collision->pointCount; ++i)
+	{
+		a_collision->point += a_collision->points[i];
+		a_collision->interpenetration = fmax(a_collision->interpenetration, a_collision->depths[i]);
+	}
+	a_collision->point /= (float)a_collision->pointCount;
+	return true;
+}
+
+template<> bool Detect(const Geometry::Plane& a_plane, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision)
+{
+	// planes are infinite, so there's no furthest point for GJK - instead the
+	// hull's furthest points to either side say if it crosses the plane, as
+	// the corners of a box do
+	glm::vec3 normal = a_plane.normal();
+	float offset = glm::dot(normal, a_plane.position);
+	float min = glm::dot(normal, a_hull.Support(-normal)) - offset;
+	float max = glm::dot(normal, a_hull.Support(normal)) - offset;
+	if (0 < max * min)
+		return false;
+	if (nullptr == a_collision)
+		return true;
+
+	// pushed out the shorter way, touching where its face against the plane
+	// is below it
+	if (fabs(min) > max)
+	{
+		normal = -normal;
+		offset = -offset;
+	}
+	a_collision->shape1 = &a_plane;
+	a_collision->shape2 = &a_hull;
+	a_collision->normal = normal;
+	a_collision->interpenetration = fmin(fabs(min), max);
+	ContactFace face;
+	FaceAlong(a_hull, -normal, face);
+	KeepBelowFace(face.corners, face.cornerCount, -normal, -offset, a_collision);
+	for (unsigned int i = 0; i < a_collision->pointCount; ++i)
+		a_collision->points[i] -= normal * a_collision->depths[i];
+	if (0 == a_collision->pointCount)
+	{
+		glm::vec3 deepest = a_hull.Support(-normal);
+		a_collision->points[0] = deepest + normal * (a_collision->interpenetration * 0.5f);
+		a_collision->depths[0] = a_collision->interpenetration;
+		a_collision->pointCount = 1;
+	}
+	a_collision->point = glm::vec3(0);
+	for (unsigned int i = 0; i < a_collision->pointCount; ++i)
+		a_collision->point += a_collision->points[i];
+	a_collision->point /= (float)a_collision->pointCount;
+	return true;
+}
+
+template<> bool Detect(const Geometry::Sphere& a_sphere, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision)
+{
+	glm::vec3 axis = (nullptr != a_collision ? a_collision->separatingAxis : glm::vec3(0));
+	Simplex simplex;
+	float distance;
+	bool touching = Gjk(a_sphere, a_hull, a_sphere.radius, axis, simplex, distance);
 	if (nullptr != a_collision)
+		a_collision->separatingAxis = axis;
+	if (!touching || nullptr == a_collision)
+		return touching;
+
+	// with its center outside, the sphere touches within its radius of the
+	// closest point, and with it inside, it's pushed out past the nearest face
+	glm::vec3 normal, point1, point2;
+	float depth;
+	if (0 < distance)
 	{
-		a_collision->shape1(a_shape1);
-		a_collision->shape2(a_shape2);
-		a_collision->normal = normal;
-		a_collision->interpenetration = interpenetration;
-		a_collision->point = midPoint;
+		simplex.Witnesses(point1, point2);
+		normal = (point2 - point1) / distance;
+		depth = -distance;
 	}
+	else if (!Epa(a_sphere, a_hull, simplex, normal, depth, point1, point2))
+	{
+		normal = (glm::vec3(0) != axis ? glm::normalize(axis) :
+				  a_hull.position == a_sphere.position ? glm::vec3(0, 1, 0) :
+				  glm::normalize(a_hull.position - a_sphere.position));
+		depth = 0;
+	}
+	a_collision->shape1 = &a_sphere;
+	a_collision->shape2 = &a_hull;
+	a_collision->normal = normal;
+	a_collision->interpenetration = a_sphere.radius + depth;
+	a_collision->separatingAxis = normal;
+	float d = a_sphere.radius - a_collision->interpenetration / 2;
+	a_collision->point = a_sphere.position + a_collision->normal * d;
 	return true;
 }
+
+template<> bool Detect(const Geometry::Box& a_box, const Geometry::ConvexHull& a_hull,
+					   Geometry::Collision* a_collision)
+{
+	return DetectConvex(a_box, a_hull, a_collision);
+}
+
+template<> bool Detect(const Geometry::ConvexHull& a_hull1, const Geometry::ConvexHull& a_hull2,
+					   Geometry::Collision* a_collision)
+{
+	return DetectConvex(a_hull1, a_hull2, a_collision);
+}
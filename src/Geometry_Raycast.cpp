@@ -0,0 +1,254 @@
+#include "Geometry.h"
+
+//
+// Generic swept sphere
+//
+
+// Conservative advancement - step the sphere forward by the gap between it and
+// the closest point on the surface.  For a convex shape that step can never
+// carry the sphere past the surface, and the gap shrinks every iteration.
+bool Geometry::SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						  float a_radius, float a_maxDistance, float* a_distance,
+						  glm::vec3* a_normal) const
+{
+	const float tolerance = 0.0001f;
+	float t = 0;
+	for (unsigned int i = 0; i < 32; ++i)
+	{
+		glm::vec3 center = a_origin + a_direction * t;
+		glm::vec3 gap = center - ClosestSurfacePointTo(center);
+		float distance = glm::length(gap);
+		bool inside = Contains(center);
+		if (inside || distance <= a_radius + tolerance)
+		{
+			if (nullptr != a_distance)
+				*a_distance = t;
+			if (nullptr != a_normal)
+				*a_normal = (inside || 0 == distance ? -a_direction : gap / distance);
+			return true;
+		}
+
+		// the distance to a convex shape only grows once the sphere moves away from it
+		if (0 <= glm::dot(a_direction, gap))
+			return false;
+		t += distance - a_radius;
+		if (t > a_maxDistance)
+			return false;
+	}
+
+	// a grazing cast can still be closing in when the iterations run out, and
+	// that's a near miss rather than a hit
+	return false;
+}
+
+//
+// Plane
+//
+
+bool Geometry::Plane::Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							  float a_maxDistance, float* a_distance, glm::vec3* a_normal) const
+{
+	return SphereCast(a_origin, a_direction, 0, a_maxDistance, a_distance, a_normal);
+}
+bool Geometry::Plane::SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+								 float a_radius, float a_maxDistance, float* a_distance,
+								 glm::vec3* a_normal) const
+{
+	// planes are two-sided, so face the normal towards the origin
+	glm::vec3 normal = this->normal();
+	float distance = glm::dot(normal, a_origin - position);
+	if (0 > distance)
+	{
+		normal *= -1.0f;
+		distance *= -1;
+	}
+	float t = 0;
+	if (distance > a_radius)
+	{
+		float speed = -glm::dot(normal, a_direction);
+		if (0 >= speed)
+			return false;
+		t = (distance - a_radius) / speed;
+		if (t > a_maxDistance)
+			return false;
+	}
+	if (nullptr != a_distance)
+		*a_distance = t;
+	if (nullptr != a_normal)
+		*a_normal = normal;
+	return true;
+}
+
+//
+// Sphere
+//
+
+bool Geometry::Sphere::Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							   float a_maxDistance, float* a_distance, glm::vec3* a_normal) const
+{
+	return SphereCast(a_origin, a_direction, 0, a_maxDistance, a_distance, a_normal);
+}
+bool Geometry::Sphere::SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+								  float a_radius, float a_maxDistance, float* a_distance,
+								  glm::vec3* a_normal) const
+{
+	// a sphere swept against a sphere is a ray against a sphere with both radii
+	float range = radius + a_radius;
+	glm::vec3 offset = a_origin - position;
+	float c = glm::dot(offset, offset) - range*range;
+	float t = 0;
+	if (0 < c)
+	{
+		float b = glm::dot(offset, a_direction);
+		float discriminant = b*b - c;
+		if (0 <= b || 0 > discriminant)
+			return false;
+		t = -b - sqrt(discriminant);
+		if (t > a_maxDistance)
+			return false;
+	}
+	if (nullptr != a_distance)
+		*a_distance = t;
+	if (nullptr != a_normal)
+	{
+		glm::vec3 hit = offset + a_direction * t;
+		*a_normal = (glm::vec3(0) == hit ? -a_direction : glm::normalize(hit));
+	}
+	return true;
+}
+
+// Only the relative motion matters, so the shape is held still and the sphere
+// swept along the difference - exactly for spheres and planes, and by the
+// conservative advancement above for boxes.
+bool Geometry::Sphere::TimeOfImpact(const glm::vec3& a_displacement,
+									const Geometry& a_shape, const glm::vec3& a_shapeDisplacement,
+									float* a_time, glm::vec3* a_normal) const
+{
+	glm::vec3 displacement = a_displacement - a_shapeDisplacement;
+	float length = glm::length(displacement);
+	if (0 == length)
+	{
+		Collision collision;
+		collision.separatingAxis = glm::vec3(0);
+		if (!DetectCollision(*this, a_shape, &collision))
+			return false;
+		if (nullptr != a_time)
+			*a_time = 0;
+		if (nullptr != a_normal)
+			*a_normal = -collision.normal;
+		return true;
+	}
+	float distance;
+	if (!a_shape.SphereCast(position, displacement / length, radius, length, &distance, a_normal))
+		return false;
+	if (nullptr != a_time)
+		*a_time = distance / length;
+	return true;
+}
+
+//
+// Box
+//
+
+bool Geometry::Box::Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							float a_maxDistance, float* a_distance, glm::vec3* a_normal) const
+{
+	// slab test in the box's coordinate system, remembering which face was entered
+	glm::vec3 origin = ToLocal(a_origin);
+	glm::vec3 direction = ToLocal(a_direction, true);
+	float tMin = 0, tMax = a_maxDistance;
+	int axis = -1;
+	float side = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (0 == direction[i])
+		{
+			if (fabs(origin[i]) > extents[i])
+				return false;
+			continue;
+		}
+		float t1 = (-extents[i] - origin[i]) / direction[i];
+		float t2 = (extents[i] - origin[i]) / direction[i];
+		float s = -1;
+		if (t1 > t2)
+		{
+			float temp = t1;
+			t1 = t2;
+			t2 = temp;
+			s = 1;
+		}
+		if (t1 > tMin)
+		{
+			tMin = t1;
+			axis = i;
+			side = s;
+		}
+		if (t2 < tMax)
+			tMax = t2;
+		if (tMin > tMax)
+			return false;
+	}
+	if (nullptr != a_distance)
+		*a_distance = tMin;
+	if (nullptr != a_normal)
+	{
+		glm::vec3 normal(0);
+		if (0 > axis)
+		{
+			*a_normal = -a_direction;
+		}
+		else
+		{
+			normal[axis] = side;
+			*a_normal = ToWorld(normal, true);
+		}
+	}
+	return true;
+}
+
+//
+// ConvexHull
+//
+
+bool Geometry::ConvexHull::Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+								   float a_maxDistance, float* a_distance, glm::vec3* a_normal) const
+{
+	// the slab test with a face's plane in place of each pair of box sides
+	if (faces().empty())
+		return false;
+	glm::vec3 origin = ToLocal(a_origin);
+	glm::vec3 direction = ToLocal(a_direction, true);
+	float tMin = 0, tMax = a_maxDistance;
+	const Face* entered = nullptr;
+	for (auto& face : faces())
+	{
+		float distance = glm::dot(face.normal, origin) - face.offset;
+		float speed = glm::dot(face.normal, direction);
+		if (0 == speed)
+		{
+			if (0 < distance)
+				return false;
+			continue;
+		}
+		float t = -distance / speed;
+		if (0 > speed)
+		{
+			if (t > tMin)
+			{
+				tMin = t;
+				entered = &face;
+			}
+		}
+		else if (t < tMax)
+		{
+			tMax = t;
+		}
+		if (tMin > tMax)
+			return false;
+	}
+	if (nullptr != a_distance)
+		*a_distance = tMin;
+	if (nullptr != a_normal)
+		*a_normal = (nullptr == entered ? -a_direction : ToWorld(entered->normal, true));
+	return true;
+}
@@ -1,4 +1,6 @@
 #include "Geometry_Shapes.h"
+#include <algorithm>
+#include <cfloat>
 
 //
 // Plane
@@ -63,9 +65,10 @@ Geometry* Geometry::Sphere::Clone() const
 glm::vec3 Geometry::Sphere::ClosestSurfacePointTo(const glm::vec3& a_point,
 												  glm::vec3* a_normal) const
 {
+	glm::vec3 normal = Normalize(a_point - position);
 	if (nullptr != a_normal)
-		*a_normal = glm::normalize(a_point - position);
-	return position + glm::normalize(a_point - position)*radius;
+		*a_normal = normal;
+	return position + normal*radius;
 }
 bool Geometry::Sphere::Contains(const glm::vec3& a_point) const
 {
@@ -111,21 +114,7 @@ Geometry::Box::Box(const glm::vec3& a_extents, const glm::vec3& a_center,
 
 glm::vec3 Geometry::Box::AxisAlignedExtents() const
 {
-	glm::vec3 corners[4] = { ToWorld(extents, true),
-		ToWorld(glm::vec3(-extents.x, extents.y, extents.z), true),
-		ToWorld(glm::vec3(extents.x, -extents.y, extents.z), true),
-		ToWorld(glm::vec3(extents.x, extents.y, -extents.z), true) };
-	glm::vec3 result(0);
-	for (auto corner : corners)
-	{
-		if (fabs(corner.x) > result.x)
-			result.x = fabs(corner.x);
-		if (fabs(corner.y) > result.y)
-			result.y = fabs(corner.y);
-		if (fabs(corner.z) > result.z)
-			result.z = fabs(corner.z);
-	}
-	return result;
+	return absRotationMatrix() * extents;
 }
 Geometry* Geometry::Box::Clone() const
 {
@@ -136,7 +125,8 @@ glm::vec3 Geometry::Box::ClosestSurfacePointTo(const glm::vec3& a_point,
 {
 	// rotate into box's coordinate system and calculate distances between point
 	// and nearest face in each direction
-	glm::vec3 local = ToLocal(a_point);
+	bool aligned = isAxisAligned();
+	glm::vec3 local = (aligned ? a_point - position : ToLocal(a_point));
 	glm::vec3 distances = extents - glm::vec3(fabs(local.x), fabs(local.y), fabs(local.z));
 	if (0 < distances.x && 0 < distances.y && 0 < distances.z)
 	{
@@ -151,20 +141,21 @@ glm::vec3 Geometry::Box::ClosestSurfacePointTo(const glm::vec3& a_point,
 	// no normal at corners and edges
 	if (nullptr != a_normal)
 	{
+		glm::vec3 normal(0);
 		if (0 == distances.x && 0 < distances.y && 0 < distances.z)
-			*a_normal = ToWorld((0 > local.x ? -1.0f : 1.0f), 0, 0, true);
+			normal.x = (0 > local.x ? -1.0f : 1.0f);
 		else if (0 < distances.x && 0 == distances.y && 0 < distances.z)
-			*a_normal = ToWorld(0, (0 > local.y ? -1.0f : 1.0f), 0, true);
+			normal.y = (0 > local.y ? -1.0f : 1.0f);
 		else if (0 < distances.x && 0 < distances.y && 0 == distances.z)
-			*a_normal = ToWorld(0, 0, (0 > local.z ? -1.0f : 1.0f), true);
-		else
-			*a_normal = glm::vec3(0);
+			normal.z = (0 > local.z ? -1.0f : 1.0f);
+		*a_normal = (aligned ? normal : ToWorld(normal, true));
 	}
 
 	// find closest point on box surface
-	return ToWorld((0 > local.x ? -1 : 1) * (extents.x - (0 <= distances.x ? distances.x : 0)),
-		(0 > local.y ? -1 : 1) * (extents.y - (0 <= distances.y ? distances.y : 0)),
-		(0 > local.z ? -1 : 1) * (extents.z - (0 <= distances.z ? distances.z : 0)));
+	glm::vec3 closest((0 > local.x ? -1 : 1) * (extents.x - (0 <= distances.x ? distances.x : 0)),
+					  (0 > local.y ? -1 : 1) * (extents.y - (0 <= distances.y ? distances.y : 0)),
+					  (0 > local.z ? -1 : 1) * (extents.z - (0 <= distances.z ? distances.z : 0)));
+	return (aligned ? closest + position : ToWorld(closest));
 }
 float Geometry::Box::volume() const
 {
@@ -176,7 +167,7 @@ float Geometry::Box::area() const
 }
 bool Geometry::Box::Contains(const glm::vec3& a_point) const
 {
-	glm::vec3 local = ToLocal(a_point);
+	glm::vec3 local = (isAxisAligned() ? a_point - position : ToLocal(a_point));
 	return (-extents.x <= local.x && local.x <= extents.x &&
 			-extents.y <= local.y && local.y <= extents.y &&
 			-extents.z <= local.z && local.z <= extents.z);
@@ -201,3 +192,357 @@ std::vector<glm::vec3> Geometry::Box::vertices() const
 	points.push_back(ToWorld(-extents.x, -extents.y, -extents.z));
 	return points;
 }
+
+//
+// ConvexHull
+//
+
+// distances within this share of the hull's size of a plane count as on it
+static const float HULL_TOLERANCE = 0.0001f;
+
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center)
+	: Geometry(a_center, HULL)
+{
+	Build(a_points);
+}
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+								 const glm::quat& a_orientation)
+	: Geometry(a_center, a_orientation, HULL)
+{
+	Build(a_points);
+}
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+								 const glm::vec3& a_forward, const glm::vec3& a_up)
+	: Geometry(a_center, a_forward, a_up, HULL)
+{
+	Build(a_points);
+}
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+								 const glm::vec3& a_axis, float a_angle)
+	: Geometry(a_center, a_axis, a_angle, HULL)
+{
+	Build(a_points);
+}
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+								 float a_yaw, float a_pitch, float a_roll)
+	: Geometry(a_center, a_yaw, a_pitch, a_roll, HULL)
+{
+	Build(a_points);
+}
+Geometry::ConvexHull::ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+								 float a_yaw, float a_pitch, float a_roll,
+								 const glm::vec3& a_yawAxis, const glm::vec3& a_rollAxis)
+	: Geometry(a_center, a_yaw, a_pitch, a_roll, a_yawAxis, a_rollAxis, HULL)
+{
+	Build(a_points);
+}
+
+// a point on a face, in two dimensions across it
+struct FacePoint
+{
+	float x;
+	float y;
+	unsigned int index;
+
+	bool operator<(const FacePoint& a_other) const
+	{
+		return (x != a_other.x ? x < a_other.x : y < a_other.y);
+	}
+};
+
+// twice the area of the triangle, positive if it turns counterclockwise
+static float Turn(const FacePoint& a_point1, const FacePoint& a_point2, const FacePoint& a_point3)
+{
+	return (a_point2.x - a_point1.x) * (a_point3.y - a_point1.y) -
+		   (a_point2.y - a_point1.y) * (a_point3.x - a_point1.x);
+}
+
+static glm::mat3 Outer(const glm::vec3& a_vector)
+{
+	return glm::mat3(a_vector * a_vector.x, a_vector * a_vector.y, a_vector * a_vector.z);
+}
+
+void Geometry::ConvexHull::Build(const std::vector<glm::vec3>& a_points)
+{
+	m_points.clear();
+	m_faces.clear();
+	m_corners.clear();
+	m_bounds = glm::vec3(0);
+	m_volume = m_area = 0;
+	m_inertia = glm::mat3(0);
+	unsigned int count = a_points.size();
+	float size = 0;
+	for (unsigned int i = 1; i < count; ++i)
+		size = fmax(size, glm::distance(a_points[0], a_points[i]));
+	float tolerance = size * HULL_TOLERANCE;
+
+	// any three points with all the others on one side of their plane make a
+	// face - a face with more corners than that is found over and over, so
+	// only the first is kept, and a flat hull has a face on each side
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		for (unsigned int j = i + 1; j < count; ++j)
+		{
+			for (unsigned int k = j + 1; k < count; ++k)
+			{
+				glm::vec3 normal = glm::cross(a_points[j] - a_points[i], a_points[k] - a_points[i]);
+				float length = glm::length(normal);
+				if (length <= tolerance * size)
+					continue;
+				normal /= length;
+				float offset = glm::dot(normal, a_points[i]);
+				bool above = false, below = false;
+				for (unsigned int l = 0; l < count && !(above && below); ++l)
+				{
+					float distance = glm::dot(normal, a_points[l]) - offset;
+					above = above || tolerance < distance;
+					below = below || -tolerance > distance;
+				}
+				for (int side = 0; side < 2; ++side)
+				{
+					Face face;
+					face.normal = (0 == side ? normal : -normal);
+					face.offset = (0 == side ? offset : -offset);
+					face.firstCorner = face.cornerCount = 0;
+					bool repeated = (0 == side ? above : below);
+					for (unsigned int l = 0; l < m_faces.size() && !repeated; ++l)
+					{
+						repeated = (1 - HULL_TOLERANCE < glm::dot(m_faces[l].normal, face.normal) &&
+									tolerance >= fabs(m_faces[l].offset - face.offset));
+					}
+					if (!repeated)
+						m_faces.push_back(face);
+				}
+			}
+		}
+	}
+
+	// each face's corners go around the outline of the points on it, found by
+	// the monotone chain, which leaves out points on its edges and inside it
+	std::vector<int> remap(count, -1);
+	std::vector<FacePoint> onFace, outline;
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_faces.size(); ++i)
+	{
+		Face face = m_faces[i];
+		glm::vec3 across = glm::normalize(glm::cross(face.normal, (0.5f > fabs(face.normal.x) ?
+																	glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0))));
+		glm::vec3 up = glm::cross(face.normal, across);
+		onFace.clear();
+		for (unsigned int j = 0; j < count; ++j)
+		{
+			if (tolerance < fabs(glm::dot(face.normal, a_points[j]) - face.offset))
+				continue;
+			FacePoint point = { glm::dot(across, a_points[j]), glm::dot(up, a_points[j]), j };
+			onFace.push_back(point);
+		}
+		std::sort(onFace.begin(), onFace.end());
+		outline.clear();
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			unsigned int start = outline.size();
+			for (unsigned int j = 0; j < onFace.size(); ++j)
+			{
+				const FacePoint& point = onFace[0 == pass ? j : onFace.size() - 1 - j];
+				while (outline.size() >= start + 2 &&
+					   tolerance * size >= Turn(outline[outline.size() - 2], outline.back(), point))
+					outline.pop_back();
+				outline.push_back(point);
+			}
+			outline.pop_back();	// it starts the other half
+		}
+		if (3 > outline.size())
+			continue;
+		face.firstCorner = m_corners.size();
+		face.cornerCount = outline.size();
+		for (auto& point : outline)
+		{
+			if (0 > remap[point.index])
+			{
+				remap[point.index] = m_points.size();
+				m_points.push_back(a_points[point.index]);
+			}
+			m_corners.push_back(remap[point.index]);
+		}
+		m_faces[kept++] = face;
+	}
+	m_faces.resize(kept);
+	if (m_points.empty())
+	{
+		for (auto& point : a_points)
+			m_points.push_back(point);
+	}
+	if (m_points.empty())
+		return;
+
+	// volume, area and inertia from the tetrahedrons between each face's
+	// triangles and a point inside
+	glm::vec3 inside(0);
+	for (auto& point : m_points)
+		inside += point;
+	inside /= (float)m_points.size();
+	glm::vec3 moment(0);
+	glm::mat3 covariance(0);
+	for (auto& face : m_faces)
+	{
+		glm::vec3 corner1 = corner(face, 0) - inside;
+		for (unsigned int i = 1; i + 1 < face.cornerCount; ++i)
+		{
+			glm::vec3 corner2 = corner(face, i) - inside;
+			glm::vec3 corner3 = corner(face, i + 1) - inside;
+			float determinant = glm::dot(corner1, glm::cross(corner2, corner3));
+			glm::vec3 sum = corner1 + corner2 + corner3;
+			m_volume += determinant / 6;
+			moment += sum * (determinant / 24);
+			covariance += (Outer(corner1) + Outer(corner2) + Outer(corner3) + Outer(sum)) *
+						  (determinant / 120);
+			m_area += glm::length(glm::cross(corner2 - corner1, corner3 - corner1)) / 2;
+		}
+	}
+	glm::vec3 center = inside;
+	if (0 < m_volume)
+	{
+		glm::vec3 offset = moment / m_volume;
+		center += offset;
+		covariance -= Outer(offset) * m_volume;
+		float trace = covariance[0][0] + covariance[1][1] + covariance[2][2];
+		m_inertia = (glm::mat3(trace) - covariance) / m_volume;
+	}
+
+	// with the center of mass at the origin
+	for (auto& point : m_points)
+	{
+		point -= center;
+		m_bounds = glm::max(m_bounds, glm::vec3(fabs(point.x), fabs(point.y), fabs(point.z)));
+	}
+	for (auto& face : m_faces)
+		face.offset -= glm::dot(face.normal, center);
+	position += ToWorld(center, true);
+}
+
+glm::vec3 Geometry::ConvexHull::AxisAlignedExtents() const
+{
+	return absRotationMatrix() * m_bounds;
+}
+Geometry* Geometry::ConvexHull::Clone() const
+{
+	return new ConvexHull(*this);
+}
+glm::vec3 Geometry::ConvexHull::ClosestPointOnFace(const Face& a_face, const glm::vec3& a_point,
+												   bool* a_inside) const
+{
+	// onto the face's plane, and if that's outside one of its edges, the
+	// closest point on the edges
+	glm::vec3 projected = a_point - a_face.normal * (glm::dot(a_face.normal, a_point) - a_face.offset);
+	bool inside = true;
+	glm::vec3 closest = projected;
+	float closestDistance2 = FLT_MAX;
+	for (unsigned int i = 0; i < a_face.cornerCount; ++i)
+	{
+		const glm::vec3& corner1 = corner(a_face, i);
+		glm::vec3 edge = corner(a_face, i + 1) - corner1;
+		if (0 >= glm::dot(glm::cross(edge, a_face.normal), projected - corner1))
+			continue;
+		inside = false;
+		float t = glm::clamp(glm::dot(projected - corner1, edge) / glm::length2(edge), 0.0f, 1.0f);
+		glm::vec3 point = corner1 + edge * t;
+		float distance2 = glm::distance2(point, projected);
+		if (distance2 < closestDistance2)
+		{
+			closestDistance2 = distance2;
+			closest = point;
+		}
+	}
+	if (nullptr != a_inside)
+		*a_inside = inside;
+	return closest;
+}
+glm::vec3 Geometry::ConvexHull::ClosestSurfacePointTo(const glm::vec3& a_point,
+													  glm::vec3* a_normal) const
+{
+	if (nullptr != a_normal)
+		*a_normal = glm::vec3(0);
+	if (m_faces.empty())
+		return Support(a_point - position);
+
+	// from inside, straight out through the nearest face
+	glm::vec3 local = ToLocal(a_point);
+	unsigned int nearest = 0;
+	float nearestDistance = -FLT_MAX;
+	for (unsigned int i = 0; i < m_faces.size(); ++i)
+	{
+		float distance = glm::dot(m_faces[i].normal, local) - m_faces[i].offset;
+		if (distance > nearestDistance)
+		{
+			nearestDistance = distance;
+			nearest = i;
+		}
+	}
+	if (0 >= nearestDistance)
+	{
+		if (nullptr != a_normal)
+			*a_normal = ToWorld(m_faces[nearest].normal, true);
+		return ToWorld(local - m_faces[nearest].normal * nearestDistance);
+	}
+
+	// from outside, the closest point on the faces it's in front of - no
+	// normal at corners and edges
+	glm::vec3 closest(0);
+	float closestDistance2 = FLT_MAX;
+	for (auto& face : m_faces)
+	{
+		if (0 >= glm::dot(face.normal, local) - face.offset)
+			continue;
+		bool inside;
+		glm::vec3 point = ClosestPointOnFace(face, local, &inside);
+		float distance2 = glm::distance2(point, local);
+		if (distance2 < closestDistance2)
+		{
+			closestDistance2 = distance2;
+			closest = point;
+			if (nullptr != a_normal)
+				*a_normal = (inside ? ToWorld(face.normal, true) : glm::vec3(0));
+		}
+	}
+	return ToWorld(closest);
+}
+bool Geometry::ConvexHull::Contains(const glm::vec3& a_point) const
+{
+	if (m_faces.empty())
+		return false;
+	glm::vec3 local = ToLocal(a_point);
+	for (auto& face : m_faces)
+	{
+		if (glm::dot(face.normal, local) > face.offset)
+			return false;
+	}
+	return true;
+}
+
+glm::vec3 Geometry::ConvexHull::Support(const glm::vec3& a_direction, unsigned int* a_index) const
+{
+	if (m_points.empty())
+		return position;
+	glm::vec3 direction = ToLocal(a_direction, true);
+	unsigned int furthest = 0;
+	float furthestDistance = glm::dot(direction, m_points[0]);
+	for (unsigned int i = 1; i < m_points.size(); ++i)
+	{
+		float distance = glm::dot(direction, m_points[i]);
+		if (distance > furthestDistance)
+		{
+			furthestDistance = distance;
+			furthest = i;
+		}
+	}
+	if (nullptr != a_index)
+		*a_index = furthest;
+	return ToWorld(m_points[furthest]);
+}
+std::vector<glm::vec3> Geometry::ConvexHull::vertices() const
+{
+	std::vector<glm::vec3> points;
+	for (auto& point : m_points)
+		points.push_back(ToWorld(point));
+	return points;
+}
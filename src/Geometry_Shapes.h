@@ -1,7 +1,10 @@
 #pragma once
 #include "Geometry.h"
 
-struct Geometry::Plane : public Geometry
+// the shapes are final, so calls through a reference to the exact type are
+// resolved at compile time instead of going through the vtable
+
+struct Geometry::Plane final : public Geometry
 {
 	Plane(const glm::vec3& a_origin = glm::vec3(0),
 		  const glm::vec3& a_normal = glm::vec3(0, 0, 1),
@@ -18,13 +21,19 @@ struct Geometry::Plane : public Geometry
 	virtual float area() const { return 0; }	// actually infinite
 	virtual glm::vec3 scale() const { return glm::vec3(1); }
 	virtual glm::mat3 interiaTensorDividedByMass() const { return glm::mat3(0); }
+	virtual bool Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						 float a_maxDistance, float* a_distance = nullptr,
+						 glm::vec3* a_normal = nullptr) const;
+	virtual bool SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							float a_radius, float a_maxDistance, float* a_distance = nullptr,
+							glm::vec3* a_normal = nullptr) const;
 
 	glm::vec3 normal() const { return localZAxis(); }
 	glm::vec3 up() const { return localYAxis(); }
 	glm::vec3 right() const { return localXAxis(); }
 };
 
-struct Geometry::Sphere : public Geometry
+struct Geometry::Sphere final : public Geometry
 {
 	Sphere(float a_radius = 0.5f,
 		   const glm::vec3& a_center = glm::vec3(0));
@@ -49,11 +58,24 @@ struct Geometry::Sphere : public Geometry
 	virtual float area() const;
 	virtual glm::vec3 scale() const { return glm::vec3(radius); }
 	virtual glm::mat3 interiaTensorDividedByMass() const;
+	virtual bool Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						 float a_maxDistance, float* a_distance = nullptr,
+						 glm::vec3* a_normal = nullptr) const;
+	virtual bool SphereCast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+							float a_radius, float a_maxDistance, float* a_distance = nullptr,
+							glm::vec3* a_normal = nullptr) const;
+
+	// fraction of the way through their displacements at which this sphere
+	// and a shape, moving without rotating, first touch - a shape the sphere
+	// already touches is hit at time zero
+	bool TimeOfImpact(const glm::vec3& a_displacement,
+					  const Geometry& a_shape, const glm::vec3& a_shapeDisplacement,
+					  float* a_time = nullptr, glm::vec3* a_normal = nullptr) const;
 
 	float radius;
 };
 
-struct Geometry::Box : public Geometry
+struct Geometry::Box final : public Geometry
 {
 	Box(const glm::vec3& a_extents = glm::vec3(1),
 		const glm::vec3& a_center = glm::vec3(0));
@@ -78,9 +100,85 @@ struct Geometry::Box : public Geometry
 	virtual float area() const;
 	virtual glm::vec3 scale() const { return extents; }
 	virtual glm::mat3 interiaTensorDividedByMass() const;
+	virtual bool Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						 float a_maxDistance, float* a_distance = nullptr,
+						 glm::vec3* a_normal = nullptr) const;
 
 	glm::vec3 size() const { return extents * 2.0f; }
 	std::vector<glm::vec3> vertices() const;
 
 	glm::vec3 extents;
 };
+
+// Smallest convex shape around a set of points, given relative to the center.
+// Its faces are worked out once when it's made - by trying every three points
+// as a face, which is meant for the handful of points a cushion or pocket
+// jaw needs rather than for big meshes - and the points are then moved so the
+// center of mass is at the position, which moves to match, so the hull stays
+// where it was put.
+struct Geometry::ConvexHull final : public Geometry
+{
+	// a face's corners are counterclockwise seen from outside, and are indices
+	// into the hull's points
+	struct Face
+	{
+		glm::vec3 normal;	// outward, in the hull's coordinate system
+		float offset;	// of its plane along the normal
+		unsigned int firstCorner;
+		unsigned int cornerCount;
+	};
+
+	ConvexHull(const std::vector<glm::vec3>& a_points = std::vector<glm::vec3>(),
+			   const glm::vec3& a_center = glm::vec3(0));
+	ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+			   const glm::quat& a_orientation);
+	ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+			   const glm::vec3& a_forward, const glm::vec3& a_up = glm::vec3(0, 0, 1));
+	ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+			   const glm::vec3& a_axis, float a_angle);
+	ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+			   float a_yaw, float a_pitch, float a_roll);
+	ConvexHull(const std::vector<glm::vec3>& a_points, const glm::vec3& a_center,
+			   float a_yaw, float a_pitch, float a_roll,
+			   const glm::vec3& a_yawAxis, const glm::vec3& a_rollAxis = glm::vec3(1, 0, 0));
+
+	virtual glm::vec3 AxisAlignedExtents() const;
+	virtual Geometry* Clone() const;
+	virtual glm::vec3 ClosestSurfacePointTo(const glm::vec3& a_point,
+											glm::vec3* a_normal = nullptr) const;
+	virtual bool Contains(const glm::vec3& a_point) const;
+	virtual float volume() const { return m_volume; }
+	virtual float area() const { return m_area; }
+	virtual glm::vec3 scale() const { return glm::vec3(1); }	// meshes for it are made to its points
+	virtual glm::mat3 interiaTensorDividedByMass() const { return m_inertia; }
+	virtual bool Raycast(const glm::vec3& a_origin, const glm::vec3& a_direction,
+						 float a_maxDistance, float* a_distance = nullptr,
+						 glm::vec3* a_normal = nullptr) const;
+
+	// the point furthest along a world space direction, and its index
+	glm::vec3 Support(const glm::vec3& a_direction, unsigned int* a_index = nullptr) const;
+	std::vector<glm::vec3> vertices() const;
+
+	// in the hull's coordinate system, with the center of mass at the origin
+	const std::vector<glm::vec3>& localPoints() const { return m_points; }
+	const std::vector<Face>& faces() const { return m_faces; }
+	const glm::vec3& corner(const Face& a_face, unsigned int a_index) const
+	{
+		return m_points[m_corners[a_face.firstCorner + a_index % a_face.cornerCount]];
+	}
+
+private:
+
+	void Build(const std::vector<glm::vec3>& a_points);
+	glm::vec3 ClosestPointOnFace(const Face& a_face, const glm::vec3& a_point, bool* a_inside) const;
+
+	std::vector<glm::vec3> m_points;
+	std::vector<Face> m_faces;
+	std::vector<unsigned int> m_corners;
+	glm::vec3 m_bounds;	// furthest any point is from the center along each axis
+	float m_volume;
+	float m_area;
+	glm::mat3 m_inertia;	// divided by mass
+};
+
+#include "Geometry_Variant.h"
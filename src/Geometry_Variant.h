@@ -0,0 +1,122 @@
+#pragma once
+#include "Geometry_Shapes.h"
+#include <new>
+#include <type_traits>
+
+template<typename Visitor>
+typename Visitor::Result Geometry::Visit(const Geometry& a_shape, const Visitor& a_visitor)
+{
+	switch (a_shape.GetShape())
+	{
+	case PLANE: return a_visitor(static_cast<const Plane&>(a_shape));
+	case SPHERE: return a_visitor(static_cast<const Sphere&>(a_shape));
+	case BOX: return a_visitor(static_cast<const Box&>(a_shape));
+	case HULL: return a_visitor(static_cast<const ConvexHull&>(a_shape));
+	default: return typename Visitor::Result();
+	}
+}
+
+// Tagged union of the shapes, so an actor can hold its geometry by value.
+// The shape lives in a buffer big enough for the largest one and is reached
+// through the tag, so nothing here needs RTTI, and only a hull's points and
+// faces are on the heap.
+struct Geometry::Variant
+{
+	Variant() : m_shape(NONE) {}
+	Variant(const Geometry& a_geometry) : m_shape(NONE) { Assign(a_geometry); }
+	Variant(const Variant& a_variant) : m_shape(NONE) { Assign(a_variant); }
+	~Variant() { Reset(); }
+	Variant& operator=(const Geometry& a_geometry)
+	{
+		if (&a_geometry != &Get())
+		{
+			Reset();
+			Assign(a_geometry);
+		}
+		return *this;
+	}
+	Variant& operator=(const Variant& a_variant)
+	{
+		if (&a_variant != this)
+		{
+			Reset();
+			Assign(a_variant);
+		}
+		return *this;
+	}
+
+	Shape GetShape() const { return m_shape; }
+	bool IsEmpty() const { return NONE == m_shape; }
+	Geometry& Get() { return *reinterpret_cast<Geometry*>(&m_storage); }
+	const Geometry& Get() const { return *reinterpret_cast<const Geometry*>(&m_storage); }
+	Geometry& operator*() { return Get(); }
+	const Geometry& operator*() const { return Get(); }
+	Geometry* operator->() { return &Get(); }
+	const Geometry* operator->() const { return &Get(); }
+
+	// non-virtual versions of the queries the scene makes every step
+	glm::vec3 AxisAlignedExtents() const
+	{
+		return IsEmpty() ? glm::vec3(0) : Visit(Get(), ExtentsOf());
+	}
+	bool Contains(const glm::vec3& a_point) const
+	{
+		return !IsEmpty() && Visit(Get(), Containment(a_point));
+	}
+
+private:
+
+	template<std::size_t A, std::size_t B>
+	struct Max { static const std::size_t value = (A > B ? A : B); };
+	static const std::size_t SIZE =
+		Max<sizeof(Plane), Max<sizeof(Sphere), Max<sizeof(Box), sizeof(ConvexHull)>::value>::value>::value;
+	static const std::size_t ALIGNMENT =
+		Max<std::alignment_of<Plane>::value,
+			Max<std::alignment_of<Sphere>::value,
+				Max<std::alignment_of<Box>::value, std::alignment_of<ConvexHull>::value>::value>::value>::value;
+
+	struct CopyInto
+	{
+		typedef void Result;
+		void* storage;
+		CopyInto(void* a_storage) : storage(a_storage) {}
+		template<typename T> void operator()(const T& a_shape) const { new (storage) T(a_shape); }
+	};
+	struct Destroy
+	{
+		typedef void Result;
+		template<typename T> void operator()(const T& a_shape) const { a_shape.~T(); }
+	};
+	struct ExtentsOf
+	{
+		typedef glm::vec3 Result;
+		template<typename T> glm::vec3 operator()(const T& a_shape) const { return a_shape.T::AxisAlignedExtents(); }
+	};
+	struct Containment
+	{
+		typedef bool Result;
+		const glm::vec3& point;
+		Containment(const glm::vec3& a_point) : point(a_point) {}
+		template<typename T> bool operator()(const T& a_shape) const { return a_shape.T::Contains(point); }
+	};
+
+	void Assign(const Geometry& a_geometry)
+	{
+		Visit(a_geometry, CopyInto(&m_storage));
+		m_shape = (SHAPE_COUNT > a_geometry.GetShape() ? a_geometry.GetShape() : NONE);
+	}
+	void Assign(const Variant& a_variant)
+	{
+		if (!a_variant.IsEmpty())
+			Assign(a_variant.Get());
+	}
+	void Reset()
+	{
+		if (!IsEmpty())
+			Visit(Get(), Destroy());
+		m_shape = NONE;
+	}
+
+	std::aligned_storage<SIZE, ALIGNMENT>::type m_storage;
+	Shape m_shape;
+};
@@ -251,7 +251,6 @@ void PoolTable::Update()
 	{
 		if (m_cueBall->GetPosition().y < m_threshold)
 			Setup();
-		bool still = glm::vec3(0) == m_cueBall->GetVelocity();
 		unsigned int remainingBalls = 0;
 		for (unsigned int i = 0; i < BALL_COUNT; ++i)
 		{
@@ -264,16 +263,12 @@ void PoolTable::Update()
 				m_balls[i] = nullptr;
 				--remainingBalls;
 			}
-			else if (still)
-			{
-				still = glm::vec3(0) == m_balls[i]->GetVelocity();
-			}
 		}
 		if (0 == remainingBalls)
 		{
 			Setup();
 		}
-		else if (still)
+		else if (0 == GetAwakeCount())
 		{
 			m_aiming = m_cued = false;
 		}
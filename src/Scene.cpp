@@ -1,54 +1,289 @@
 #include "Scene.h"
 #include "Engine.h"
+#include <cfloat>
 
-void Scene::AddActor(Actor* a_actor)
+//
+// Proxy
+//
+
+Scene::Proxy::Proxy(Actor* a_actor, int a_sphere)
+	: actor(a_actor), min(0), max(0), sphere(a_sphere)
+{
+	if (nullptr == actor)
+		return;
+	const Geometry& geometry = actor->GetGeometry();
+	if (Geometry::PLANE == geometry.GetShape())
+	{
+		// planes are infinite
+		min = glm::vec3(-FLT_MAX);
+		max = glm::vec3(FLT_MAX);
+	}
+	else
+	{
+		glm::vec3 extents = actor->GetAxisAlignedExtents();
+		min = geometry.position - extents;
+		max = geometry.position + extents;
+	}
+}
+bool Scene::Proxy::IsBounded() const
+{
+	return (-FLT_MAX < min.x && -FLT_MAX < min.y && -FLT_MAX < min.z &&
+			FLT_MAX > max.x && FLT_MAX > max.y && FLT_MAX > max.z);
+}
+
+//
+// Scene
+//
+
+Scene::Scene(const glm::vec3& a_gravity, double a_timeStep)
+	: m_gravity(a_gravity), m_timeStep(a_timeStep),
+	  m_lastUpdate(Engine::GetElapsedTime()), m_maxSteps(8), m_droppedTime(0),
+	  m_blend(1), m_freeSlots(-1), m_stepMode(FIXED_STEP), m_up(0), m_continuous(true),
+	  m_planeX(1, 0, 0), m_planeY(0, 0, 1), m_awakeDiscs(0), m_discSteps(0),
+	  m_supportingSpheres(false),
+	  m_broadphase(new SweepAndPrune()),
+	  m_timeToSleep(0.5f), m_awakeCount(0), m_solverIterations(0) {}
+Scene::~Scene()
+{
+	ClearActors();
+	delete m_broadphase;
+	m_broadphase = nullptr;
+}
+
+Scene::Handle Scene::AddActor(Actor* a_actor)
 {
-	if (nullptr != a_actor)
-		m_actors.insert(a_actor);
+	if (nullptr == a_actor)
+		return Handle();
+	if (HasActor(a_actor))
+		return GetHandle(a_actor);
+
+	// reuse a free slot if there is one
+	if (0 > m_freeSlots)
+	{
+		Slot slot = { 0, -1 };
+		m_slots.push_back(slot);
+		m_freeSlots = m_slots.size() - 1;
+	}
+	int slot = m_freeSlots;
+	m_freeSlots = m_slots[slot].body;
+	m_slots[slot].body = m_actors.size();
+
+	Proxy proxy(a_actor);
+	m_actors.push_back(a_actor);
+	m_bodySlots.push_back(slot);
+	m_treeProxies.push_back(m_tree.CreateProxy(a_actor, proxy.min, proxy.max));
+	a_actor->SetStore(&m_bodyStore);
+	a_actor->SetSceneSlot(slot);
+	a_actor->SetAwakeCounter(&m_awakeCount);
+	return Handle(slot, m_slots[slot].generation);
 }
 void Scene::ClearActors()
 {
-	while (!m_actors.empty())
+	m_tree.Clear();
+	m_staticField.Clear();
+	m_impulseCache.clear();
+	m_axisCache.clear();
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
 	{
-		Actor* actor = *m_actors.begin();
-		m_actors.erase(actor);
-		if (nullptr != actor)
-			delete actor;
+		Slot& slot = m_slots[m_bodySlots[i]];
+		++slot.generation;
+		slot.body = m_freeSlots;
+		m_freeSlots = m_bodySlots[i];
+		if (nullptr != m_actors[i])
+			delete m_actors[i];
 	}
+	m_actors.clear();
+	m_bodySlots.clear();
+	m_treeProxies.clear();
+	m_bodyStore.clear();
+	m_awakeCount = 0;
 }
 bool Scene::DestroyActor(Actor* a_actor)	// returns false if actor not in scene
 {
-	if (nullptr == a_actor || 0 == m_actors.count(a_actor))
+	int body = BodyOf(a_actor);
+	if (0 > body)
 		return false;
-	m_actors.erase(a_actor);
+	RemoveBody(body);
 	delete a_actor;
 	return true;
 }
+bool Scene::DestroyActor(const Handle& a_handle)
+{
+	return DestroyActor(GetActor(a_handle));
+}
 
-void Scene::Update()
+Actor* Scene::GetActor(const Handle& a_handle) const
 {
-	double time = Engine::GetElapsedTime();
-	while (time - m_lastUpdate >= m_timeStep)
+	if (0 > a_handle.slot || m_slots.size() <= (unsigned int)a_handle.slot)
+		return nullptr;
+	const Slot& slot = m_slots[a_handle.slot];
+	if (slot.generation != a_handle.generation || 0 > slot.body ||
+		m_actors.size() <= (unsigned int)slot.body || m_bodySlots[slot.body] != a_handle.slot)
+		return nullptr;
+	return m_actors[slot.body];
+}
+Scene::Handle Scene::GetHandle(const Actor* a_actor) const
+{
+	int body = BodyOf(a_actor);
+	if (0 > body)
+		return Handle();
+	return Handle(m_bodySlots[body], m_slots[m_bodySlots[body]].generation);
+}
+
+void Scene::RemoveBody(int a_body)
+{
+	Actor* actor = m_actors[a_body];
+	m_tree.DestroyProxy(m_treeProxies[a_body]);
+	ForgetImpulses(actor);
+	actor->SetAwakeCounter(nullptr);
+	actor->SetSceneSlot(-1);
+	actor->ClearSupport();
+	ForgetSupport(actor);
+	if (m_staticField.Contains(actor))
+		m_staticField.Clear();
+
+	// free the slot, so handles to the actor go stale
+	int slot = m_bodySlots[a_body];
+	++m_slots[slot].generation;
+	m_slots[slot].body = m_freeSlots;
+	m_freeSlots = slot;
+
+	// the actor takes its state back, and the last body fills the gap
+	actor->SetStore(nullptr);
+	m_bodyStore.Remove(a_body);
+	int last = m_actors.size() - 1;
+	if (a_body != last)
+	{
+		m_actors[a_body] = m_actors[last];
+		m_bodySlots[a_body] = m_bodySlots[last];
+		m_treeProxies[a_body] = m_treeProxies[last];
+		m_slots[m_bodySlots[a_body]].body = a_body;
+		m_actors[a_body]->SetStoreIndex(a_body);
+	}
+	m_actors.pop_back();
+	m_bodySlots.pop_back();
+	m_treeProxies.pop_back();
+}
+
+void Scene::SetBroadphase(Broadphase* a_broadphase)
+{
+	if (nullptr == a_broadphase || m_broadphase == a_broadphase)
+		return;
+	delete m_broadphase;
+	m_broadphase = a_broadphase;
+}
+
+void Scene::SetTimeToSleep(float a_seconds)
+{
+	m_timeToSleep = a_seconds;
+	if (0 >= m_timeToSleep)
 	{
-		// standard physics update
-		m_lastUpdate += m_timeStep;
 		for (auto actor : m_actors)
-			actor->Update(m_timeStep, m_gravity);
+			actor->Wake();
+	}
+}
+
+void Scene::FindPairs()
+{
+	// gather bounds, keeping static and sleeping actors in their own partition
+	// so they're never paired with each other, and copy sphere positions and
+	// radii into their own arrays
+	m_dynamicProxies.clear();
+	m_staticProxies.clear();
+	m_spheres.clear();
+	m_islandActors.clear();
+	m_islandIndices.resize(m_actors.size());
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
+	{
+		// discs in planar mode are moved separately, so here they're static
+		Actor* actor = m_actors[i];
+		bool dynamic = (actor->IsDynamic() && !IsDisc(i));
+		m_islandIndices[i] = (dynamic ? (int)m_islandActors.size() : -1);
+		if (dynamic)
+			m_islandActors.push_back(actor);
+		const Geometry& geometry = actor->GetGeometry();
+		int sphere = (Geometry::SPHERE == geometry.GetShape() ?
+					  m_spheres.Add(static_cast<const Geometry::Sphere&>(geometry)) : -1);
+		if (dynamic && actor->IsAwake())
+			m_dynamicProxies.push_back(Proxy(actor, sphere));
+		else
+			m_staticProxies.push_back(Proxy(actor, sphere));
+	}
+
+	m_pairs.clear();
+	m_broadphase->FindPairs(m_dynamicProxies, m_staticProxies, m_pairs);
+	DropSupportPairs();
+	DropFieldPairs();
+}
+
+void Scene::UpdateTree()
+{
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
+	{
+		Actor* actor = m_actors[i];
+		if (actor->IsDynamic() && (!actor->IsAwake() || IsDisc(i)))
+			continue;
+		Proxy proxy(actor);
+		m_tree.MoveProxy(m_treeProxies[i], proxy.min, proxy.max,
+						 actor->GetVelocity() * (float)m_timeStep);
+	}
+}
 
-		// collision resolution
-		std::set<Actor*> unchecked(m_actors);
-		while (1 < unchecked.size())
+void Scene::Update()
+{
+	double time = Engine::GetElapsedTime();
+	m_droppedTime = 0;
+	if (EVENT_DRIVEN == m_stepMode)
+	{
+		AdvanceEvents(time - m_lastUpdate);
+		m_lastUpdate = time;
+		m_blend = 1;
+		return;
+	}
+	if (PLANAR == m_stepMode)
+		GatherDiscs();
+	for (unsigned int steps = 0; time - m_lastUpdate >= m_timeStep; ++steps)
+	{
+		// after a long frame, drop the steps over the limit rather than let
+		// catching up make the next frame long as well
+		if (0 < m_maxSteps && m_maxSteps <= steps)
 		{
-			Actor* actor1 = *unchecked.begin();
-			unchecked.erase(actor1);
-			for (auto actor2 : unchecked)
-				Actor::ResolveCollision(actor1, actor2);
+			m_droppedTime = floor((time - m_lastUpdate) / m_timeStep) * m_timeStep;
+			m_lastUpdate += m_droppedTime;
+			break;
 		}
+
+		// in planar mode the 3D step is only needed while something else is awake
+		m_lastUpdate += m_timeStep;
+		if (PLANAR == m_stepMode)
+			StepDiscs();
+		if (PLANAR != m_stepMode || m_awakeCount > m_awakeDiscs)
+			Step();
 	}
+	if (PLANAR == m_stepMode)
+		ReleaseDiscs();
+	m_blend = (float)((time - m_lastUpdate) / m_timeStep);
+}
+
+void Scene::Step()
+{
+	// standard physics update, with fast spheres stopped at their first impact
+	FindSweeps();
+	IntegrateActors();
+	SweepActors();
+
+	// collision resolution
+	FindPairs();
+	FilterSpherePairs();
+	DetectContacts();
+	ResolveContacts();
+	UpdateSupports();
+	UpdateSleep();
+	UpdateTree();
 }
 
 void Scene::QueueMeshes() const
 {
 	for (auto actor : m_actors)
-		actor->QueueMesh();
-}
\ No newline at end of file
+		actor->QueueMesh(m_blend);
+}
@@ -3,38 +3,673 @@
 
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
+#include "AABBTree.h"
 #include "Actor.h"
 #include "Engine.h"
-#include <set>
+#include "WorkerPool.h"
+#include <atomic>
+#include <cfloat>
+#include <functional>
+#include <queue>
+#include <vector>
 
 class Scene
 {
 public:
 
+	// reference to an actor in the scene that goes stale once the actor is
+	// destroyed, even if its slot is reused for another actor
+	struct Handle
+	{
+		int slot;
+		unsigned int generation;
+
+		Handle(int a_slot = -1, unsigned int a_generation = 0)
+			: slot(a_slot), generation(a_generation) {}
+		bool operator==(const Handle& a_other) const
+		{
+			return slot == a_other.slot && generation == a_other.generation;
+		}
+		bool operator!=(const Handle& a_other) const { return !(*this == a_other); }
+	};
+
+	// world-space bounding box of an actor, as seen by the broadphase
+	struct Proxy
+	{
+		Actor* actor;
+		glm::vec3 min;
+		glm::vec3 max;
+		int sphere;	// index into the scene's sphere arrays, or -1 if not a sphere
+
+		Proxy(Actor* a_actor = nullptr, int a_sphere = -1);
+
+		bool Overlaps(const Proxy& a_proxy) const
+		{
+			return (min.x <= a_proxy.max.x && a_proxy.min.x <= max.x &&
+					min.y <= a_proxy.max.y && a_proxy.min.y <= max.y &&
+					min.z <= a_proxy.max.z && a_proxy.min.z <= max.z);
+		}
+		bool IsBounded() const;
+	};
+
+	// candidate pair of actors whose bounds overlap
+	struct Pair
+	{
+		Actor* actor1;
+		Actor* actor2;
+		int sphere1;
+		int sphere2;
+		bool field;	// a sphere and a baked actor, detected from the static field
+
+		Pair(Actor* a_actor1 = nullptr, Actor* a_actor2 = nullptr)
+			: actor1(a_actor1), actor2(a_actor2), sphere1(-1), sphere2(-1), field(false) {}
+		Pair(const Proxy& a_proxy1, const Proxy& a_proxy2)
+			: actor1(a_proxy1.actor), actor2(a_proxy2.actor),
+			  sphere1(a_proxy1.sphere), sphere2(a_proxy2.sphere), field(false) {}
+		bool IsSpherePair() const { return 0 <= sphere1 && 0 <= sphere2; }
+	};
+
+	// contact found by the narrowphase during the last step
+	struct Contact
+	{
+		Actor* actor1;
+		Actor* actor2;
+		Geometry::Collision collision;
+	};
+
+	// narrowphase result for one pair, along with where the actors were when
+	// it was found, so resolution can tell if an earlier contact has moved them
+	struct Detection
+	{
+		glm::vec3 position1;
+		glm::vec3 position2;
+		Geometry::Collision collision;
+		bool touching;
+	};
+
+	// dynamic actors that might touch each other during the last step, and the
+	// pairs between them - each island was solved independently of the others
+	struct Island
+	{
+		unsigned int firstPair;	// into the scene's list of pairs sorted by island
+		unsigned int pairCount;
+		unsigned int actorCount;
+	};
+
+	// sphere moving far enough in one step that it's swept from where it
+	// started to its first impact, so it can't pass through anything
+	struct Sweep
+	{
+		Actor* actor;
+		glm::vec3 start;
+	};
+
+	// sphere in event-driven mode, and the motion it has had since its last event
+	struct EventBall
+	{
+		Actor* actor;
+		float radius;
+		float mass;
+		float dragRate;	// linear drag over mass - the rate its speed decays at
+		float minSpeed;
+		double time;	// of the ball's last event
+		glm::vec3 position;	// and its position and velocity at that time
+		glm::vec3 velocity;
+		glm::quat rotation;	// rolling since the start of the advance, composed move by move
+		unsigned int count;	// of events the ball has had, to spot stale predictions
+
+		float Travel(double a_time) const;	// velocity's multiplier for the displacement at a time
+		glm::vec3 PositionAt(double a_time) const { return position + velocity * Travel(a_time); }
+		glm::vec3 VelocityAt(double a_time) const
+		{
+			return velocity * (float)exp(-dragRate * (a_time - time));
+		}
+		double TimeAt(float a_travel) const;	// inverse of Travel
+		double StopTime() const;
+	};
+
+	// predicted impact between two balls or a ball and a static actor, or a
+	// ball slowing to a stop
+	struct Event
+	{
+		double time;
+		unsigned int ball1;
+		int ball2;	// -1 if it isn't between two balls
+		unsigned int count1;	// event counts of the balls when predicted
+		unsigned int count2;
+		Actor* actor;	// static actor hit, or nullptr for a stop
+		glm::vec3 normal;	// of the static actor's surface
+
+		bool operator>(const Event& a_other) const { return time > a_other.time; }
+	};
+
+	// sphere rolling on a support in planar mode, moved in the plane at right
+	// angles to gravity until it leaves it
+	struct Disc
+	{
+		Actor* actor;	// nullptr once it's left the plane
+		float radius;
+		float height;	// of its center along the up axis
+		float inverseMass;
+		float inverseInertia;
+		float friction;	// against its support
+		float resistance;
+		float stillTime;
+		bool awake;
+		int support;	// footprint it rolls on, or -1 for a plane
+		glm::vec2 position;	// in the plane
+		glm::vec2 velocity;
+		glm::vec3 angularVelocity;	// in world space
+		glm::quat rotation;	// since the start of the update, composed step by step
+		glm::vec2 stepPosition;	// and both at the start of the last step,
+		glm::quat stepRotation;	// for drawing
+	};
+
+	// static box standing upright on the plane, as seen from above
+	struct Footprint
+	{
+		const Actor* actor;
+		glm::vec2 center;
+		glm::vec2 axis;	// along its first side, the second is at right angles
+		glm::vec2 extents;
+		float bottom;	// along the up axis
+		float top;
+
+		glm::vec2 ToLocal(const glm::vec2& a_point) const
+		{
+			glm::vec2 offset = a_point - center;
+			return glm::vec2(glm::dot(offset, axis), axis.x * offset.y - axis.y * offset.x);
+		}
+		glm::vec2 ToPlane(const glm::vec2& a_local) const
+		{
+			return center + axis * a_local.x + glm::vec2(-axis.y, axis.x) * a_local.y;
+		}
+		bool Contains(const glm::vec2& a_point) const
+		{
+			glm::vec2 local = ToLocal(a_point);
+			return fabs(local.x) <= extents.x && fabs(local.y) <= extents.y;
+		}
+	};
+
+	// touching pair of discs, or a disc and a footprint it can't roll past
+	struct DiscContact
+	{
+		unsigned int disc1;
+		int disc2;	// -1 for a footprint
+		const Actor* wall;
+		glm::vec2 normal;	// from disc1 to what it touches
+		float interpenetration;
+		float normalMass;
+		float tangentMass;
+		float friction;
+		float bounceSpeed;
+		float normalImpulse;
+		float tangentImpulse;
+	};
+
+	// point of a touching pair as set up for the contact solver, along with
+	// the impulses built up over its iterations.  The scene solves in float,
+	// and sphere batches can solve in double from the same source
+	template<typename Real>
+	struct BasicSolverContact
+	{
+		typename Geometry::Precision<Real>::vec3 normal;
+		typename Geometry::Precision<Real>::vec3 tangent1;
+		typename Geometry::Precision<Real>::vec3 tangent2;
+		typename Geometry::Precision<Real>::vec3 r1;	// from each actor's position to the contact point
+		typename Geometry::Precision<Real>::vec3 r2;
+		Real inverseMass1;
+		Real inverseMass2;
+		typename Geometry::Precision<Real>::mat3 inverseInertia1;	// in world space
+		typename Geometry::Precision<Real>::mat3 inverseInertia2;
+		Real normalMass;	// effective mass along each direction
+		Real tangentMass1;
+		Real tangentMass2;
+		Real friction;
+		Real bounceSpeed;	// separating speed the contact's elasticity asks for
+		Real interpenetration;
+		Real normalImpulse;
+		typename Geometry::Precision<Real>::vec2 tangentImpulse;	// along tangent1 and tangent2
+	};
+	typedef BasicSolverContact<float> SolverContact;
+
+	// impulses a touching pair's points ended the last step with, so the
+	// solver can start the pair's next step from them instead of from nothing
+	struct CachedImpulse
+	{
+		Actor* actor1;	// the pair's actors in address order, so the key
+		Actor* actor2;	// doesn't depend on which way round they were paired
+		unsigned int pointCount;
+		float normalImpulses[Geometry::Collision::MAX_POINTS];
+		glm::vec3 tangentImpulses[Geometry::Collision::MAX_POINTS];	// on actor2, in world space
+
+		bool operator<(const CachedImpulse& a_other) const
+		{
+			return (actor1 != a_other.actor1 ? std::less<Actor*>()(actor1, a_other.actor1) :
+					std::less<Actor*>()(actor2, a_other.actor2));
+		}
+	};
+
+	// direction the last hull query for a pair ended searching along, which
+	// the next one starts from - a pair that's only moved a little since is
+	// usually settled by its first iteration
+	struct CachedAxis
+	{
+		const Actor* actor1;	// in address order, as for impulses
+		const Actor* actor2;
+		glm::vec3 axis;	// from actor1 towards actor2
+
+		bool operator<(const CachedAxis& a_other) const
+		{
+			return (actor1 != a_other.actor1 ? std::less<const Actor*>()(actor1, a_other.actor1) :
+					std::less<const Actor*>()(actor2, a_other.actor2));
+		}
+	};
+
+	// structure-of-arrays copy of every sphere's position and radius, so that
+	// sphere/sphere pairs can be tested several at a time with SIMD
+	struct Spheres
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> radius;
+
+		unsigned int size() const { return radius.size(); }
+		void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+		int Add(const Geometry::Sphere& a_sphere)
+		{
+			x.push_back(a_sphere.position.x);
+			y.push_back(a_sphere.position.y);
+			z.push_back(a_sphere.position.z);
+			radius.push_back(a_sphere.radius);
+			return radius.size() - 1;
+		}
+	};
+
+	// signed distance to the nearest of the static actors baked into it,
+	// sampled on a grid along with its gradient and which actor is nearest
+	struct StaticField
+	{
+		glm::vec3 origin;	// of the first sample
+		float cellSize;
+		unsigned int counts[3];	// of samples along each axis
+		std::vector<float> distances;	// negative inside an actor
+		std::vector<glm::vec3> gradients;	// away from the nearest surface
+		std::vector<unsigned int> nearest;	// into actors
+		std::vector<float> seconds;	// distance to the second nearest actor
+		std::vector<unsigned char> coarse;	// one per cell, set if it needs exact detection
+		std::vector<float> clearances;	// one per cell, least distance to any but the nearest actor
+		std::vector<Actor*> actors;	// in the order the scene held them
+		std::vector<const Actor*> sorted;	// the same actors by address, for Contains
+		std::vector<glm::vec3> positions;	// of the actors, where they were baked
+		std::vector<glm::quat> orientations;
+		std::vector<glm::vec3> scales;
+
+		StaticField() : origin(0), cellSize(0) { counts[0] = counts[1] = counts[2] = 0; }
+		bool IsEmpty() const { return distances.empty(); }
+		void Clear();
+		unsigned int IndexOf(unsigned int a_x, unsigned int a_y, unsigned int a_z) const
+		{
+			return (a_z * counts[1] + a_y) * counts[0] + a_x;
+		}
+		void MarkCoarseCells();
+		void StorePoses();
+		// true once any actor has moved, turned or been resized since the field was baked
+		bool HasMoved() const;
+		// false if the point is outside the grid or in a coarse cell
+		bool Sample(const glm::vec3& a_point, float& a_distance, glm::vec3& a_gradient,
+					unsigned int& a_actor, float& a_clearance) const;
+		bool Contains(const Actor* a_actor) const;
+	};
+
+	// structure-of-arrays copy of the state of every free actor, so that they
+	// can be integrated several at a time with SIMD.  The scene integrates in
+	// float, but a batch can be kept in double as well, to measure how far the
+	// float one drifts from it over a long run
+	template<typename Real>
+	struct BasicBodies
+	{
+		std::vector<Real> x, y, z;
+		std::vector<Real> vx, vy, vz;
+		std::vector<Real> wx, wy, wz;
+		std::vector<Real> qx, qy, qz, qw;
+		std::vector<Real> fx, fy, fz;
+		std::vector<Real> mass;
+		std::vector<Real> linearDrag;
+		std::vector<Real> tx, ty, tz;
+		std::vector<Real> rotationalInertia;
+		std::vector<Real> minSpeed2;
+		std::vector<Real> minAngularSpeed2;
+
+		unsigned int size() const { return mass.size(); }
+		void resize(unsigned int a_size);
+		void Gather(unsigned int a_body, const Actor& a_actor, const glm::vec3& a_gravity);
+		void Scatter(unsigned int a_body, Actor& a_actor) const;
+	};
+	typedef BasicBodies<float> Bodies;
+
+	// one step of the same integration free actors get, on a range of a batch
+	template<typename Real>
+	static void IntegrateBodies(BasicBodies<Real>& a_bodies, unsigned int a_begin, unsigned int a_end,
+								Real a_deltaTime);
+
+	// a batch of spheres resting on or falling onto a plane, which can take a
+	// whole step - integration, the sphere detectors and the contact solver -
+	// in either precision, so the float step can be measured against double
+	template<typename Real>
+	struct BasicSpheres
+	{
+		BasicBodies<Real> bodies;
+		std::vector<Real> radius;
+		typename Geometry::Precision<Real>::vec3 planeNormal;
+		typename Geometry::Precision<Real>::vec3 planePosition;
+		Real elasticity;	// one material for every sphere and the plane
+		Real friction;
+
+		// working space kept between steps, so a step doesn't allocate
+		std::vector<unsigned int> order;	// by lowest x
+		std::vector<BasicSolverContact<Real>> contacts;
+		std::vector<int> contactBodies;	// two per contact, and -1 for the plane
+
+		unsigned int size() const { return radius.size(); }
+		void resize(unsigned int a_size)
+		{
+			bodies.resize(a_size);
+			radius.resize(a_size);
+		}
+	};
+
+	// one step of a sphere batch - it's solved the way the scene solves an
+	// island, except that with no impulse cache there's no warm start
+	template<typename Real>
+	static void StepSpheres(BasicSpheres<Real>& a_spheres, Real a_deltaTime, unsigned int a_iterations);
+
+	// ray or swept sphere query
+	struct Ray
+	{
+		glm::vec3 origin;
+		glm::vec3 direction;
+		float maxDistance;
+		const Actor* ignore;	// e.g. the actor the ray is fired from
+
+		Ray(const glm::vec3& a_origin = glm::vec3(0),
+			const glm::vec3& a_direction = glm::vec3(0, 0, 1),
+			float a_maxDistance = FLT_MAX, const Actor* a_ignore = nullptr)
+			: origin(a_origin), direction(a_direction), maxDistance(a_maxDistance),
+			  ignore(a_ignore) {}
+	};
+
+	// first thing a ray or swept sphere hits
+	struct Hit
+	{
+		Actor* actor;	// nullptr if nothing was hit
+		float distance;
+		glm::vec3 point;
+		glm::vec3 normal;	// surface normal of the actor that was hit
+
+		Hit() : actor(nullptr), distance(FLT_MAX), point(0), normal(0) {}
+	};
+
+	// actor overlapping the query shape at the given index
+	struct OverlapResult
+	{
+		unsigned int query;
+		Actor* actor;
+
+		OverlapResult(unsigned int a_query = 0, Actor* a_actor = nullptr)
+			: query(a_query), actor(a_actor) {}
+	};
+
+	enum StepMode
+	{
+		FIXED_STEP,	// integrate every actor at the scene's time step
+		EVENT_DRIVEN,	// jump from one predicted impact to the next
+		PLANAR,	// move balls on the bed in the plane, and everything else in 3D
+	};
+
+	// implemented in Scene_Broadphase.h
+	struct Broadphase;
+	struct SweepAndPrune;
+	struct UniformGrid;
+
 	Scene(const glm::vec3& a_gravity = glm::vec3(0.0f, -9.81f, 0.0f),
-		  double a_timeStep = 0.01)
-		: m_gravity(a_gravity), m_timeStep(a_timeStep),
-		m_lastUpdate(Engine::GetElapsedTime()) {}
-	~Scene() { ClearActors(); }
+		  double a_timeStep = 0.01);
+	~Scene();
 
-	void AddActor(Actor* a_actor);
+	// the scene owns the actors added to it - adding one twice returns the
+	// handle it already has
+	Handle AddActor(Actor* a_actor);
 	void ClearActors();
 	bool DestroyActor(Actor* a_actor);	// returns false if actor not in scene
-	const std::set<Actor*>& GetActors() const { return m_actors; }
-	bool HasActor(Actor* a_actor) const { return nullptr != a_actor && 0 != m_actors.count(a_actor); }
-	void QueueMeshes() const;
+	bool DestroyActor(const Handle& a_handle);
+	const std::vector<Actor*>& GetActors() const { return m_actors; }	// in no particular order
+	bool HasActor(const Actor* a_actor) const { return 0 <= BodyOf(a_actor); }
+	Actor* GetActor(const Handle& a_handle) const;	// nullptr if the handle is stale
+	Handle GetHandle(const Actor* a_actor) const;
+	void QueueMeshes() const;	// at poses blended between the last two steps
+
+	// batched queries against the scene's bounding volume tree - each fills
+	// one entry of a_hits per ray and returns the number of rays that hit
+	unsigned int Raycast(const Ray* a_rays, unsigned int a_count, Hit* a_hits) const;
+	unsigned int SphereCast(const Ray* a_rays, unsigned int a_count, float a_radius,
+							Hit* a_hits) const;
+	// appends every actor touching each sphere and returns the number appended
+	unsigned int Overlap(const Geometry::Sphere* a_spheres, unsigned int a_count,
+						 std::vector<OverlapResult>& a_results) const;
+
+	const std::vector<Contact>& GetContacts() const { return m_contacts; }
+	const std::vector<Island>& GetIslands() const { return m_islands; }
+
+	// dynamic actors that are still for this long, along with everything they
+	// touch, go to sleep - zero or less turns sleeping off
+	float GetTimeToSleep() const { return m_timeToSleep; }
+	void SetTimeToSleep(float a_seconds);
+	unsigned int GetAwakeCount() const { return m_awakeCount; }
+	// velocity iterations the contact solver runs over each island - zero
+	// resolves each contact once, as soon as it's found
+	unsigned int GetSolverIterations() const { return m_solverIterations; }
+	void SetSolverIterations(unsigned int a_iterations) { m_solverIterations = a_iterations; }
+	// fast spheres stop at their first impact instead of passing through thin
+	// actors during a large step
+	bool IsContinuous() const { return m_continuous; }
+	void SetContinuous(bool a_continuous) { m_continuous = a_continuous; }
+	// spheres resting on the flat top of a static box or plane roll along it
+	// on their own instead of through a contact with it, until they leave it
+	// - always the case in planar mode
+	bool IsSupportingSpheres() const { return m_supportingSpheres || PLANAR == m_stepMode; }
+	void SetSupportingSpheres(bool a_supporting);
+	// most steps Update will run to catch up in one call - any more whole
+	// steps are dropped, and zero means there's no limit
+	unsigned int GetMaxSteps() const { return m_maxSteps; }
+	void SetMaxSteps(unsigned int a_maxSteps) { m_maxSteps = a_maxSteps; }
+	double GetDroppedTime() const { return m_droppedTime; }	// during the last Update
+	// event-driven mode only moves dynamic spheres, which must be rolling on
+	// a flat bed at right angles to gravity - falling into a pocket isn't
+	// modelled, and other dynamic actors stay where they are
+	// planar mode moves supported spheres in the plane at right angles to
+	// gravity, against each other and against static boxes standing upright
+	// on it - a ball goes back to the 3D step, until it's supported again,
+	// once it's no longer over its support or anything else comes near it
+	StepMode GetStepMode() const { return m_stepMode; }
+	void SetStepMode(StepMode a_stepMode) { m_stepMode = a_stepMode; }
+	// moves the scene on by the given time in event-driven mode, whatever the
+	// step mode, and returns the number of events handled
+	unsigned int AdvanceEvents(double a_seconds);
+	// threads used for the narrowphase - zero means one per hardware thread
+	unsigned int GetThreadCount() const { return m_workers.GetThreadCount(); }
+	void SetThreadCount(unsigned int a_threadCount) { m_workers.SetThreadCount(a_threadCount); }
+
+	// the static actors can be baked into one signed distance field, after
+	// which a dynamic sphere is tested against all of them with one lookup -
+	// exact detection only runs where the grid is too coarse to follow the
+	// surface, near edges and where actors meet.  Baked actors mustn't move,
+	// and destroying one throws the field away.  A saved field is matched to
+	// the static actors in the order the scene holds them, so it can only be
+	// loaded into a scene built the same way - loading returns false if not
+	bool BakeStaticField(float a_cellSize, float a_margin = 0);
+	bool SaveStaticField(const char* a_filename) const;
+	bool LoadStaticField(const char* a_filename);
+	void ClearStaticField() { m_staticField.Clear(); }
+	bool HasStaticField() const { return !m_staticField.IsEmpty(); }
+
+	const Broadphase& GetBroadphase() const { return *m_broadphase; }
+	void SetBroadphase(Broadphase* a_broadphase);	// scene takes ownership
 
 	virtual void Update();
 
 
 protected:
 
+	// entry in the handle table
+	struct Slot
+	{
+		unsigned int generation;	// moves on every time the slot is freed
+		int body;	// index into the body arrays, doubling as the next link in the free list
+	};
+
+	// index into the body arrays, or -1 if the actor isn't in the scene
+	int BodyOf(const Actor* a_actor) const
+	{
+		if (nullptr == a_actor || 0 > a_actor->GetSceneSlot() ||
+			m_slots.size() <= (unsigned int)a_actor->GetSceneSlot())
+			return -1;
+		int body = m_slots[a_actor->GetSceneSlot()].body;
+		return (0 <= body && m_actors.size() > (unsigned int)body && m_actors[body] == a_actor ? body : -1);
+	}
+	void RemoveBody(int a_body);
+
+	bool IsDisc(unsigned int a_body) const
+	{
+		return a_body < m_discIndices.size() && 0 <= m_discIndices[a_body];
+	}
+	void Step();
+	void GatherDiscs();
+	void StepDiscs();
+	void MoveDiscs();
+	void SweepDiscs();
+	bool LeavesPlane(unsigned int a_disc);
+	void FindDiscContacts();
+	void SolveDiscContacts();
+	void UpdateDiscSleep();
+	void ReleaseDisc(unsigned int a_disc);
+	void ReleaseDiscs();
+	glm::vec3 ToWorld(const glm::vec2& a_vector) const { return m_planeX * a_vector.x + m_planeY * a_vector.y; }
+	glm::vec2 ToPlane(const glm::vec3& a_vector) const
+	{
+		return glm::vec2(glm::dot(a_vector, m_planeX), glm::dot(a_vector, m_planeY));
+	}
+
+	void PredictEvents(unsigned int a_ball, double a_time, double a_endTime, bool a_allPairs);
+	void PredictStaticEvent(unsigned int a_ball, double a_time, double a_endTime);
+	void PredictPairEvent(unsigned int a_ball1, unsigned int a_ball2, double a_time, double a_endTime);
+	void HandleEvent(const Event& a_event, double a_endTime);
+	void MoveEventBall(EventBall& a_ball, double a_time);
+	void IntegrateActors();
+	void FindSweeps();
+	void SweepActors();
+	void FindPairs();
+	void DropSupportPairs();
+	void FilterSpherePairs();
+	void GatherStaticActors(std::vector<Actor*>& a_actors) const;
+	void DropFieldPairs();
+	bool DetectPair(const Pair& a_pair, Geometry::Collision* a_collision) const;
+	void DetectContacts();
+	glm::vec3 CachedAxisOf(const Pair& a_pair) const;
+	void UpdateAxisCache();
+	void BuildIslands();
+	int IslandIndexOf(Actor* a_actor) const;
+	static unsigned int FindRoot(std::vector<unsigned int>& a_parents, unsigned int a_index);
+	static void Join(std::vector<unsigned int>& a_parents, int a_index1, int a_index2);
+	void ResolveContacts();
+	void ResolvePair(unsigned int a_pair);
+	void SolveContacts();
+	void PrepareContact(unsigned int a_pair);
+	void SolveContact(unsigned int a_pair);
+	void CorrectContact(unsigned int a_pair);
+	void UpdateImpulseCache();
+	void ForgetImpulses(Actor* a_actor);
+	void ForgetSupport(const Actor* a_support);
+	void UpdateSupports();
+	void UpdateSleep();
+	void UpdateTree();
+
 	glm::vec3 m_gravity;
 	double m_timeStep;
 	double m_lastUpdate;
+	unsigned int m_maxSteps;
+	double m_droppedTime;
+	float m_blend;	// how far into the next step the last Update left off
+
+	// actors are kept packed in the body arrays - removing one moves the last
+	// into its place - and handles find them through the slots.  Their state
+	// is in m_bodyStore, in the same order
+	std::vector<Actor*> m_actors;
+	Actor::Store m_bodyStore;
+	std::vector<int> m_bodySlots;
+	std::vector<int> m_treeProxies;
+	std::vector<Slot> m_slots;
+	int m_freeSlots;	// head of the free list, or -1
+
+	StepMode m_stepMode;
+	glm::vec3 m_up;	// away from gravity, or zero if there isn't any
+	std::vector<EventBall> m_eventBalls;
+	std::priority_queue<Event, std::vector<Event>, std::greater<Event>> m_events;
+
+	std::vector<Actor*> m_freeActors;	// in the same order as m_bodies
+	Bodies m_bodies;
 
-	std::set<Actor*> m_actors;
+	bool m_continuous;
+	std::vector<Sweep> m_sweeps;
+
+	glm::vec3 m_planeX;	// axes of the plane in planar mode
+	glm::vec3 m_planeY;
+	std::vector<Disc> m_discs;
+	std::vector<int> m_discIndices;	// one per body - into m_discs, or -1 if it isn't one
+	std::vector<unsigned int> m_discOrder;	// sorted along the plane's x axis
+	unsigned int m_awakeDiscs;	// whose actors were awake when they were gathered
+	unsigned int m_discSteps;	// since they were gathered
+	std::vector<Footprint> m_footprints;
+	std::vector<const Actor*> m_obstacles;	// any other static actors
+	std::vector<DiscContact> m_discContacts;
+
+	bool m_supportingSpheres;
+
+	Broadphase* m_broadphase;
+	std::vector<Proxy> m_dynamicProxies;
+	std::vector<Proxy> m_staticProxies;
+	std::vector<Pair> m_pairs;
+	Spheres m_spheres;
+	std::vector<unsigned int> m_spherePairs;
+	std::vector<unsigned char> m_sphereOverlaps;
+	StaticField m_staticField;
+	std::vector<int> m_fieldResults;	// one per sphere - see DropFieldPairs
+	std::vector<Detection> m_detections;	// one per pair
+	std::vector<CachedAxis> m_axisCache;	// sorted, for pairs with a hull
+	std::vector<Contact> m_contacts;
+	WorkerPool m_workers;
+
+	AABBTree m_tree;
+
+	float m_timeToSleep;
+	std::atomic<unsigned int> m_awakeCount;
+	std::vector<Actor*> m_islandActors;	// dynamic actors, in the same order as m_actors
+	std::vector<int> m_islandIndices;	// one per body - into m_islandActors, or -1 if static
+	std::vector<unsigned int> m_islandParents;
+	std::vector<int> m_actorIslands;
+	std::vector<Island> m_islands;
+	std::vector<unsigned int> m_pairIslands;
+	std::vector<unsigned int> m_islandPairs;	// pair indices, sorted by island
+	std::vector<unsigned int> m_sleepParents;
+	std::vector<float> m_sleepStillTimes;
+
+	unsigned int m_solverIterations;
+	std::vector<SolverContact> m_solverContacts;	// one per point of each touching pair
+	std::vector<unsigned int> m_firstSolverContacts;	// one per pair, and one past the last
+	std::vector<CachedImpulse> m_impulseCache;	// sorted
 
 };
 
+#include "Scene_Broadphase.h"
+
 #endif	// _SCENE_H_
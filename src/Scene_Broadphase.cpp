@@ -0,0 +1,302 @@
+#include "Scene.h"
+#include <algorithm>
+#include <cfloat>
+
+//
+// Sweep and prune
+//
+
+void Scene::SweepAndPrune::Sort(const std::vector<Proxy>& a_proxies, unsigned int a_axis,
+								std::vector<Actor*>& a_actors, std::vector<unsigned int>& a_order)
+{
+	auto lessThan = [&](unsigned int a_index1, unsigned int a_index2)
+	{
+		return a_proxies[a_index1].min[a_axis] < a_proxies[a_index2].min[a_axis];
+	};
+
+	// if the proxies aren't the same actors as last time, start over
+	bool unchanged = (a_actors.size() == a_proxies.size());
+	for (unsigned int i = 0; unchanged && i < a_proxies.size(); ++i)
+		unchanged = (a_actors[i] == a_proxies[i].actor);
+	if (!unchanged)
+	{
+		a_actors.resize(a_proxies.size());
+		a_order.resize(a_proxies.size());
+		for (unsigned int i = 0; i < a_proxies.size(); ++i)
+		{
+			a_actors[i] = a_proxies[i].actor;
+			a_order[i] = i;
+		}
+		std::sort(a_order.begin(), a_order.end(), lessThan);
+		return;
+	}
+
+	// otherwise the old order is nearly right, so an insertion sort is close to linear
+	for (unsigned int i = 1; i < a_order.size(); ++i)
+	{
+		unsigned int index = a_order[i];
+		unsigned int j = i;
+		for (; 0 < j && lessThan(index, a_order[j - 1]); --j)
+			a_order[j] = a_order[j - 1];
+		a_order[j] = index;
+	}
+}
+
+void Scene::SweepAndPrune::FindPairs(const std::vector<Proxy>& a_dynamic,
+									 const std::vector<Proxy>& a_static,
+									 std::vector<Pair>& a_pairs)
+{
+	// sweep along whichever axis the dynamic proxies are most spread out on
+	if (1 < a_dynamic.size())
+	{
+		glm::vec3 mean(0), meanSquare(0);
+		for (auto& proxy : a_dynamic)
+		{
+			if (!proxy.IsBounded())
+				continue;
+			glm::vec3 center = (proxy.min + proxy.max) * 0.5f;
+			mean += center;
+			meanSquare += center * center;
+		}
+		mean /= (float)a_dynamic.size();
+		meanSquare /= (float)a_dynamic.size();
+		glm::vec3 variance = meanSquare - mean * mean;
+		m_axis = (variance.x >= variance.y && variance.x >= variance.z ? 0 :
+				  variance.y >= variance.z ? 1 : 2);
+	}
+	unsigned int y = (m_axis + 1) % 3;
+	unsigned int z = (m_axis + 2) % 3;
+	auto overlap = [&](const Proxy& a_proxy1, const Proxy& a_proxy2)
+	{
+		return (a_proxy1.min[y] <= a_proxy2.max[y] && a_proxy2.min[y] <= a_proxy1.max[y] &&
+				a_proxy1.min[z] <= a_proxy2.max[z] && a_proxy2.min[z] <= a_proxy1.max[z]);
+	};
+	Sort(a_dynamic, m_axis, m_dynamicActors, m_dynamicOrder);
+	Sort(a_static, m_axis, m_staticActors, m_staticOrder);
+
+	// dynamic vs dynamic
+	for (unsigned int i = 0; i < m_dynamicOrder.size(); ++i)
+	{
+		const Proxy& proxy1 = a_dynamic[m_dynamicOrder[i]];
+		for (unsigned int j = i + 1; j < m_dynamicOrder.size(); ++j)
+		{
+			const Proxy& proxy2 = a_dynamic[m_dynamicOrder[j]];
+			if (proxy2.min[m_axis] > proxy1.max[m_axis])
+				break;
+			if (overlap(proxy1, proxy2))
+				a_pairs.push_back(Pair(proxy1, proxy2));
+		}
+	}
+
+	// dynamic vs static - walk both sorted lists together, testing each proxy
+	// against the still-open intervals of the other partition
+	m_activeDynamic.clear();
+	m_activeStatic.clear();
+	auto prune = [&](const std::vector<Proxy>& a_proxies, std::vector<unsigned int>& a_active, float a_min)
+	{
+		for (unsigned int i = 0; i < a_active.size();)
+		{
+			if (a_proxies[a_active[i]].max[m_axis] < a_min)
+			{
+				a_active[i] = a_active.back();
+				a_active.pop_back();
+			}
+			else
+				++i;
+		}
+	};
+	// a proxy of either partition can still meet the other's open intervals
+	// once that partition's list has run out, so keep going until neither can
+	unsigned int d = 0, s = 0;
+	while ((d < m_dynamicOrder.size() && (s < m_staticOrder.size() || !m_activeStatic.empty())) ||
+		   (s < m_staticOrder.size() && !m_activeDynamic.empty()))
+	{
+		if (d < m_dynamicOrder.size() &&
+			(s >= m_staticOrder.size() ||
+			 a_dynamic[m_dynamicOrder[d]].min[m_axis] <= a_static[m_staticOrder[s]].min[m_axis]))
+		{
+			const Proxy& proxy = a_dynamic[m_dynamicOrder[d]];
+			prune(a_static, m_activeStatic, proxy.min[m_axis]);
+			for (auto index : m_activeStatic)
+			{
+				if (overlap(proxy, a_static[index]))
+					a_pairs.push_back(Pair(proxy, a_static[index]));
+			}
+			m_activeDynamic.push_back(m_dynamicOrder[d++]);
+		}
+		else
+		{
+			const Proxy& proxy = a_static[m_staticOrder[s]];
+			prune(a_dynamic, m_activeDynamic, proxy.min[m_axis]);
+			for (auto index : m_activeDynamic)
+			{
+				if (overlap(a_dynamic[index], proxy))
+					a_pairs.push_back(Pair(a_dynamic[index], proxy));
+			}
+			m_activeStatic.push_back(m_staticOrder[s++]);
+		}
+	}
+}
+
+//
+// Uniform grid
+//
+
+glm::ivec3 Scene::UniformGrid::CellOf(const glm::vec3& a_point) const
+{
+	return glm::ivec3((int)floor(a_point.x / m_currentCellSize),
+					  (int)floor(a_point.y / m_currentCellSize),
+					  (int)floor(a_point.z / m_currentCellSize));
+}
+
+bool Scene::UniformGrid::Bin(const Proxy& a_proxy, unsigned int a_index,
+							 std::vector<Cell>& a_cells) const
+{
+	if (!a_proxy.IsBounded())
+		return false;
+	glm::ivec3 low = CellOf(a_proxy.min);
+	glm::ivec3 high = CellOf(a_proxy.max);
+	double count = (double)(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+	if (count > m_maxCellsPerProxy)
+		return false;
+	Cell cell;
+	cell.proxy = a_index;
+	for (cell.x = low.x; cell.x <= high.x; ++cell.x)
+		for (cell.y = low.y; cell.y <= high.y; ++cell.y)
+			for (cell.z = low.z; cell.z <= high.z; ++cell.z)
+				a_cells.push_back(cell);
+	return true;
+}
+
+void Scene::UniformGrid::BinStatics(const std::vector<Proxy>& a_static)
+{
+	// statics can cover a lot of cells, so allow them many more than dynamic proxies
+	unsigned int maxCells = m_maxCellsPerProxy;
+	m_maxCellsPerProxy *= 1024;
+	m_staticCells.clear();
+	m_largeStatic.clear();
+	for (unsigned int i = 0; i < a_static.size(); ++i)
+	{
+		if (!Bin(a_static[i], i, m_staticCells))
+			m_largeStatic.push_back(i);
+	}
+	m_maxCellsPerProxy = maxCells;
+	std::sort(m_staticCells.begin(), m_staticCells.end());
+	m_binnedStatics = a_static;
+	m_staticStamps.assign(a_static.size(), 0);
+	m_stamp = 0;
+}
+
+void Scene::UniformGrid::FindPairs(const std::vector<Proxy>& a_dynamic,
+								   const std::vector<Proxy>& a_static,
+								   std::vector<Pair>& a_pairs)
+{
+	// size cells to the largest dynamic proxy, rounded up to a power of two so
+	// that small changes in a rotating proxy's bounds don't rebin the statics
+	float cellSize = m_cellSize;
+	if (0 >= cellSize)
+	{
+		for (auto& proxy : a_dynamic)
+		{
+			if (!proxy.IsBounded())
+				continue;
+			glm::vec3 size = proxy.max - proxy.min;
+			cellSize = fmax(cellSize, fmax(size.x, fmax(size.y, size.z)));
+		}
+		cellSize = (0 < cellSize ? (float)pow(2.0, ceil(log(cellSize) / log(2.0))) : 1.0f);
+	}
+
+	// rebin statics if they've changed
+	bool staticsChanged = (cellSize != m_currentCellSize ||
+						   a_static.size() != m_binnedStatics.size());
+	for (unsigned int i = 0; !staticsChanged && i < a_static.size(); ++i)
+	{
+		staticsChanged = (a_static[i].actor != m_binnedStatics[i].actor ||
+						  a_static[i].min != m_binnedStatics[i].min ||
+						  a_static[i].max != m_binnedStatics[i].max);
+	}
+	m_currentCellSize = cellSize;
+	if (staticsChanged)
+		BinStatics(a_static);
+
+	// bin dynamics, testing each against the statics in the cells it covers
+	m_dynamicCells.clear();
+	m_largeDynamic.clear();
+	for (unsigned int i = 0; i < a_dynamic.size(); ++i)
+	{
+		const Proxy& proxy = a_dynamic[i];
+		unsigned int first = m_dynamicCells.size();
+		if (!Bin(proxy, i, m_dynamicCells))
+		{
+			m_largeDynamic.push_back(i);
+			continue;
+		}
+		if (0 == ++m_stamp)
+		{
+			m_staticStamps.assign(m_staticStamps.size(), 0);
+			m_stamp = 1;
+		}
+		for (unsigned int c = first; c < m_dynamicCells.size(); ++c)
+		{
+			Cell key = m_dynamicCells[c];
+			key.proxy = 0;
+			for (auto cell = std::lower_bound(m_staticCells.begin(), m_staticCells.end(), key);
+				 cell != m_staticCells.end() && cell->SameCell(key); ++cell)
+			{
+				if (m_stamp == m_staticStamps[cell->proxy])
+					continue;
+				m_staticStamps[cell->proxy] = m_stamp;
+				if (proxy.Overlaps(a_static[cell->proxy]))
+					a_pairs.push_back(Pair(proxy, a_static[cell->proxy]));
+			}
+		}
+		for (auto index : m_largeStatic)
+		{
+			if (proxy.Overlaps(a_static[index]))
+				a_pairs.push_back(Pair(proxy, a_static[index]));
+		}
+	}
+
+	// dynamic vs dynamic in shared cells - a pair may share several cells, so
+	// only report it from the cell holding the low corner of the overlap
+	std::sort(m_dynamicCells.begin(), m_dynamicCells.end());
+	for (unsigned int begin = 0, end = 0; begin < m_dynamicCells.size(); begin = end)
+	{
+		const Cell& cell = m_dynamicCells[begin];
+		for (end = begin + 1; end < m_dynamicCells.size() && cell.SameCell(m_dynamicCells[end]); ++end);
+		for (unsigned int i = begin; i < end; ++i)
+		{
+			const Proxy& proxy1 = a_dynamic[m_dynamicCells[i].proxy];
+			for (unsigned int j = i + 1; j < end; ++j)
+			{
+				const Proxy& proxy2 = a_dynamic[m_dynamicCells[j].proxy];
+				if (!proxy1.Overlaps(proxy2))
+					continue;
+				glm::ivec3 corner = CellOf(glm::max(proxy1.min, proxy2.min));
+				if (corner.x == cell.x && corner.y == cell.y && corner.z == cell.z)
+					a_pairs.push_back(Pair(proxy1, proxy2));
+			}
+		}
+	}
+
+	// proxies too big to bin get tested against everything
+	for (unsigned int i = 0; i < m_largeDynamic.size(); ++i)
+	{
+		unsigned int index = m_largeDynamic[i];
+		const Proxy& proxy = a_dynamic[index];
+		for (unsigned int j = 0; j < a_dynamic.size(); ++j)
+		{
+			// pairs of large proxies are only tested once
+			if (j == index || (j < index && m_largeDynamic.end() !=
+				std::find(m_largeDynamic.begin(), m_largeDynamic.end(), j)))
+				continue;
+			if (proxy.Overlaps(a_dynamic[j]))
+				a_pairs.push_back(Pair(proxy, a_dynamic[j]));
+		}
+		for (auto& other : a_static)
+		{
+			if (proxy.Overlaps(other))
+				a_pairs.push_back(Pair(proxy, other));
+		}
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include "Scene.h"
+
+// Generates candidate pairs from world-space bounds.  Static proxies live in
+// their own partition and are never paired with each other.
+struct Scene::Broadphase
+{
+	virtual ~Broadphase() {}
+
+	// appends a pair for every dynamic/dynamic and dynamic/static overlap
+	virtual void FindPairs(const std::vector<Proxy>& a_dynamic,
+						   const std::vector<Proxy>& a_static,
+						   std::vector<Pair>& a_pairs) = 0;
+};
+
+// Sorts proxies along the axis with the greatest spread and sweeps for
+// overlapping intervals.  The sort order is kept between steps, so when the
+// same actors are passed in again the insertion sort only has to fix up the
+// few proxies that changed places.
+struct Scene::SweepAndPrune : public Broadphase
+{
+	SweepAndPrune() : m_axis(0) {}
+
+	virtual void FindPairs(const std::vector<Proxy>& a_dynamic,
+						   const std::vector<Proxy>& a_static,
+						   std::vector<Pair>& a_pairs);
+
+	unsigned int axis() const { return m_axis; }
+
+private:
+
+	static void Sort(const std::vector<Proxy>& a_proxies, unsigned int a_axis,
+					 std::vector<Actor*>& a_actors, std::vector<unsigned int>& a_order);
+
+	unsigned int m_axis;
+	std::vector<Actor*> m_dynamicActors;
+	std::vector<unsigned int> m_dynamicOrder;
+	std::vector<Actor*> m_staticActors;
+	std::vector<unsigned int> m_staticOrder;
+	std::vector<unsigned int> m_activeDynamic;
+	std::vector<unsigned int> m_activeStatic;
+};
+
+// Hashes proxies into cubic cells and pairs up proxies that share a cell.
+// Statics are binned once into a separate grid and only rebinned when they
+// move or the cell size changes.
+struct Scene::UniformGrid : public Broadphase
+{
+	// a cell size of zero means cells are sized to the largest dynamic proxy
+	UniformGrid(float a_cellSize = 0.0f, unsigned int a_maxCellsPerProxy = 64)
+		: m_cellSize(a_cellSize), m_currentCellSize(0), m_maxCellsPerProxy(a_maxCellsPerProxy),
+		  m_stamp(0) {}
+
+	virtual void FindPairs(const std::vector<Proxy>& a_dynamic,
+						   const std::vector<Proxy>& a_static,
+						   std::vector<Pair>& a_pairs);
+
+	float cellSize() const { return m_currentCellSize; }
+
+private:
+
+	struct Cell
+	{
+		int x, y, z;
+		unsigned int proxy;
+
+		bool operator<(const Cell& a_cell) const
+		{
+			return (x != a_cell.x ? x < a_cell.x :
+					y != a_cell.y ? y < a_cell.y :
+					z != a_cell.z ? z < a_cell.z : proxy < a_cell.proxy);
+		}
+		bool SameCell(const Cell& a_cell) const
+		{
+			return x == a_cell.x && y == a_cell.y && z == a_cell.z;
+		}
+	};
+
+	// returns false if the proxy covers too many cells to be binned
+	bool Bin(const Proxy& a_proxy, unsigned int a_index, std::vector<Cell>& a_cells) const;
+	glm::ivec3 CellOf(const glm::vec3& a_point) const;
+	void BinStatics(const std::vector<Proxy>& a_static);
+
+	float m_cellSize;
+	float m_currentCellSize;
+	unsigned int m_maxCellsPerProxy;
+	unsigned int m_stamp;
+	std::vector<Cell> m_dynamicCells;
+	std::vector<unsigned int> m_largeDynamic;
+	std::vector<Cell> m_staticCells;
+	std::vector<unsigned int> m_largeStatic;
+	std::vector<Proxy> m_binnedStatics;
+	std::vector<unsigned int> m_staticStamps;
+};
@@ -0,0 +1,73 @@
+#include "Scene.h"
+
+// A sphere that moves more than a fraction of its radius in one step could
+// skip past a thin actor, or end the step so deep inside one that it's pushed
+// out the far side.  Those spheres are swept from where they started the step
+// to where integration left them, against the bounding volume tree, and moved
+// back to just past their first impact so the narrowphase finds the contact.
+// The rest of the step's motion is dropped - the collision response that
+// follows decides where the sphere goes next.  Other actors are taken where
+// they are at the end of the step.
+
+// fraction of its radius a sphere has to be expected to move before it's swept
+static const float SWEEP_THRESHOLD = 0.5f;
+// fraction of its radius a sphere is moved past its first impact, so that
+// it's touching rather than just short of it
+static const float SWEEP_SKIN = 0.01f;
+
+void Scene::FindSweeps()
+{
+	m_sweeps.clear();
+	if (!m_continuous)
+		return;
+	float timeStep = (float)m_timeStep;
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
+	{
+		Actor* actor = m_actors[i];
+		const Geometry& geometry = actor->GetGeometry();
+		if (!actor->IsDynamic() || !actor->IsAwake() || IsDisc(i) ||
+			Geometry::SPHERE != geometry.GetShape())
+			continue;
+		float radius = static_cast<const Geometry::Sphere&>(geometry).radius;
+		float distance = radius * SWEEP_THRESHOLD;
+		if (glm::length2(actor->GetVelocity()) * timeStep * timeStep > distance * distance)
+		{
+			Sweep sweep = { actor, actor->GetPosition() };
+			m_sweeps.push_back(sweep);
+		}
+	}
+}
+
+void Scene::SweepActors()
+{
+	for (auto& sweep : m_sweeps)
+	{
+		Actor* actor = sweep.actor;
+		glm::vec3 displacement = actor->GetPosition() - sweep.start;
+		float length = glm::length(displacement);
+		if (0 == length)
+			continue;
+		glm::vec3 direction = displacement / length;
+		Geometry::Sphere sphere(static_cast<const Geometry::Sphere&>(actor->GetGeometry()).radius,
+								sweep.start);
+
+		// actors already touching at the start are left to the narrowphase, so
+		// a ball rolling along the bed isn't stopped by it
+		float impact = length;
+		m_tree.Raycast(sweep.start, direction, length, sphere.radius,
+					   [&](int a_proxy, float a_maxDistance)
+		{
+			Actor* other = m_tree.GetActor(a_proxy);
+			float time;
+			if (other == actor ||
+				!sphere.TimeOfImpact(displacement, other->GetGeometry(), glm::vec3(0), &time) ||
+				0 >= time || time * length >= a_maxDistance)
+				return a_maxDistance;
+			impact = time * length;
+			return impact;
+		});
+		if (impact < length)
+			actor->Move(sweep.start + direction * fmin(length, impact + sphere.radius * SWEEP_SKIN) -
+						actor->GetPosition());
+	}
+}
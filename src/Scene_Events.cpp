@@ -0,0 +1,285 @@
+#include "Scene.h"
+
+// Between events a ball rolling on the bed is only slowed by linear drag,
+// so its velocity decays exponentially and its position follows
+//     p(t) = p0 + v0 * (1 - e^(-kt)) / k
+// where k is the drag over the ball's mass.  That makes its path a straight
+// line in the travel (1 - e^(-kt)) / k, and two balls with the same k move
+// along straight lines relative to each other in it too - so impact times
+// come exactly from the same sphere casts the queries use, and only need
+// converting from travel back to time.
+//
+// Every prediction goes into one queue, ordered by time.  Each ball counts
+// its events, and an event predicted before either of its balls had another
+// one is stale and skipped - the balls' new predictions replace it.
+
+// approaching slower than this, a ball already touching something is
+// treated as moving along its surface rather than into it
+static const float EVENT_APPROACH = 0.001f;
+// two balls at least this close count as touching when their drag differs
+static const float EVENT_TOLERANCE = 0.0001f;
+// iterations of conservative advancement between balls whose drag differs
+static const unsigned int EVENT_ITERATIONS = 64;
+// guards against balls squeezed together bouncing forever without time passing
+static const unsigned int MAX_EVENTS = 100000;
+
+//
+// EventBall
+//
+
+float Scene::EventBall::Travel(double a_time) const
+{
+	double elapsed = a_time - time;
+	return (float)(0 < dragRate ? (1 - exp(-dragRate * elapsed)) / dragRate : elapsed);
+}
+double Scene::EventBall::TimeAt(float a_travel) const
+{
+	if (0 >= dragRate)
+		return time + a_travel;
+	return (1 <= dragRate * a_travel ? DBL_MAX : time - log(1 - dragRate * a_travel) / dragRate);
+}
+double Scene::EventBall::StopTime() const
+{
+	float speed = glm::length(velocity);
+	if (0 == speed)
+		return DBL_MAX;
+	if (speed <= minSpeed)
+		return time;
+	return (0 < dragRate && 0 < minSpeed ? time + log(speed / minSpeed) / dragRate : DBL_MAX);
+}
+
+//
+// Scene
+//
+
+unsigned int Scene::AdvanceEvents(double a_seconds)
+{
+	// gather the balls, each starting from its current motion along the bed
+	m_up = (glm::vec3(0) != m_gravity ? -glm::normalize(m_gravity) : glm::vec3(0));
+	m_eventBalls.clear();
+	for (auto actor : m_actors)
+	{
+		const Geometry& geometry = actor->GetGeometry();
+		if (!actor->IsDynamic() || Geometry::SPHERE != geometry.GetShape())
+			continue;
+		EventBall ball;
+		ball.actor = actor;
+		ball.radius = static_cast<const Geometry::Sphere&>(geometry).radius;
+		ball.mass = actor->GetMass();
+		ball.dragRate = (0 < ball.mass ? actor->GetMaterial().linearDrag / ball.mass : 0);
+		ball.minSpeed = actor->GetMinSpeed();
+		ball.time = 0;
+		ball.position = actor->GetPosition();
+		ball.velocity = actor->GetVelocity() - m_up * glm::dot(actor->GetVelocity(), m_up);
+		ball.rotation = glm::quat();
+		ball.count = 0;
+		m_eventBalls.push_back(ball);
+	}
+	for (unsigned int i = 0; i < m_eventBalls.size(); ++i)
+		PredictEvents(i, 0, a_seconds, false);
+
+	unsigned int handled = 0;
+	while (!m_events.empty() && m_events.top().time <= a_seconds && MAX_EVENTS > handled)
+	{
+		Event event = m_events.top();
+		m_events.pop();
+		const EventBall& ball1 = m_eventBalls[event.ball1];
+		if (ball1.count != event.count1 ||
+			(0 <= event.ball2 && m_eventBalls[event.ball2].count != event.count2))
+			continue;
+		HandleEvent(event, a_seconds);
+		++handled;
+	}
+	// popping rather than replacing the queue keeps its storage for next time
+	while (!m_events.empty())
+		m_events.pop();
+
+	// hand the balls' motion back to their actors, rolling without slipping,
+	// and put the ones that have stopped to sleep
+	for (auto& ball : m_eventBalls)
+	{
+		MoveEventBall(ball, a_seconds);
+		Actor* actor = ball.actor;
+		actor->Move(ball.position - actor->GetPosition());
+		actor->Spin(ball.rotation);
+		actor->Accelerate(ball.velocity - actor->GetVelocity());
+		actor->AccelerateRotation(glm::cross(m_up, ball.velocity) / ball.radius -
+								  actor->GetAngularVelocity());
+		if (glm::vec3(0) != ball.velocity)
+			actor->Wake();
+		else if (actor->IsAwake())
+			actor->Sleep();
+	}
+	UpdateTree();
+	return handled;
+}
+
+// predicts when a ball stops and what it hits first, at a time when the
+// ball's motion starts afresh - only pairs with later balls are predicted
+// unless a_allPairs is set, so that each pair is only predicted once at the
+// start of an advance
+void Scene::PredictEvents(unsigned int a_ball, double a_time, double a_endTime, bool a_allPairs)
+{
+	const EventBall& ball = m_eventBalls[a_ball];
+	if (glm::vec3(0) != ball.velocity)
+	{
+		double stopTime = ball.StopTime();
+		if (stopTime <= a_endTime)
+		{
+			Event event = { stopTime, a_ball, -1, ball.count, 0, nullptr, glm::vec3(0) };
+			m_events.push(event);
+		}
+		PredictStaticEvent(a_ball, a_time, a_endTime);
+	}
+	for (unsigned int i = (a_allPairs ? 0 : a_ball + 1); i < m_eventBalls.size(); ++i)
+	{
+		if (i != a_ball)
+			PredictPairEvent(a_ball, i, a_time, a_endTime);
+	}
+}
+
+// anything that isn't a ball is treated as static, and a ball's path to it
+// is a sphere cast through the bounding volume tree
+void Scene::PredictStaticEvent(unsigned int a_ball, double a_time, double a_endTime)
+{
+	const EventBall& ball = m_eventBalls[a_ball];
+	float speed = glm::length(ball.velocity);
+	float maxDistance = speed * ball.Travel(fmin(a_endTime, ball.StopTime()));
+	if (0 == speed || 0 >= maxDistance)
+		return;
+	glm::vec3 direction = ball.velocity / speed;
+	Event event = { DBL_MAX, a_ball, -1, ball.count, 0, nullptr, glm::vec3(0) };
+	float impact = maxDistance;
+	m_tree.Raycast(ball.position, direction, maxDistance, ball.radius,
+				   [&](int a_proxy, float a_maxDistance)
+	{
+		Actor* actor = m_tree.GetActor(a_proxy);
+		if (actor->IsDynamic() && Geometry::SPHERE == actor->GetGeometry().GetShape())
+			return a_maxDistance;
+		float distance;
+		glm::vec3 normal;
+		if (!actor->GetGeometry().SphereCast(ball.position, direction, ball.radius, a_maxDistance,
+											 &distance, &normal) ||
+			(0 == distance && -EVENT_APPROACH <= glm::dot(direction, normal)))
+			return a_maxDistance;
+		event.actor = actor;
+		event.normal = normal;
+		impact = distance;
+		return distance;
+	});
+	if (nullptr == event.actor)
+		return;
+	event.time = ball.TimeAt(impact / speed);
+	if (event.time <= a_endTime)
+		m_events.push(event);
+}
+
+void Scene::PredictPairEvent(unsigned int a_ball1, unsigned int a_ball2, double a_time, double a_endTime)
+{
+	const EventBall& ball1 = m_eventBalls[a_ball1];
+	const EventBall& ball2 = m_eventBalls[a_ball2];
+	if (glm::vec3(0) == ball1.velocity && glm::vec3(0) == ball2.velocity)
+		return;
+	double endTime = fmin(a_endTime, fmin(ball1.StopTime(), ball2.StopTime()));
+	if (endTime < a_time)
+		return;
+	glm::vec3 position1 = ball1.PositionAt(a_time), position2 = ball2.PositionAt(a_time);
+	glm::vec3 velocity1 = ball1.VelocityAt(a_time), velocity2 = ball2.VelocityAt(a_time);
+	Event event = { DBL_MAX, a_ball1, (int)a_ball2, ball1.count, ball2.count, nullptr, glm::vec3(0) };
+
+	if (ball1.dragRate == ball2.dragRate)
+	{
+		// both move in straight lines in the same travel, so it's one sphere cast
+		EventBall from = ball1;
+		from.time = a_time;
+		float travel = from.Travel(endTime);
+		float time;
+		glm::vec3 normal;
+		if (!Geometry::Sphere(ball1.radius, position1).TimeOfImpact(
+				velocity1 * travel, Geometry::Sphere(ball2.radius, position2), velocity2 * travel,
+				&time, &normal) ||
+			(0 == time && -EVENT_APPROACH * glm::length(velocity1 - velocity2) <=
+						   glm::dot(velocity1 - velocity2, normal)))
+			return;
+		event.time = from.TimeAt(time * travel);
+	}
+	else
+	{
+		// otherwise advance by the time the gap could close in at the speeds
+		// the balls have now, which are the fastest they'll move from here on
+		double time = a_time;
+		for (unsigned int i = 0; i < EVENT_ITERATIONS && time <= endTime; ++i)
+		{
+			glm::vec3 offset = ball2.PositionAt(time) - ball1.PositionAt(time);
+			glm::vec3 velocity = ball2.VelocityAt(time) - ball1.VelocityAt(time);
+			float gap = glm::length(offset) - ball1.radius - ball2.radius;
+			if (EVENT_TOLERANCE >= gap)
+			{
+				if (0 <= glm::dot(velocity, offset))
+					return;
+				event.time = time;
+				break;
+			}
+			float speed = glm::length(ball1.VelocityAt(time)) + glm::length(ball2.VelocityAt(time));
+			if (0 == speed)
+				return;
+			time += gap / speed;
+		}
+	}
+	if (event.time <= endTime)
+		m_events.push(event);
+}
+
+void Scene::MoveEventBall(EventBall& a_ball, double a_time)
+{
+	glm::vec3 position = a_ball.PositionAt(a_time);
+	glm::vec3 turn = glm::cross(m_up, position - a_ball.position) / a_ball.radius;
+	a_ball.rotation = glm::normalize(Geometry::Rotation(turn) * a_ball.rotation);
+	a_ball.velocity = a_ball.VelocityAt(a_time);
+	a_ball.position = position;
+	a_ball.time = a_time;
+}
+
+void Scene::HandleEvent(const Event& a_event, double a_endTime)
+{
+	EventBall& ball1 = m_eventBalls[a_event.ball1];
+	MoveEventBall(ball1, a_event.time);
+	++ball1.count;
+	if (0 <= a_event.ball2)
+	{
+		// balls bounce off each other along the line between their centers
+		EventBall& ball2 = m_eventBalls[a_event.ball2];
+		MoveEventBall(ball2, a_event.time);
+		++ball2.count;
+		glm::vec3 normal = glm::normalize(ball2.position - ball1.position);
+		float speed = glm::dot(ball2.velocity - ball1.velocity, normal);
+		if (0 > speed)
+		{
+			float e = fmin(ball1.actor->GetMaterial().elasticity, ball2.actor->GetMaterial().elasticity);
+			float impulse = -(1 + e) * speed / (1 / ball1.mass + 1 / ball2.mass);
+			ball1.velocity -= normal * impulse / ball1.mass;
+			ball2.velocity += normal * impulse / ball2.mass;
+			ball1.velocity -= m_up * glm::dot(ball1.velocity, m_up);
+			ball2.velocity -= m_up * glm::dot(ball2.velocity, m_up);
+		}
+		PredictEvents(a_event.ball1, a_event.time, a_endTime, true);
+		PredictEvents(a_event.ball2, a_event.time, a_endTime, true);
+		return;
+	}
+	if (nullptr != a_event.actor)
+	{
+		// and off anything else they hit
+		float speed = glm::dot(ball1.velocity, a_event.normal);
+		if (0 > speed)
+		{
+			float e = fmin(ball1.actor->GetMaterial().elasticity, a_event.actor->GetMaterial().elasticity);
+			ball1.velocity -= a_event.normal * speed * (1 + e);
+			ball1.velocity -= m_up * glm::dot(ball1.velocity, m_up);
+		}
+	}
+	else
+	{
+		ball1.velocity = glm::vec3(0);
+	}
+	PredictEvents(a_event.ball1, a_event.time, a_endTime, true);
+}
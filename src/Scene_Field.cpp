@@ -0,0 +1,495 @@
+#include "Scene.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+// The bed and cushions of a table never move, yet every ball is tested
+// against each of them every step.  Baking them into one signed distance
+// field turns that into a single trilinear lookup per ball, however many
+// pieces the table is made of.  Away from edges the nearest surface of a
+// box or hull is flat, so the field is exact there up to rounding; a cell
+// whose corners disagree on which actor is nearest or which way is out is
+// near an edge, a corner or a seam between actors, and a ball in one is
+// detected exactly against each actor as before.  So is a ball that could
+// reach a second actor besides the nearest, like one on the bed against a
+// cushion, which is why each sample also keeps its distance to the second
+// nearest actor.
+
+// cosine of the widest angle between the gradients at a cell's corners for
+// the cell to be trusted
+static const float FIELD_SMOOTH = 0.999f;
+// most samples a field can have - a smaller cell size is refused
+static const unsigned int MAX_FIELD_SAMPLES = 1 << 24;
+// how far a static actor can be from where it was baked, as a share of the
+// cell size, for a saved field to still be loaded for it
+static const float FIELD_TOLERANCE = 0.001f;
+static const char FIELD_MAGIC[4] = { 'S', 'D', 'F', '3' };
+
+// what DropFieldPairs found for each sphere - otherwise it's the index of the
+// baked actor the sphere touches
+static const int FIELD_UNSAMPLED = -3;
+static const int FIELD_EXACT = -2;
+static const int FIELD_CLEAR = -1;
+
+//
+// StaticField
+//
+
+void Scene::StaticField::Clear()
+{
+	origin = glm::vec3(0);
+	cellSize = 0;
+	counts[0] = counts[1] = counts[2] = 0;
+	distances.clear();
+	gradients.clear();
+	nearest.clear();
+	seconds.clear();
+	coarse.clear();
+	clearances.clear();
+	actors.clear();
+	sorted.clear();
+	positions.clear();
+	orientations.clear();
+	scales.clear();
+}
+
+void Scene::StaticField::MarkCoarseCells()
+{
+	sorted.assign(actors.begin(), actors.end());
+	std::sort(sorted.begin(), sorted.end());
+	unsigned int cells = (counts[0] - 1) * (counts[1] - 1) * (counts[2] - 1);
+	coarse.assign(cells, 0);
+	clearances.assign(cells, FLT_MAX);
+
+	// distances change no faster than the point moves, so nowhere in a cell
+	// is closer to the other actors than its corners less half its diagonal
+	float halfDiagonal = cellSize * sqrt(3.0f) / 2;
+	unsigned int cell = 0;
+	for (unsigned int z = 0; z + 1 < counts[2]; ++z)
+	{
+		for (unsigned int y = 0; y + 1 < counts[1]; ++y)
+		{
+			for (unsigned int x = 0; x + 1 < counts[0]; ++x, ++cell)
+			{
+				unsigned int first = IndexOf(x, y, z);
+				for (unsigned int i = 0; i < 8 && !coarse[cell]; ++i)
+				{
+					unsigned int corner = IndexOf(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2));
+					coarse[cell] = (nearest[corner] != nearest[first] ||
+									glm::vec3(0) == gradients[corner] ||
+									FIELD_SMOOTH > glm::dot(gradients[corner], gradients[first]));
+					clearances[cell] = fmin(clearances[cell], seconds[corner] - halfDiagonal);
+				}
+			}
+		}
+	}
+}
+
+bool Scene::StaticField::Sample(const glm::vec3& a_point, float& a_distance, glm::vec3& a_gradient,
+								unsigned int& a_actor, float& a_clearance) const
+{
+	if (distances.empty())
+		return false;
+	glm::vec3 grid = (a_point - origin) / cellSize;
+	unsigned int corner[3];
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		if (0 > grid[i] || counts[i] - 1 < grid[i])
+			return false;
+		corner[i] = std::min((unsigned int)grid[i], counts[i] - 2);
+	}
+	unsigned int cell = (corner[2] * (counts[1] - 1) + corner[1]) * (counts[0] - 1) + corner[0];
+	if (coarse[cell])
+		return false;
+
+	// every corner has the same nearest actor, or the cell would be coarse
+	glm::vec3 t = grid - glm::vec3(corner[0], corner[1], corner[2]);
+	float distance = 0;
+	glm::vec3 gradient(0);
+	for (unsigned int i = 0; i < 8; ++i)
+	{
+		unsigned int x = (i & 1), y = ((i >> 1) & 1), z = (i >> 2);
+		float weight = (x ? t.x : 1 - t.x) * (y ? t.y : 1 - t.y) * (z ? t.z : 1 - t.z);
+		unsigned int sample = IndexOf(corner[0] + x, corner[1] + y, corner[2] + z);
+		distance += distances[sample] * weight;
+		gradient += gradients[sample] * weight;
+	}
+	a_distance = distance;
+	a_gradient = Geometry::Normalize(gradient);
+	a_actor = nearest[IndexOf(corner[0], corner[1], corner[2])];
+	a_clearance = clearances[cell];
+	return true;
+}
+
+bool Scene::StaticField::Contains(const Actor* a_actor) const
+{
+	return std::binary_search(sorted.begin(), sorted.end(), a_actor);
+}
+
+void Scene::StaticField::StorePoses()
+{
+	positions.resize(actors.size());
+	orientations.resize(actors.size());
+	scales.resize(actors.size());
+	for (unsigned int i = 0; i < actors.size(); ++i)
+	{
+		positions[i] = actors[i]->GetGeometry().position;
+		orientations[i] = actors[i]->GetGeometry().orientation();
+		scales[i] = actors[i]->GetGeometry().scale();
+	}
+}
+
+bool Scene::StaticField::HasMoved() const
+{
+	for (unsigned int i = 0; i < actors.size(); ++i)
+	{
+		const Geometry& geometry = actors[i]->GetGeometry();
+		if (geometry.position != positions[i] || geometry.orientation() != orientations[i] ||
+			geometry.scale() != scales[i])
+			return true;
+	}
+	return false;
+}
+
+//
+// Baking, saving and loading
+//
+
+// What a saved field records of each baked actor - its pose, its shape, and
+// its size: a box's extents, a sphere's radius, or a hash of a hull's points
+struct FieldActor
+{
+	glm::vec3 position;
+	glm::quat orientation;
+	unsigned int shape;
+	glm::vec3 size;
+	unsigned int pointHash;
+};
+
+static FieldActor DescribeActor(const Geometry& a_geometry)
+{
+	FieldActor actor;
+	actor.position = a_geometry.position;
+	actor.orientation = a_geometry.orientation();
+	actor.shape = a_geometry.GetShape();
+	actor.size = a_geometry.scale();
+	actor.pointHash = 2166136261u;
+	if (Geometry::HULL == a_geometry.GetShape())
+	{
+		// FNV-1a over the points as they're stored
+		const std::vector<glm::vec3>& points = static_cast<const Geometry::ConvexHull&>(a_geometry).localPoints();
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points.data());
+		for (unsigned int i = 0; i < points.size() * sizeof(glm::vec3); ++i)
+			actor.pointHash = (actor.pointHash ^ bytes[i]) * 16777619u;
+	}
+	return actor;
+}
+
+// true if the actor is where, and as it was, when the field was saved - a
+// turn counts by how far it moves the actor's furthest point, and a plane's
+// furthest point is as far away as the grid reaches
+static bool Matches(const Geometry& a_geometry, const FieldActor& a_saved, float a_tolerance, float a_gridReach)
+{
+	FieldActor actor = DescribeActor(a_geometry);
+	glm::quat turn = glm::inverse(a_saved.orientation) * actor.orientation;
+	float angle = 2 * glm::length(glm::vec3(turn.x, turn.y, turn.z));
+	float reach = (Geometry::PLANE == actor.shape ? a_gridReach :
+				   glm::length(a_geometry.AxisAlignedExtents()));
+	return (actor.shape == a_saved.shape && actor.pointHash == a_saved.pointHash &&
+			glm::length(actor.position - a_saved.position) <= a_tolerance &&
+			glm::length(actor.size - a_saved.size) <= a_tolerance &&
+			angle * reach <= a_tolerance);
+}
+
+// planes divide space in two, so their inside is everything behind them
+static float SignedDistance(const Geometry& a_geometry, const glm::vec3& a_point, glm::vec3& a_gradient)
+{
+	if (Geometry::PLANE == a_geometry.GetShape())
+	{
+		a_gradient = static_cast<const Geometry::Plane&>(a_geometry).normal();
+		return glm::dot(a_gradient, a_point - a_geometry.position);
+	}
+	glm::vec3 normal;
+	glm::vec3 offset = a_point - a_geometry.ClosestSurfacePointTo(a_point, &normal);
+	float distance = glm::length(offset);
+	bool inside = a_geometry.Contains(a_point);
+	a_gradient = (0 < distance ? offset * ((inside ? -1.0f : 1.0f) / distance) : normal);
+	return (inside ? -distance : distance);
+}
+
+void Scene::GatherStaticActors(std::vector<Actor*>& a_actors) const
+{
+	a_actors.clear();
+	for (auto actor : m_actors)
+	{
+		if (!actor->IsDynamic())
+			a_actors.push_back(actor);
+	}
+}
+
+bool Scene::BakeStaticField(float a_cellSize, float a_margin)
+{
+	// planes are infinite, so the grid only covers the other actors
+	StaticField& field = m_staticField;
+	field.Clear();
+	GatherStaticActors(field.actors);
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	for (auto actor : field.actors)
+	{
+		Proxy proxy(actor);
+		if (!proxy.IsBounded())
+			continue;
+		min = glm::min(min, proxy.min - a_margin);
+		max = glm::max(max, proxy.max + a_margin);
+	}
+	if (0 >= a_cellSize || min.x > max.x)
+	{
+		field.Clear();
+		return false;
+	}
+	double samples = 1;
+	for (unsigned int i = 0; i < 3; ++i)
+	{
+		field.counts[i] = (unsigned int)ceil((max[i] - min[i]) / a_cellSize) + 2;
+		samples *= field.counts[i];
+	}
+	if (MAX_FIELD_SAMPLES < samples)
+	{
+		field.Clear();
+		return false;
+	}
+	field.origin = min;
+	field.cellSize = a_cellSize;
+	field.distances.resize((unsigned int)samples);
+	field.gradients.resize((unsigned int)samples);
+	field.nearest.resize((unsigned int)samples);
+	field.seconds.resize((unsigned int)samples);
+
+	// each sample only writes itself, so they can be split between threads
+	m_workers.ParallelFor((unsigned int)samples, 256, [&field](unsigned int a_begin, unsigned int a_end)
+	{
+		for (unsigned int i = a_begin; i < a_end; ++i)
+		{
+			unsigned int x = i % field.counts[0];
+			unsigned int y = (i / field.counts[0]) % field.counts[1];
+			unsigned int z = i / (field.counts[0] * field.counts[1]);
+			glm::vec3 point = field.origin + glm::vec3(x, y, z) * field.cellSize;
+			field.distances[i] = field.seconds[i] = FLT_MAX;
+			for (unsigned int j = 0; j < field.actors.size(); ++j)
+			{
+				glm::vec3 gradient;
+				float distance = SignedDistance(field.actors[j]->GetGeometry(), point, gradient);
+				if (distance < field.distances[i])
+				{
+					field.seconds[i] = field.distances[i];
+					field.distances[i] = distance;
+					field.gradients[i] = gradient;
+					field.nearest[i] = j;
+				}
+				else if (distance < field.seconds[i])
+					field.seconds[i] = distance;
+			}
+		}
+	});
+	field.MarkCoarseCells();
+	field.StorePoses();
+	return true;
+}
+
+// The file holds the grid, then the pose, shape and size of each baked actor,
+// so a field isn't loaded for a different table, then the samples.  The
+// coarse cells are worked out again on loading.
+bool Scene::SaveStaticField(const char* a_filename) const
+{
+	const StaticField& field = m_staticField;
+	if (field.IsEmpty())
+		return false;
+	FILE* pFile;
+	fopen_s(&pFile, a_filename, "wb");
+	if (pFile == nullptr)
+		return false;
+	unsigned int actorCount = field.actors.size();
+	bool written = (1 == fwrite(FIELD_MAGIC, sizeof(FIELD_MAGIC), 1, pFile) &&
+					1 == fwrite(field.counts, sizeof(field.counts), 1, pFile) &&
+					1 == fwrite(&field.origin, sizeof(field.origin), 1, pFile) &&
+					1 == fwrite(&field.cellSize, sizeof(field.cellSize), 1, pFile) &&
+					1 == fwrite(&actorCount, sizeof(actorCount), 1, pFile));
+	for (unsigned int i = 0; written && i < actorCount; ++i)
+	{
+		FieldActor actor = DescribeActor(field.actors[i]->GetGeometry());
+		written = (1 == fwrite(&actor, sizeof(actor), 1, pFile));
+	}
+	unsigned int samples = field.distances.size();
+	written = (written &&
+			   samples == fwrite(&field.distances[0], sizeof(float), samples, pFile) &&
+			   samples == fwrite(&field.gradients[0], sizeof(glm::vec3), samples, pFile) &&
+			   samples == fwrite(&field.nearest[0], sizeof(unsigned int), samples, pFile) &&
+			   samples == fwrite(&field.seconds[0], sizeof(float), samples, pFile));
+	fclose(pFile);
+	return written;
+}
+
+bool Scene::LoadStaticField(const char* a_filename)
+{
+	StaticField& field = m_staticField;
+	field.Clear();
+	FILE* pFile;
+	fopen_s(&pFile, a_filename, "rb");
+	if (pFile == nullptr)
+		return false;
+
+	// the header, checked against the scene's static actors
+	char magic[sizeof(FIELD_MAGIC)];
+	unsigned int actorCount = 0;
+	GatherStaticActors(field.actors);
+	bool read = (1 == fread(magic, sizeof(magic), 1, pFile) &&
+				 0 == memcmp(magic, FIELD_MAGIC, sizeof(magic)) &&
+				 1 == fread(field.counts, sizeof(field.counts), 1, pFile) &&
+				 1 == fread(&field.origin, sizeof(field.origin), 1, pFile) &&
+				 1 == fread(&field.cellSize, sizeof(field.cellSize), 1, pFile) &&
+				 1 == fread(&actorCount, sizeof(actorCount), 1, pFile) &&
+				 field.actors.size() == actorCount && 0 < field.cellSize);
+	float gridReach = field.cellSize * glm::length(glm::vec3(field.counts[0], field.counts[1], field.counts[2]));
+	for (unsigned int i = 0; read && i < actorCount; ++i)
+	{
+		FieldActor actor;
+		read = (1 == fread(&actor, sizeof(actor), 1, pFile) &&
+				Matches(field.actors[i]->GetGeometry(), actor, field.cellSize * FIELD_TOLERANCE, gridReach));
+	}
+	double samples = (double)field.counts[0] * field.counts[1] * field.counts[2];
+	read = (read && 2 <= field.counts[0] && 2 <= field.counts[1] && 2 <= field.counts[2] &&
+			MAX_FIELD_SAMPLES >= samples);
+
+	// and the samples
+	if (read)
+	{
+		unsigned int count = (unsigned int)samples;
+		field.distances.resize(count);
+		field.gradients.resize(count);
+		field.nearest.resize(count);
+		field.seconds.resize(count);
+		read = (count == fread(&field.distances[0], sizeof(float), count, pFile) &&
+				count == fread(&field.gradients[0], sizeof(glm::vec3), count, pFile) &&
+				count == fread(&field.nearest[0], sizeof(unsigned int), count, pFile) &&
+				count == fread(&field.seconds[0], sizeof(float), count, pFile));
+		for (unsigned int i = 0; read && i < count; ++i)
+			read = (field.nearest[i] < actorCount);
+	}
+	fclose(pFile);
+	if (!read)
+	{
+		field.Clear();
+		return false;
+	}
+	field.MarkCoarseCells();
+	field.StorePoses();
+	return true;
+}
+
+//
+// Detection
+//
+
+// Pairs between an awake sphere and baked actors come from the broadphase as
+// usual, then give way to one lookup for the sphere: no pair at all if it's
+// clear of everything baked, or one pair with the nearest baked actor if it
+// touches it.  Where the lookup can't be trusted - off the grid, in a coarse
+// cell, or near enough to a second baked actor that the sphere could touch
+// both - the sphere keeps its pairs and they're detected exactly.
+//
+// Static actors can still be moved by hand, or by their own velocity, and a
+// field baked around where they were would then be wrong.  It's cleared as
+// soon as any of them has moved, leaving it to the game to bake another.
+void Scene::DropFieldPairs()
+{
+	if (m_staticField.IsEmpty())
+		return;
+	if (m_staticField.HasMoved())
+	{
+		m_staticField.Clear();
+		return;
+	}
+	m_fieldResults.assign(m_spheres.size(), FIELD_UNSAMPLED);
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		Pair pair = m_pairs[i];
+		if (0 <= pair.sphere2 && pair.actor2->IsDynamic() && m_staticField.Contains(pair.actor1))
+		{
+			std::swap(pair.actor1, pair.actor2);
+			std::swap(pair.sphere1, pair.sphere2);
+		}
+		if (0 > pair.sphere1 || !pair.actor1->IsDynamic() || !m_staticField.Contains(pair.actor2))
+		{
+			m_pairs[kept++] = m_pairs[i];
+			continue;
+		}
+
+		// sample once per sphere, the first time one of its pairs comes up
+		int& result = m_fieldResults[pair.sphere1];
+		if (FIELD_UNSAMPLED == result)
+		{
+			const Geometry::Sphere& sphere =
+				static_cast<const Geometry::Sphere&>(pair.actor1->GetGeometry());
+			float distance;
+			glm::vec3 gradient;
+			unsigned int nearest;
+			float clearance;
+			if (!m_staticField.Sample(sphere.position, distance, gradient, nearest, clearance) ||
+				sphere.radius >= clearance)
+				result = FIELD_EXACT;
+			else if (sphere.radius < distance ||
+					 pair.actor1->GetSupport() == m_staticField.actors[nearest])
+				result = FIELD_CLEAR;
+			else
+				result = nearest;
+		}
+		if (FIELD_EXACT == result)
+		{
+			m_pairs[kept++] = m_pairs[i];
+		}
+		else if (FIELD_CLEAR != result)
+		{
+			// in place of the first of the sphere's pairs, with the sphere first
+			Pair fieldPair(pair.actor1, m_staticField.actors[result]);
+			fieldPair.field = true;
+			m_pairs[kept++] = fieldPair;
+			result = FIELD_CLEAR;
+		}
+	}
+	m_pairs.resize(kept);
+}
+
+bool Scene::DetectPair(const Pair& a_pair, Geometry::Collision* a_collision) const
+{
+	// a sphere that has since been pushed somewhere the field can't be trusted,
+	// or nearer another baked actor, is detected exactly against the actor it
+	// was paired with
+	const Geometry& geometry1 = a_pair.actor1->GetGeometry();
+	const Geometry& geometry2 = a_pair.actor2->GetGeometry();
+	float distance;
+	glm::vec3 gradient;
+	unsigned int nearest;
+	float clearance;
+	if (!a_pair.field)
+		return Geometry::DetectCollision(geometry1, geometry2, a_collision);
+	const Geometry::Sphere& sphere = static_cast<const Geometry::Sphere&>(geometry1);
+	if (!m_staticField.Sample(geometry1.position, distance, gradient, nearest, clearance) ||
+		sphere.radius >= clearance || m_staticField.actors[nearest] != a_pair.actor2)
+		return Geometry::DetectCollision(geometry1, geometry2, a_collision);
+	if (sphere.radius < distance)
+		return false;
+	if (nullptr != a_collision)
+	{
+		a_collision->shape1 = &geometry1;
+		a_collision->shape2 = &geometry2;
+		a_collision->normal = -gradient;
+		a_collision->interpenetration = sphere.radius - distance;
+		float d = sphere.radius - a_collision->interpenetration / 2;
+		a_collision->point = sphere.position + a_collision->normal * d;
+		a_collision->points[0] = a_collision->point;
+		a_collision->depths[0] = a_collision->interpenetration;
+		a_collision->pointCount = 1;
+	}
+	return true;
+}
@@ -0,0 +1,281 @@
+#include "Scene.h"
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCENE_SSE
+#endif
+
+// Most actors in a step are free - dynamic, awake and not rolling on a
+// support - and for those Actor::Update does nothing but integrate them.  So
+// rather than updating them one at a time, their state is copied into the
+// scene's body arrays, integrated several at a time, and copied back.  The
+// step is the same as Update's - each body moves on at its velocity plus half
+// the change in it, which is from gravity and the other forces less drag - and
+// velocities under the actor's minimum speed are zeroed the same way.  The
+// orientation is the one difference: rather than being spun about each axis
+// and angle in turn, it gets a single first order update from the angular
+// velocity over the step and is renormalised, and its rotation matrix is only
+// rebuilt once, when it changes.  The scalar and SIMD paths do the same float
+// operations in the same order, so a body ends up in the same place whichever
+// one it goes through.  Batches kept in double, as a reference for the float
+// ones, only go through the scalar path.
+
+// bodies gathered, integrated and scattered at a time - a multiple of four
+static const unsigned int INTEGRATION_BLOCK = 64;
+
+template<typename Real>
+void Scene::BasicBodies<Real>::resize(unsigned int a_size)
+{
+	std::vector<Real>* arrays[] =
+	{
+		&x, &y, &z, &vx, &vy, &vz, &wx, &wy, &wz, &qx, &qy, &qz, &qw,
+		&fx, &fy, &fz, &mass, &linearDrag, &tx, &ty, &tz, &rotationalInertia,
+		&minSpeed2, &minAngularSpeed2
+	};
+	for (auto array : arrays)
+		array->resize(a_size);
+}
+template<typename Real>
+void Scene::BasicBodies<Real>::Gather(unsigned int a_body, const Actor& a_actor, const glm::vec3& a_gravity)
+{
+	const glm::vec3& position = a_actor.GetPosition();
+	const glm::vec3& velocity = a_actor.GetVelocity();
+	const glm::vec3& angularVelocity = a_actor.GetAngularVelocity();
+	const glm::quat& orientation = a_actor.GetOrientation();
+	Actor::Motion motion = a_actor.GetMotion(a_gravity);
+	x[a_body] = position.x;
+	y[a_body] = position.y;
+	z[a_body] = position.z;
+	vx[a_body] = velocity.x;
+	vy[a_body] = velocity.y;
+	vz[a_body] = velocity.z;
+	wx[a_body] = angularVelocity.x;
+	wy[a_body] = angularVelocity.y;
+	wz[a_body] = angularVelocity.z;
+	qx[a_body] = orientation.x;
+	qy[a_body] = orientation.y;
+	qz[a_body] = orientation.z;
+	qw[a_body] = orientation.w;
+	fx[a_body] = motion.force.x;
+	fy[a_body] = motion.force.y;
+	fz[a_body] = motion.force.z;
+	mass[a_body] = motion.mass;
+	linearDrag[a_body] = motion.linearDrag;
+	tx[a_body] = motion.torque.x;
+	ty[a_body] = motion.torque.y;
+	tz[a_body] = motion.torque.z;
+	rotationalInertia[a_body] = motion.rotationalInertia;
+	minSpeed2[a_body] = a_actor.GetMinSpeed2();
+	minAngularSpeed2[a_body] = a_actor.GetMinAngularSpeed2();
+}
+template<typename Real>
+void Scene::BasicBodies<Real>::Scatter(unsigned int a_body, Actor& a_actor) const
+{
+	a_actor.SetMotion(glm::vec3((float)x[a_body], (float)y[a_body], (float)z[a_body]),
+					  glm::quat((float)qw[a_body], (float)qx[a_body], (float)qy[a_body], (float)qz[a_body]),
+					  glm::vec3((float)vx[a_body], (float)vy[a_body], (float)vz[a_body]),
+					  glm::vec3((float)wx[a_body], (float)wy[a_body], (float)wz[a_body]));
+}
+template struct Scene::BasicBodies<float>;
+template struct Scene::BasicBodies<double>;
+
+template<typename Real>
+static void IntegrateBody(Scene::BasicBodies<Real>& a_bodies, unsigned int a_body, Real a_deltaTime)
+{
+	Scene::BasicBodies<Real>& b = a_bodies;
+	unsigned int i = a_body;
+	Real h = a_deltaTime;
+	Real half = (Real)0.5;
+
+	// linear
+	Real dvx = ((b.fx[i] - b.vx[i] * b.linearDrag[i]) / b.mass[i]) * h;
+	Real dvy = ((b.fy[i] - b.vy[i] * b.linearDrag[i]) / b.mass[i]) * h;
+	Real dvz = ((b.fz[i] - b.vz[i] * b.linearDrag[i]) / b.mass[i]) * h;
+	b.x[i] = (b.x[i] + b.vx[i] * h) + (half * dvx) * h;
+	b.y[i] = (b.y[i] + b.vy[i] * h) + (half * dvy) * h;
+	b.z[i] = (b.z[i] + b.vz[i] * h) + (half * dvz) * h;
+	Real vx = b.vx[i] + dvx;
+	Real vy = b.vy[i] + dvy;
+	Real vz = b.vz[i] + dvz;
+
+	// angular
+	Real dwx = (b.tx[i] * h) / b.rotationalInertia[i];
+	Real dwy = (b.ty[i] * h) / b.rotationalInertia[i];
+	Real dwz = (b.tz[i] * h) / b.rotationalInertia[i];
+	Real rx = b.wx[i] * h + (half * dwx) * h;
+	Real ry = b.wy[i] * h + (half * dwy) * h;
+	Real rz = b.wz[i] * h + (half * dwz) * h;
+	Real wx = b.wx[i] + dwx;
+	Real wy = b.wy[i] + dwy;
+	Real wz = b.wz[i] + dwz;
+
+	// orientation, from the rotation as a quaternion times the orientation
+	if (0 != rx || 0 != ry || 0 != rz)
+	{
+		Real qx = b.qx[i], qy = b.qy[i], qz = b.qz[i], qw = b.qw[i];
+		Real nx = qx + half * ((rx * qw + ry * qz) - rz * qy);
+		Real ny = qy + half * ((ry * qw + rz * qx) - rx * qz);
+		Real nz = qz + half * ((rz * qw + rx * qy) - ry * qx);
+		Real nw = qw - half * ((rx * qx + ry * qy) + rz * qz);
+		Real length = sqrt(((nx * nx + ny * ny) + nz * nz) + nw * nw);
+		b.qx[i] = nx / length;
+		b.qy[i] = ny / length;
+		b.qz[i] = nz / length;
+		b.qw[i] = nw / length;
+	}
+
+	// too slow counts as stopped
+	if ((vx * vx + vy * vy) + vz * vz < b.minSpeed2[i])
+		vx = vy = vz = 0;
+	if ((wx * wx + wy * wy) + wz * wz < b.minAngularSpeed2[i])
+		wx = wy = wz = 0;
+	b.vx[i] = vx;
+	b.vy[i] = vy;
+	b.vz[i] = vz;
+	b.wx[i] = wx;
+	b.wy[i] = wy;
+	b.wz[i] = wz;
+}
+
+#ifdef SCENE_SSE
+static __m128 Select4(__m128 a_mask, __m128 a_true, __m128 a_false)
+{
+	return _mm_or_ps(_mm_and_ps(a_mask, a_true), _mm_andnot_ps(a_mask, a_false));
+}
+static void IntegrateBodies4(Scene::Bodies& a_bodies, unsigned int a_body, float a_deltaTime)
+{
+	Scene::Bodies& b = a_bodies;
+	unsigned int i = a_body;
+	__m128 h = _mm_set1_ps(a_deltaTime);
+	__m128 half = _mm_set1_ps(0.5f);
+	__m128 zero = _mm_setzero_ps();
+
+	// linear
+	__m128 vx = _mm_loadu_ps(&b.vx[i]), vy = _mm_loadu_ps(&b.vy[i]), vz = _mm_loadu_ps(&b.vz[i]);
+	__m128 mass = _mm_loadu_ps(&b.mass[i]);
+	__m128 drag = _mm_loadu_ps(&b.linearDrag[i]);
+	__m128 dvx = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&b.fx[i]), _mm_mul_ps(vx, drag)), mass), h);
+	__m128 dvy = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&b.fy[i]), _mm_mul_ps(vy, drag)), mass), h);
+	__m128 dvz = _mm_mul_ps(_mm_div_ps(_mm_sub_ps(_mm_loadu_ps(&b.fz[i]), _mm_mul_ps(vz, drag)), mass), h);
+	_mm_storeu_ps(&b.x[i], _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&b.x[i]), _mm_mul_ps(vx, h)),
+									  _mm_mul_ps(_mm_mul_ps(half, dvx), h)));
+	_mm_storeu_ps(&b.y[i], _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&b.y[i]), _mm_mul_ps(vy, h)),
+									  _mm_mul_ps(_mm_mul_ps(half, dvy), h)));
+	_mm_storeu_ps(&b.z[i], _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&b.z[i]), _mm_mul_ps(vz, h)),
+									  _mm_mul_ps(_mm_mul_ps(half, dvz), h)));
+	vx = _mm_add_ps(vx, dvx);
+	vy = _mm_add_ps(vy, dvy);
+	vz = _mm_add_ps(vz, dvz);
+
+	// angular
+	__m128 wx = _mm_loadu_ps(&b.wx[i]), wy = _mm_loadu_ps(&b.wy[i]), wz = _mm_loadu_ps(&b.wz[i]);
+	__m128 inertia = _mm_loadu_ps(&b.rotationalInertia[i]);
+	__m128 dwx = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&b.tx[i]), h), inertia);
+	__m128 dwy = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&b.ty[i]), h), inertia);
+	__m128 dwz = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&b.tz[i]), h), inertia);
+	__m128 rx = _mm_add_ps(_mm_mul_ps(wx, h), _mm_mul_ps(_mm_mul_ps(half, dwx), h));
+	__m128 ry = _mm_add_ps(_mm_mul_ps(wy, h), _mm_mul_ps(_mm_mul_ps(half, dwy), h));
+	__m128 rz = _mm_add_ps(_mm_mul_ps(wz, h), _mm_mul_ps(_mm_mul_ps(half, dwz), h));
+	wx = _mm_add_ps(wx, dwx);
+	wy = _mm_add_ps(wy, dwy);
+	wz = _mm_add_ps(wz, dwz);
+
+	// orientation, left alone where there's no rotation
+	__m128 qx = _mm_loadu_ps(&b.qx[i]), qy = _mm_loadu_ps(&b.qy[i]);
+	__m128 qz = _mm_loadu_ps(&b.qz[i]), qw = _mm_loadu_ps(&b.qw[i]);
+	__m128 nx = _mm_add_ps(qx, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(rx, qw), _mm_mul_ps(ry, qz)),
+														  _mm_mul_ps(rz, qy))));
+	__m128 ny = _mm_add_ps(qy, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(ry, qw), _mm_mul_ps(rz, qx)),
+														  _mm_mul_ps(rx, qz))));
+	__m128 nz = _mm_add_ps(qz, _mm_mul_ps(half, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(rz, qw), _mm_mul_ps(rx, qy)),
+														  _mm_mul_ps(ry, qx))));
+	__m128 nw = _mm_sub_ps(qw, _mm_mul_ps(half, _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, qx), _mm_mul_ps(ry, qy)),
+														  _mm_mul_ps(rz, qz))));
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+													  _mm_mul_ps(nz, nz)), _mm_mul_ps(nw, nw)));
+	__m128 still = _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(rx, zero), _mm_cmpeq_ps(ry, zero)),
+							  _mm_cmpeq_ps(rz, zero));
+	_mm_storeu_ps(&b.qx[i], Select4(still, qx, _mm_div_ps(nx, length)));
+	_mm_storeu_ps(&b.qy[i], Select4(still, qy, _mm_div_ps(ny, length)));
+	_mm_storeu_ps(&b.qz[i], Select4(still, qz, _mm_div_ps(nz, length)));
+	_mm_storeu_ps(&b.qw[i], Select4(still, qw, _mm_div_ps(nw, length)));
+
+	// too slow counts as stopped
+	__m128 moving = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+											_mm_mul_ps(vz, vz)), _mm_loadu_ps(&b.minSpeed2[i]));
+	__m128 turning = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy)),
+											 _mm_mul_ps(wz, wz)), _mm_loadu_ps(&b.minAngularSpeed2[i]));
+	_mm_storeu_ps(&b.vx[i], _mm_and_ps(moving, vx));
+	_mm_storeu_ps(&b.vy[i], _mm_and_ps(moving, vy));
+	_mm_storeu_ps(&b.vz[i], _mm_and_ps(moving, vz));
+	_mm_storeu_ps(&b.wx[i], _mm_and_ps(turning, wx));
+	_mm_storeu_ps(&b.wy[i], _mm_and_ps(turning, wy));
+	_mm_storeu_ps(&b.wz[i], _mm_and_ps(turning, wz));
+}
+#endif
+
+// float batches go four at a time where there's SSE, and anything else one
+// at a time - returns the first body left over
+template<typename Real>
+static unsigned int IntegrateBatches(Scene::BasicBodies<Real>&, unsigned int a_begin, unsigned int, Real)
+{
+	return a_begin;
+}
+static unsigned int IntegrateBatches(Scene::Bodies& a_bodies, unsigned int a_begin, unsigned int a_end,
+									 float a_deltaTime)
+{
+	unsigned int i = a_begin;
+#ifdef SCENE_SSE
+	for (; i + 4 <= a_end; i += 4)
+		IntegrateBodies4(a_bodies, i, a_deltaTime);
+#endif
+	return i;
+}
+
+template<typename Real>
+void Scene::IntegrateBodies(BasicBodies<Real>& a_bodies, unsigned int a_begin, unsigned int a_end,
+							Real a_deltaTime)
+{
+	for (unsigned int i = IntegrateBatches(a_bodies, a_begin, a_end, a_deltaTime); i < a_end; ++i)
+		IntegrateBody(a_bodies, i, a_deltaTime);
+}
+template void Scene::IntegrateBodies(BasicBodies<float>&, unsigned int, unsigned int, float);
+template void Scene::IntegrateBodies(BasicBodies<double>&, unsigned int, unsigned int, double);
+
+// Actors that need more than integrating - static ones being moved and spheres
+// rolling on a support - are still updated one at a time.  The free ones are
+// split between the worker threads in groups of four, and each thread takes
+// its share a block at a time, so that the actors it gathers are still in the
+// cache when it scatters the results back to them.
+void Scene::IntegrateActors()
+{
+	m_freeActors.clear();
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
+	{
+		Actor* actor = m_actors[i];
+		if (IsDisc(i))
+			continue;
+		actor->StorePose();
+		if (actor->IsFree())
+			m_freeActors.push_back(actor);
+		else if (actor->IsAwake() || !actor->IsDynamic())
+			actor->Update(m_timeStep, m_gravity);
+	}
+
+	unsigned int count = m_freeActors.size();
+	m_bodies.resize(count);
+	m_workers.ParallelFor((count + 3) / 4, INTEGRATION_BLOCK / 4,
+						  [this, count](unsigned int a_begin, unsigned int a_end)
+	{
+		for (unsigned int begin = a_begin * 4; begin < std::min(a_end * 4, count); begin += INTEGRATION_BLOCK)
+		{
+			unsigned int end = std::min(std::min(begin + INTEGRATION_BLOCK, a_end * 4), count);
+			for (unsigned int i = begin; i < end; ++i)
+				m_bodies.Gather(i, *m_freeActors[i], m_gravity);
+			IntegrateBodies(m_bodies, begin, end, (float)m_timeStep);
+			for (unsigned int i = begin; i < end; ++i)
+				m_bodies.Scatter(i, *m_freeActors[i]);
+		}
+	});
+}
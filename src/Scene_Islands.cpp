@@ -0,0 +1,136 @@
+#include "Scene.h"
+
+// Islands are groups of dynamic actors joined by the pairs between them.
+// Static actors never join islands - resolution doesn't change them, so the
+// balls resting on the table bed don't all end up in one island.  Discs in
+// planar mode aren't island actors, since the planar step moves them and puts
+// them to sleep, but resolution can still push them - so they join the
+// islands of the actors they touch, keeping every pair with a disc in one
+// island and the disc on one thread.
+
+unsigned int Scene::FindRoot(std::vector<unsigned int>& a_parents, unsigned int a_index)
+{
+	while (a_parents[a_index] != a_index)
+	{
+		a_parents[a_index] = a_parents[a_parents[a_index]];
+		a_index = a_parents[a_index];
+	}
+	return a_index;
+}
+
+void Scene::Join(std::vector<unsigned int>& a_parents, int a_index1, int a_index2)
+{
+	if (0 > a_index1 || 0 > a_index2)
+		return;
+	unsigned int root1 = FindRoot(a_parents, a_index1);
+	unsigned int root2 = FindRoot(a_parents, a_index2);
+	if (root1 != root2)
+		a_parents[root1] = root2;
+}
+
+// index into m_islandActors, or -1 for static actors
+int Scene::IslandIndexOf(Actor* a_actor) const
+{
+	int body = BodyOf(a_actor);
+	return (0 <= body ? m_islandIndices[body] : -1);
+}
+
+void Scene::BuildIslands()
+{
+	// join actors over every candidate pair, not just the touching ones - a
+	// pair that wasn't touching can start to once an earlier contact pushes
+	// one of its actors, and that must happen inside a single island
+	// discs are numbered after the island actors
+	unsigned int count = m_islandActors.size();
+	auto joinIndexOf = [this, count](Actor* a_actor)
+	{
+		int body = BodyOf(a_actor);
+		if (0 <= body && IsDisc(body))
+			return (int)count + m_discIndices[body];
+		return (0 <= body ? m_islandIndices[body] : -1);
+	};
+	m_islandParents.resize(count + m_discs.size());
+	for (unsigned int i = 0; i < m_islandParents.size(); ++i)
+		m_islandParents[i] = i;
+	for (auto& pair : m_pairs)
+		Join(m_islandParents, joinIndexOf(pair.actor1), joinIndexOf(pair.actor2));
+
+	// number the islands in order of their first pair, and count their pairs
+	m_islands.clear();
+	m_actorIslands.assign(m_islandParents.size(), -1);
+	m_pairIslands.resize(m_pairs.size());
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		// every pair has at least one dynamic actor
+		int index = joinIndexOf(m_pairs[i].actor1);
+		if (0 > index)
+			index = joinIndexOf(m_pairs[i].actor2);
+		int& island = m_actorIslands[FindRoot(m_islandParents, index)];
+		if (0 > island)
+		{
+			Island newIsland = { 0, 0, 0 };
+			island = m_islands.size();
+			m_islands.push_back(newIsland);
+		}
+		++m_islands[island].pairCount;
+		m_pairIslands[i] = island;
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		int island = m_actorIslands[FindRoot(m_islandParents, i)];
+		if (0 <= island)
+			++m_islands[island].actorCount;
+	}
+
+	// sort the pairs by island, keeping them in order within each island
+	unsigned int first = 0;
+	for (auto& island : m_islands)
+	{
+		island.firstPair = first;
+		first += island.pairCount;
+		island.pairCount = 0;
+	}
+	m_islandPairs.resize(m_pairs.size());
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		Island& island = m_islands[m_pairIslands[i]];
+		m_islandPairs[island.firstPair + island.pairCount++] = i;
+	}
+}
+
+// Awake actors that touch each other also sleep as a group, which only goes
+// to sleep once every actor in it has been still for long enough - otherwise
+// a ball at rest against a moving one would fall asleep and then be woken
+// again on every step.
+void Scene::UpdateSleep()
+{
+	unsigned int count = m_islandActors.size();
+	m_sleepParents.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+		m_sleepParents[i] = i;
+	for (auto& contact : m_contacts)
+	{
+		if (contact.actor1->IsAwake() && contact.actor2->IsAwake())
+			Join(m_sleepParents, IslandIndexOf(contact.actor1), IslandIndexOf(contact.actor2));
+	}
+
+	// a group has been still for as long as its least still actor
+	m_sleepStillTimes.assign(count, FLT_MAX);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		Actor* actor = m_islandActors[i];
+		if (!actor->IsAwake())
+			continue;
+		actor->UpdateStillTime((float)m_timeStep);
+		float& stillTime = m_sleepStillTimes[FindRoot(m_sleepParents, i)];
+		stillTime = fmin(stillTime, actor->GetStillTime());
+	}
+	if (0 >= m_timeToSleep)
+		return;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (m_islandActors[i]->IsAwake() &&
+			m_sleepStillTimes[FindRoot(m_sleepParents, i)] >= m_timeToSleep)
+			m_islandActors[i]->Sleep();
+	}
+}
@@ -0,0 +1,259 @@
+#include "Scene.h"
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SCENE_SSE
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SCENE_AVX
+#endif
+
+// Sphere/sphere pairs are by far the most common in a pool table scene, so
+// rather than sending each one through Geometry::DetectCollision, the overlap
+// test is run on several pairs at once from the scene's sphere arrays.  Every
+// test does the same float operations in the same order as the scalar
+// SphereSphere detector - squared distance between centers against the square
+// of the summed radii - so it accepts exactly the pairs that SphereSphere would.
+// Only the pairs that pass go on to build a full collision.
+
+static bool SpheresOverlap(const Scene::Spheres& a_spheres, int a_sphere1, int a_sphere2)
+{
+	float dx = a_spheres.x[a_sphere2] - a_spheres.x[a_sphere1];
+	float dy = a_spheres.y[a_sphere2] - a_spheres.y[a_sphere1];
+	float dz = a_spheres.z[a_sphere2] - a_spheres.z[a_sphere1];
+	float squareDistance = dx*dx + dy*dy + dz*dz;
+	float collisionDistance = a_spheres.radius[a_sphere1] + a_spheres.radius[a_sphere2];
+	return squareDistance <= collisionDistance*collisionDistance;
+}
+
+#ifdef SCENE_SSE
+static __m128 Gather4(const float* a_values, const int* a_indices)
+{
+	return _mm_set_ps(a_values[a_indices[3]], a_values[a_indices[2]],
+					  a_values[a_indices[1]], a_values[a_indices[0]]);
+}
+static int SpheresOverlap4(const Scene::Spheres& a_spheres, const int* a_spheres1, const int* a_spheres2)
+{
+	__m128 dx = _mm_sub_ps(Gather4(&a_spheres.x[0], a_spheres2), Gather4(&a_spheres.x[0], a_spheres1));
+	__m128 dy = _mm_sub_ps(Gather4(&a_spheres.y[0], a_spheres2), Gather4(&a_spheres.y[0], a_spheres1));
+	__m128 dz = _mm_sub_ps(Gather4(&a_spheres.z[0], a_spheres2), Gather4(&a_spheres.z[0], a_spheres1));
+	__m128 squareDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+									   _mm_mul_ps(dz, dz));
+	__m128 collisionDistance = _mm_add_ps(Gather4(&a_spheres.radius[0], a_spheres1),
+										  Gather4(&a_spheres.radius[0], a_spheres2));
+	return _mm_movemask_ps(_mm_cmple_ps(squareDistance,
+										_mm_mul_ps(collisionDistance, collisionDistance)));
+}
+#endif
+
+#ifdef SCENE_AVX
+static __m256 Gather8(const float* a_values, const int* a_indices)
+{
+	return _mm256_set_ps(a_values[a_indices[7]], a_values[a_indices[6]],
+						 a_values[a_indices[5]], a_values[a_indices[4]],
+						 a_values[a_indices[3]], a_values[a_indices[2]],
+						 a_values[a_indices[1]], a_values[a_indices[0]]);
+}
+static int SpheresOverlap8(const Scene::Spheres& a_spheres, const int* a_spheres1, const int* a_spheres2)
+{
+	__m256 dx = _mm256_sub_ps(Gather8(&a_spheres.x[0], a_spheres2), Gather8(&a_spheres.x[0], a_spheres1));
+	__m256 dy = _mm256_sub_ps(Gather8(&a_spheres.y[0], a_spheres2), Gather8(&a_spheres.y[0], a_spheres1));
+	__m256 dz = _mm256_sub_ps(Gather8(&a_spheres.z[0], a_spheres2), Gather8(&a_spheres.z[0], a_spheres1));
+	__m256 squareDistance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+										  _mm256_mul_ps(dz, dz));
+	__m256 collisionDistance = _mm256_add_ps(Gather8(&a_spheres.radius[0], a_spheres1),
+											 Gather8(&a_spheres.radius[0], a_spheres2));
+	return _mm256_movemask_ps(_mm256_cmp_ps(squareDistance,
+											_mm256_mul_ps(collisionDistance, collisionDistance),
+											_CMP_LE_OQ));
+}
+#endif
+
+void Scene::FilterSpherePairs()
+{
+	// pick out the sphere/sphere pairs
+	m_spherePairs.clear();
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (m_pairs[i].IsSpherePair())
+			m_spherePairs.push_back(i);
+	}
+	unsigned int count = m_spherePairs.size();
+	m_sphereOverlaps.resize(count);
+
+	// test them in batches, then one at a time for whatever is left over
+	int spheres1[8], spheres2[8];
+	unsigned int i = 0;
+#ifdef SCENE_AVX
+	for (; i + 8 <= count; i += 8)
+	{
+		for (unsigned int j = 0; j < 8; ++j)
+		{
+			spheres1[j] = m_pairs[m_spherePairs[i + j]].sphere1;
+			spheres2[j] = m_pairs[m_spherePairs[i + j]].sphere2;
+		}
+		int mask = SpheresOverlap8(m_spheres, spheres1, spheres2);
+		for (unsigned int j = 0; j < 8; ++j)
+			m_sphereOverlaps[i + j] = (mask >> j) & 1;
+	}
+#endif
+#ifdef SCENE_SSE
+	for (; i + 4 <= count; i += 4)
+	{
+		for (unsigned int j = 0; j < 4; ++j)
+		{
+			spheres1[j] = m_pairs[m_spherePairs[i + j]].sphere1;
+			spheres2[j] = m_pairs[m_spherePairs[i + j]].sphere2;
+		}
+		int mask = SpheresOverlap4(m_spheres, spheres1, spheres2);
+		for (unsigned int j = 0; j < 4; ++j)
+			m_sphereOverlaps[i + j] = (mask >> j) & 1;
+	}
+#endif
+	for (; i < count; ++i)
+	{
+		const Pair& pair = m_pairs[m_spherePairs[i]];
+		m_sphereOverlaps[i] = SpheresOverlap(m_spheres, pair.sphere1, pair.sphere2);
+	}
+
+	// drop the sphere pairs that don't touch, keeping everything else in order
+	unsigned int kept = 0, next = 0;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (next < count && m_spherePairs[next] == i && !m_sphereOverlaps[next++])
+			continue;
+		m_pairs[kept++] = m_pairs[i];
+	}
+	m_pairs.resize(kept);
+}
+
+// Detection only reads the actors, so the pairs are split between the worker
+// threads, each writing the results for its own pairs.  Results are kept in
+// pair order, so resolution sees them in the same order whatever the number
+// of threads.
+void Scene::DetectContacts()
+{
+	m_detections.resize(m_pairs.size());
+	m_workers.ParallelFor(m_pairs.size(), 64, [this](unsigned int a_begin, unsigned int a_end)
+	{
+		for (unsigned int i = a_begin; i < a_end; ++i)
+		{
+			const Pair& pair = m_pairs[i];
+			Detection& detection = m_detections[i];
+			detection.position1 = pair.actor1->GetPosition();
+			detection.position2 = pair.actor2->GetPosition();
+			detection.collision.separatingAxis = CachedAxisOf(pair);
+			detection.touching = DetectPair(pair, &detection.collision);
+		}
+	});
+	UpdateAxisCache();
+}
+
+static bool HasHull(const Scene::Pair& a_pair)
+{
+	return (Geometry::HULL == a_pair.actor1->GetGeometry().GetShape() ||
+			Geometry::HULL == a_pair.actor2->GetGeometry().GetShape());
+}
+
+// only read while the pairs are detected, so the threads can share it
+glm::vec3 Scene::CachedAxisOf(const Pair& a_pair) const
+{
+	if (m_axisCache.empty() || !HasHull(a_pair))
+		return glm::vec3(0);
+	CachedAxis key;
+	key.actor1 = a_pair.actor1;
+	key.actor2 = a_pair.actor2;
+	bool swapped = std::less<const Actor*>()(key.actor2, key.actor1);
+	if (swapped)
+		std::swap(key.actor1, key.actor2);
+	auto cached = std::lower_bound(m_axisCache.begin(), m_axisCache.end(), key);
+	if (m_axisCache.end() == cached || cached->actor1 != key.actor1 || cached->actor2 != key.actor2)
+		return glm::vec3(0);
+	return (swapped ? -cached->axis : cached->axis);
+}
+
+// rebuilt from this step's pairs, so pairs that have parted are forgotten,
+// and a new actor that gets a destroyed one's address at worst starts its
+// search from a poor direction
+void Scene::UpdateAxisCache()
+{
+	m_axisCache.clear();
+	CachedAxis entry;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (!HasHull(m_pairs[i]))
+			continue;
+		entry.actor1 = m_pairs[i].actor1;
+		entry.actor2 = m_pairs[i].actor2;
+		entry.axis = m_detections[i].collision.separatingAxis;
+		if (std::less<const Actor*>()(entry.actor2, entry.actor1))
+		{
+			std::swap(entry.actor1, entry.actor2);
+			entry.axis *= -1.0f;
+		}
+		m_axisCache.push_back(entry);
+	}
+	std::sort(m_axisCache.begin(), m_axisCache.end());
+}
+
+void Scene::ResolveContacts()
+{
+	// islands share no dynamic actors and resolution never changes static
+	// ones, so each island can be solved on its own thread
+	BuildIslands();
+	if (0 < m_solverIterations)
+	{
+		SolveContacts();
+	}
+	else
+	{
+		m_workers.ParallelFor(m_islands.size(), 1, [this](unsigned int a_begin, unsigned int a_end)
+		{
+			for (unsigned int i = a_begin; i < a_end; ++i)
+			{
+				const Island& island = m_islands[i];
+				for (unsigned int j = 0; j < island.pairCount; ++j)
+					ResolvePair(m_islandPairs[island.firstPair + j]);
+			}
+		});
+	}
+
+	// record the contacts in pair order - the buffer keeps its capacity
+	// between steps, so this doesn't allocate once the scene has settled into
+	// its usual number of contacts
+	m_contacts.clear();
+	Contact contact;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (!m_detections[i].touching)
+			continue;
+		contact.actor1 = m_pairs[i].actor1;
+		contact.actor2 = m_pairs[i].actor2;
+		contact.collision = m_detections[i].collision;
+		m_contacts.push_back(contact);
+	}
+}
+
+void Scene::ResolvePair(unsigned int a_pair)
+{
+	// resolving a contact can push its actors, and any later pair with an
+	// actor that's been pushed is detected again.  Pairs are resolved in the
+	// same order however many threads there are, so the result doesn't
+	// depend on the thread count
+	const Pair& pair = m_pairs[a_pair];
+	Detection& detection = m_detections[a_pair];
+	if (pair.actor1->GetPosition() != detection.position1 ||
+		pair.actor2->GetPosition() != detection.position2)
+		detection.touching = DetectPair(pair, &detection.collision);
+	if (!detection.touching)
+		return;
+
+	// anything awake touching a sleeping actor wakes it up
+	if (pair.actor1->IsAwake() && !pair.actor2->IsAwake())
+		pair.actor2->Wake();
+	else if (pair.actor2->IsAwake() && !pair.actor1->IsAwake())
+		pair.actor1->Wake();
+	Actor::ResolveCollision(pair.actor1, pair.actor2, detection.collision);
+}
@@ -0,0 +1,618 @@
+#include "Scene.h"
+#include <algorithm>
+
+// A ball rolling on the bed never moves along the up axis, so in planar mode
+// the supported spheres are gathered at the start of each update into discs
+// that only have a position and velocity in the plane, along with the spin
+// they need for friction.  Between each other they're circle/circle tests,
+// and the cushions - static boxes standing upright on the plane - are seen
+// from above as rectangles, so against those they're circle/rectangle
+// tests.  None of it goes through the broadphase, the narrowphase or the 3D
+// solver, and their rotation is only applied to the actors when the discs
+// are handed back at the end of the update.
+//
+// A disc leaves the plane as soon as it's no longer over its support, or
+// comes near anything it can't be tested against in the plane - another
+// kind of static actor, a box it would touch above or below its middle, or
+// an actor moving in 3D.  Its actor then goes back to the 3D step, which
+// supports it again once it's resting on a face.
+
+// cosine of the largest angle between an upright box's side and the up axis
+static const float UPRIGHT = 0.999f;
+// height difference that counts as a box's top being level with a disc's bottom
+static const float PLANAR_TOLERANCE = 0.001f;
+// fraction of its radius a disc keeps clear of what it can't be tested against
+static const float PLANAR_MARGIN = 0.1f;
+// fraction of its radius a disc has to move before it's swept against footprints
+static const float SWEEP_THRESHOLD = 0.5f;
+// fraction of its radius a swept disc is moved past its first impact
+static const float SWEEP_SKIN = 0.01f;
+// the same as the contact solver's, so balls behave alike in both
+static const float BOUNCE_THRESHOLD = 1.0f;
+static const float PENETRATION_SLOP = 0.005f;
+static const float PENETRATION_CORRECTION = 0.8f;
+
+// index of the box's axis that's along the up axis, or -1 if it isn't upright
+static int UprightAxis(const Geometry::Box& a_box, const glm::vec3& a_up)
+{
+	const glm::mat3& rotation = a_box.rotationMatrix();
+	for (int i = 0; i < 3; ++i)
+	{
+		if (UPRIGHT <= fabs(glm::dot(rotation[i], a_up)))
+			return i;
+	}
+	return -1;
+}
+
+void Scene::GatherDiscs()
+{
+	m_discs.clear();
+	m_discIndices.assign(m_actors.size(), -1);
+	m_footprints.clear();
+	m_obstacles.clear();
+	m_awakeDiscs = 0;
+	m_discSteps = 0;
+	if (glm::vec3(0) == m_gravity)
+		return;
+	m_up = -glm::normalize(m_gravity);
+	m_planeX = glm::normalize(glm::cross(m_up, (UPRIGHT > fabs(m_up.z) ? glm::vec3(0, 0, 1) :
+																		 glm::vec3(1, 0, 0))));
+	m_planeY = glm::cross(m_planeX, m_up);
+
+	// static boxes standing upright are seen from above, anything else
+	// static is only kept clear of
+	for (auto actor : m_actors)
+	{
+		if (actor->IsDynamic())
+			continue;
+		const Geometry& geometry = actor->GetGeometry();
+		int up = (Geometry::BOX == geometry.GetShape() ?
+				  UprightAxis(static_cast<const Geometry::Box&>(geometry), m_up) : -1);
+		if (0 > up)
+		{
+			m_obstacles.push_back(actor);
+			continue;
+		}
+		const Geometry::Box& box = static_cast<const Geometry::Box&>(geometry);
+		int side1 = (up + 1) % 3, side2 = (up + 2) % 3;
+		float height = glm::dot(box.position, m_up);
+		Footprint footprint;
+		footprint.actor = actor;
+		footprint.center = ToPlane(box.position);
+		footprint.axis = glm::normalize(ToPlane(box.rotationMatrix()[side1]));
+		footprint.extents = glm::vec2(box.extents[side1], box.extents[side2]);
+		footprint.bottom = height - box.extents[up];
+		footprint.top = height + box.extents[up];
+		m_footprints.push_back(footprint);
+	}
+
+	// spheres supported on a level face become discs
+	for (unsigned int i = 0; i < m_actors.size(); ++i)
+	{
+		Actor* actor = m_actors[i];
+		const Actor* support = actor->GetSupport();
+		if (nullptr == support || UPRIGHT > glm::dot(actor->GetSupportNormal(), m_up))
+			continue;
+		Disc disc;
+		disc.support = -1;
+		if (Geometry::BOX == support->GetGeometry().GetShape())
+		{
+			for (unsigned int j = 0; j < m_footprints.size() && 0 > disc.support; ++j)
+			{
+				if (m_footprints[j].actor == support)
+					disc.support = j;
+			}
+			if (0 > disc.support)
+				continue;
+		}
+		const Actor::Material& material = actor->GetMaterial();
+		const Actor::Material& surface = support->GetMaterial();
+		disc.actor = actor;
+		disc.radius = static_cast<const Geometry::Sphere&>(actor->GetGeometry()).radius;
+		disc.height = glm::dot(actor->GetPosition(), m_up);
+		disc.inverseMass = actor->GetInverseMass();
+		disc.inverseInertia = actor->GetInverseInertia()[0][0];	// the same about every axis
+		disc.friction = (material.dynamicFriction + surface.dynamicFriction) / 2;
+		disc.resistance = (material.rollingResistance + surface.rollingResistance) / 2;
+		disc.stillTime = actor->GetStillTime();
+		disc.awake = actor->IsAwake();
+		disc.position = disc.stepPosition = ToPlane(actor->GetPosition());
+		disc.velocity = ToPlane(actor->GetVelocity());
+		disc.angularVelocity = actor->GetAngularVelocity();
+		disc.rotation = disc.stepRotation = glm::quat();
+		m_discIndices[i] = m_discs.size();
+		m_discs.push_back(disc);
+		if (disc.awake)
+			++m_awakeDiscs;
+	}
+	m_discOrder.resize(m_discs.size());
+	for (unsigned int i = 0; i < m_discOrder.size(); ++i)
+		m_discOrder[i] = i;
+}
+
+void Scene::StepDiscs()
+{
+	// the bounds of everything moving in 3D, to keep the discs clear of -
+	// the dynamic proxies aren't needed again until the 3D step finds pairs
+	m_dynamicProxies.clear();
+	if (m_awakeCount > m_awakeDiscs)
+	{
+		for (unsigned int i = 0; i < m_actors.size(); ++i)
+		{
+			Actor* actor = m_actors[i];
+			if (!actor->IsDynamic() || !actor->IsAwake() || IsDisc(i))
+				continue;
+			Proxy proxy(actor);
+			glm::vec3 reach(glm::length(actor->GetVelocity()) * (float)m_timeStep);
+			proxy.min -= reach;
+			proxy.max += reach;
+			m_dynamicProxies.push_back(proxy);
+		}
+	}
+
+	++m_discSteps;
+	for (unsigned int i = 0; i < m_discs.size(); ++i)
+	{
+		if (nullptr != m_discs[i].actor && LeavesPlane(i))
+			ReleaseDisc(i);
+	}
+	MoveDiscs();
+	SweepDiscs();
+	FindDiscContacts();
+	SolveDiscContacts();
+	UpdateDiscSleep();
+}
+
+bool Scene::LeavesPlane(unsigned int a_disc)
+{
+	Disc& disc = m_discs[a_disc];
+	if (0 <= disc.support && !m_footprints[disc.support].Contains(disc.position))
+	{
+		disc.actor->ClearSupport();
+		return true;
+	}
+
+	// boxes it would touch above or below their middle
+	float reach = disc.radius * (1 + PLANAR_MARGIN);
+	for (auto& footprint : m_footprints)
+	{
+		if (footprint.top <= disc.height - disc.radius + PLANAR_TOLERANCE ||
+			footprint.bottom >= disc.height + disc.radius - PLANAR_TOLERANCE ||
+			(footprint.bottom < disc.height && disc.height < footprint.top))
+			continue;
+		glm::vec2 local = footprint.ToLocal(disc.position);
+		if (glm::distance2(local, glm::clamp(local, -footprint.extents, footprint.extents)) <
+			reach * reach)
+			return true;
+	}
+
+	// other static actors
+	glm::vec3 position = ToWorld(disc.position) + m_up * disc.height;
+	Geometry::Sphere sphere(reach, position);
+	for (auto obstacle : m_obstacles)
+	{
+		if (obstacle != disc.actor->GetSupport() &&
+			Geometry::DetectCollision(sphere, obstacle->GetGeometry()))
+			return true;
+	}
+
+	// and actors moving in 3D
+	Proxy bounds;
+	bounds.min = position - glm::vec3(reach);
+	bounds.max = position + glm::vec3(reach);
+	for (auto& proxy : m_dynamicProxies)
+	{
+		if (proxy.Overlaps(bounds))
+			return true;
+	}
+	return false;
+}
+
+// as Actor::Roll has it, with only drag acting along the plane
+void Scene::MoveDiscs()
+{
+	float timeStep = (float)m_timeStep;
+	float loadImpulse = glm::length(m_gravity) * timeStep;
+	for (auto& disc : m_discs)
+	{
+		disc.stepPosition = disc.position;
+		disc.stepRotation = disc.rotation;
+		if (nullptr == disc.actor || !disc.awake)
+			continue;
+		const Actor* actor = disc.actor;
+		const Actor::Material& material = actor->GetMaterial();
+		glm::vec2 start = disc.position;
+		glm::vec3 turn = disc.angularVelocity * timeStep;
+		disc.position += disc.velocity * timeStep;
+		if (0 < material.linearDrag)
+		{
+			glm::vec2 deltaV = -disc.velocity * material.linearDrag * disc.inverseMass * timeStep;
+			disc.position += 0.5f * deltaV * timeStep;
+			disc.velocity += deltaV;
+		}
+		if (0 < material.rotationalDrag)
+		{
+			glm::vec3 deltaAV = -disc.angularVelocity * material.rotationalDrag *
+								disc.inverseInertia * timeStep;
+			turn += 0.5f * deltaAV * timeStep;
+			disc.angularVelocity += deltaAV;
+		}
+
+		// the spin axis changes as the disc rolls and bounces, so each step's
+		// turn is composed onto the last rather than summed
+		disc.rotation = glm::normalize(Geometry::Rotation(turn) * disc.rotation);
+		glm::vec3 velocity = ToWorld(disc.velocity);
+		Actor::RollOnFace(velocity, disc.angularVelocity, m_up, disc.radius, actor->GetMass(),
+						  actor->GetInertiaTensor(), actor->GetInverseInertia(),
+						  disc.friction, disc.resistance, loadImpulse);
+		disc.velocity = ToPlane(velocity);
+		float minSpeed = actor->GetMinSpeed(), minAngularSpeed = actor->GetMinAngularSpeed();
+		if (glm::length2(disc.velocity) < minSpeed * minSpeed)
+			disc.velocity = glm::vec2(0);
+		if (glm::length2(disc.angularVelocity) < minAngularSpeed * minAngularSpeed)
+			disc.angularVelocity = glm::vec3(0);
+
+		// a fast disc stops at the first footprint in its way, as fast spheres
+		// do in 3D
+		glm::vec2 displacement = disc.position - start;
+		float length = glm::length(displacement);
+		if (!m_continuous || length <= disc.radius * SWEEP_THRESHOLD)
+			continue;
+		float impact = 1;
+		for (auto& footprint : m_footprints)
+		{
+			if (footprint.bottom >= disc.height || disc.height >= footprint.top)
+				continue;
+			glm::vec2 origin = footprint.ToLocal(start);
+			glm::vec2 direction = footprint.ToLocal(footprint.center + displacement);
+			glm::vec2 extents = footprint.extents + glm::vec2(disc.radius);
+			if (fabs(origin.x) <= extents.x && fabs(origin.y) <= extents.y)
+				continue;
+			float enter = 0, exit = 1;
+			for (int i = 0; i < 2 && enter <= exit; ++i)
+			{
+				if (0 == direction[i])
+				{
+					if (fabs(origin[i]) > extents[i])
+						exit = -1;
+					continue;
+				}
+				float t1 = (-extents[i] - origin[i]) / direction[i];
+				float t2 = (extents[i] - origin[i]) / direction[i];
+				enter = fmax(enter, fmin(t1, t2));
+				exit = fmin(exit, fmax(t1, t2));
+			}
+			if (enter <= exit)
+				impact = fmin(impact, enter);
+		}
+		if (1 > impact)
+			disc.position = start + displacement * fmin(1.0f, impact + disc.radius * SWEEP_SKIN / length);
+	}
+}
+
+// A fast disc also stops at the first other disc in its way.  Both discs
+// are taken back to the time they first touch along their moves this step,
+// so neither passes through the other and the contact sees them touching.
+void Scene::SweepDiscs()
+{
+	if (!m_continuous)
+		return;
+	for (unsigned int i = 0; i < m_discs.size(); ++i)
+	{
+		Disc& disc1 = m_discs[i];
+		if (nullptr == disc1.actor)
+			continue;
+		for (unsigned int j = i + 1; j < m_discs.size(); ++j)
+		{
+			Disc& disc2 = m_discs[j];
+			if (nullptr == disc2.actor || PLANAR_TOLERANCE < fabs(disc1.height - disc2.height))
+				continue;
+			glm::vec2 displacement1 = disc1.position - disc1.stepPosition;
+			glm::vec2 displacement2 = disc2.position - disc2.stepPosition;
+			if (glm::length2(displacement1) <= disc1.radius * disc1.radius * SWEEP_THRESHOLD * SWEEP_THRESHOLD &&
+				glm::length2(displacement2) <= disc2.radius * disc2.radius * SWEEP_THRESHOLD * SWEEP_THRESHOLD)
+				continue;
+
+			// disc2's move relative to disc1, from where they both started -
+			// discs already touching then are left to the contacts
+			glm::vec2 offset = disc2.stepPosition - disc1.stepPosition;
+			glm::vec2 motion = displacement2 - displacement1;
+			float collisionDistance = disc1.radius + disc2.radius;
+			float c = glm::dot(offset, offset) - collisionDistance * collisionDistance;
+			float a = glm::dot(motion, motion);
+			float b = glm::dot(offset, motion);
+			if (0 >= c || 0 <= b || 0 == a || b * b < a * c)
+				continue;
+			float impact = (-b - sqrt(b * b - a * c)) / a;
+			if (1 <= impact)
+				continue;
+			impact = fmin(1.0f, impact + collisionDistance * SWEEP_SKIN / sqrt(a));
+			disc1.position = disc1.stepPosition + displacement1 * impact;
+			disc2.position = disc2.stepPosition + displacement2 * impact;
+		}
+	}
+}
+
+void Scene::FindDiscContacts()
+{
+	m_discContacts.clear();
+	DiscContact contact;
+	contact.normalImpulse = contact.tangentImpulse = 0;
+
+	// sweep along the plane's x axis, keeping the order from the last step
+	for (unsigned int i = 1; i < m_discOrder.size(); ++i)
+	{
+		unsigned int disc = m_discOrder[i];
+		float left = m_discs[disc].position.x - m_discs[disc].radius;
+		unsigned int j = i;
+		for (; 0 < j && left < m_discs[m_discOrder[j - 1]].position.x - m_discs[m_discOrder[j - 1]].radius; --j)
+			m_discOrder[j] = m_discOrder[j - 1];
+		m_discOrder[j] = disc;
+	}
+	for (unsigned int i = 0; i < m_discOrder.size(); ++i)
+	{
+		Disc& disc1 = m_discs[m_discOrder[i]];
+		if (nullptr == disc1.actor)
+			continue;
+		float right = disc1.position.x + disc1.radius;
+		for (unsigned int j = i + 1; j < m_discOrder.size(); ++j)
+		{
+			Disc& disc2 = m_discs[m_discOrder[j]];
+			if (right < disc2.position.x - disc2.radius)
+				break;
+
+			// discs on different planes can't touch without one of them
+			// having left its support
+			if (nullptr == disc2.actor || (!disc1.awake && !disc2.awake) ||
+				PLANAR_TOLERANCE < fabs(disc1.height - disc2.height))
+				continue;
+			glm::vec2 offset = disc2.position - disc1.position;
+			float distance = glm::length(offset);
+			float collisionDistance = disc1.radius + disc2.radius;
+			if (distance > collisionDistance)
+				continue;
+
+			// anything awake touching a sleeping disc wakes it up
+			Disc& sleeping = (disc1.awake ? disc2 : disc1);
+			if (!sleeping.awake)
+			{
+				sleeping.awake = true;
+				sleeping.stillTime = 0;
+			}
+			contact.disc1 = m_discOrder[i];
+			contact.disc2 = m_discOrder[j];
+			contact.wall = nullptr;
+			contact.normal = (0 < distance ? offset / distance : glm::vec2(1, 0));
+			contact.interpenetration = collisionDistance - distance;
+			m_discContacts.push_back(contact);
+		}
+	}
+
+	// and against the sides of upright boxes across the plane
+	for (unsigned int i = 0; i < m_discs.size(); ++i)
+	{
+		const Disc& disc = m_discs[i];
+		if (nullptr == disc.actor || !disc.awake)
+			continue;
+		for (auto& footprint : m_footprints)
+		{
+			if (footprint.bottom >= disc.height || disc.height >= footprint.top)
+				continue;
+			glm::vec2 local = footprint.ToLocal(disc.position);
+			glm::vec2 closest = glm::clamp(local, -footprint.extents, footprint.extents);
+			glm::vec2 normal;
+			float interpenetration;
+			if (closest != local)
+			{
+				float distance = glm::distance(local, closest);
+				if (distance > disc.radius)
+					continue;
+				normal = (closest - local) / distance;
+				interpenetration = disc.radius - distance;
+			}
+			else
+			{
+				// the center got inside, so out through the nearest side
+				glm::vec2 depths = footprint.extents - glm::abs(local);
+				int side = (depths.x < depths.y ? 0 : 1);
+				normal = glm::vec2(0);
+				normal[side] = (0 > local[side] ? 1.0f : -1.0f);
+				interpenetration = depths[side] + disc.radius;
+			}
+			contact.disc1 = i;
+			contact.disc2 = -1;
+			contact.wall = footprint.actor;
+			contact.normal = footprint.ToPlane(normal) - footprint.center;
+			contact.interpenetration = interpenetration;
+			m_discContacts.push_back(contact);
+		}
+	}
+}
+
+// The same sequential impulses as the contact solver, in the plane.  The
+// contact points are level with the discs' centers, so the normal impulse
+// never turns them, and friction along the plane is all there is.
+void Scene::SolveDiscContacts()
+{
+	if (m_discContacts.empty())
+		return;
+
+	auto pointVelocity = [this](const Disc& a_disc, const glm::vec2& a_offset)
+	{
+		return a_disc.velocity + ToPlane(glm::cross(a_disc.angularVelocity, ToWorld(a_offset)));
+	};
+	auto relativeVelocity = [&](const DiscContact& a_contact)
+	{
+		const Disc& disc1 = m_discs[a_contact.disc1];
+		glm::vec2 velocity = -pointVelocity(disc1, a_contact.normal * disc1.radius);
+		if (0 <= a_contact.disc2)
+		{
+			const Disc& disc2 = m_discs[a_contact.disc2];
+			velocity += pointVelocity(disc2, -a_contact.normal * disc2.radius);
+		}
+		return velocity;
+	};
+	// impulse acts on disc2, and the opposite on disc1
+	auto applyImpulse = [&](const DiscContact& a_contact, const glm::vec2& a_impulse)
+	{
+		Disc& disc1 = m_discs[a_contact.disc1];
+		disc1.velocity -= a_impulse * disc1.inverseMass;
+		disc1.angularVelocity += disc1.inverseInertia * glm::cross(ToWorld(a_contact.normal * disc1.radius),
+																   ToWorld(-a_impulse));
+		if (0 > a_contact.disc2)
+			return;
+		Disc& disc2 = m_discs[a_contact.disc2];
+		disc2.velocity += a_impulse * disc2.inverseMass;
+		disc2.angularVelocity += disc2.inverseInertia * glm::cross(ToWorld(-a_contact.normal * disc2.radius),
+																   ToWorld(a_impulse));
+	};
+
+	for (auto& contact : m_discContacts)
+	{
+		const Disc& disc1 = m_discs[contact.disc1];
+		const Actor::Material& material1 = disc1.actor->GetMaterial();
+		const Actor::Material& material2 = (0 <= contact.disc2 ?
+											m_discs[contact.disc2].actor->GetMaterial() :
+											contact.wall->GetMaterial());
+		float inverseMass = disc1.inverseMass;
+		float inverseInertia = disc1.inverseInertia * disc1.radius * disc1.radius;
+		if (0 <= contact.disc2)
+		{
+			const Disc& disc2 = m_discs[contact.disc2];
+			inverseMass += disc2.inverseMass;
+			inverseInertia += disc2.inverseInertia * disc2.radius * disc2.radius;
+		}
+		contact.normalMass = (0 < inverseMass ? 1 / inverseMass : 0);
+		contact.tangentMass = (0 < inverseMass + inverseInertia ? 1 / (inverseMass + inverseInertia) : 0);
+		contact.friction = (material1.dynamicFriction + material2.dynamicFriction) / 2;
+		float approachSpeed = -glm::dot(relativeVelocity(contact), contact.normal);
+		contact.bounceSpeed = (approachSpeed > BOUNCE_THRESHOLD ?
+							   approachSpeed * fmin(material1.elasticity, material2.elasticity) : 0);
+	}
+
+	unsigned int iterations = std::max(1u, m_solverIterations);
+	for (unsigned int i = 0; i < iterations; ++i)
+	{
+		for (auto& contact : m_discContacts)
+		{
+			// friction, limited to what the current normal impulse allows
+			glm::vec2 tangent(-contact.normal.y, contact.normal.x);
+			float oldImpulse = contact.tangentImpulse;
+			float maxFriction = contact.friction * contact.normalImpulse;
+			contact.tangentImpulse = glm::clamp(contact.tangentImpulse - contact.tangentMass *
+												glm::dot(relativeVelocity(contact), tangent),
+												-maxFriction, maxFriction);
+			applyImpulse(contact, tangent * (contact.tangentImpulse - oldImpulse));
+
+			// normal impulse, which can only ever push the discs apart
+			oldImpulse = contact.normalImpulse;
+			contact.normalImpulse = fmax(0.0f, contact.normalImpulse + contact.normalMass *
+											   (contact.bounceSpeed -
+												glm::dot(relativeVelocity(contact), contact.normal)));
+			applyImpulse(contact, contact.normal * (contact.normalImpulse - oldImpulse));
+		}
+	}
+
+	for (auto& contact : m_discContacts)
+	{
+		float correction = fmax(0.0f, contact.interpenetration - PENETRATION_SLOP) * PENETRATION_CORRECTION;
+		if (0 >= correction || 0 >= contact.normalMass)
+			continue;
+		glm::vec2 push = contact.normal * correction * contact.normalMass;
+		Disc& disc1 = m_discs[contact.disc1];
+		disc1.position -= push * disc1.inverseMass;
+		if (0 <= contact.disc2)
+			m_discs[contact.disc2].position += push * m_discs[contact.disc2].inverseMass;
+	}
+}
+
+// discs touching each other only sleep together, as actors do in 3D - a
+// group has been still for as long as its least still disc, however many
+// contacts away the others are
+void Scene::UpdateDiscSleep()
+{
+	float timeStep = (float)m_timeStep;
+	for (auto& disc : m_discs)
+	{
+		if (nullptr == disc.actor || !disc.awake)
+			continue;
+		float minSpeed = disc.actor->GetMinSpeed(), minAngularSpeed = disc.actor->GetMinAngularSpeed();
+		bool still = (glm::length2(disc.velocity) < minSpeed * minSpeed &&
+					  glm::length2(disc.angularVelocity) < minAngularSpeed * minAngularSpeed);
+		disc.stillTime = (still ? disc.stillTime + timeStep : 0);
+	}
+
+	// the 3D step's sleep groups aren't needed again until its UpdateSleep
+	unsigned int count = m_discs.size();
+	m_sleepParents.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+		m_sleepParents[i] = i;
+	for (auto& contact : m_discContacts)
+		Join(m_sleepParents, contact.disc1, contact.disc2);
+	m_sleepStillTimes.assign(count, FLT_MAX);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		if (nullptr == m_discs[i].actor || !m_discs[i].awake)
+			continue;
+		float& stillTime = m_sleepStillTimes[FindRoot(m_sleepParents, i)];
+		stillTime = fmin(stillTime, m_discs[i].stillTime);
+	}
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		Disc& disc = m_discs[i];
+		if (nullptr == disc.actor || !disc.awake)
+			continue;
+		disc.stillTime = m_sleepStillTimes[FindRoot(m_sleepParents, i)];
+		if (0 >= m_timeToSleep || disc.stillTime < m_timeToSleep)
+			continue;
+		disc.awake = false;
+		disc.velocity = glm::vec2(0);
+		disc.angularVelocity = glm::vec3(0);
+		disc.stillTime = 0;
+	}
+}
+
+// hands the disc's motion back to its actor, which goes back to the 3D step
+void Scene::ReleaseDisc(unsigned int a_disc)
+{
+	Disc& disc = m_discs[a_disc];
+	Actor* actor = disc.actor;
+	if (0 < m_discSteps)
+	{
+		// drawing blends from the pose at the start of the last step
+		actor->Move(ToWorld(disc.stepPosition) + m_up * disc.height - actor->GetPosition());
+		if (glm::quat() != disc.stepRotation)
+			actor->Spin(disc.stepRotation);
+		actor->StorePose();
+		if (disc.rotation != disc.stepRotation)
+			actor->Spin(disc.rotation * glm::inverse(disc.stepRotation));
+	}
+	actor->Move(ToWorld(disc.position) + m_up * disc.height - actor->GetPosition());
+	actor->Accelerate(ToWorld(disc.velocity) - actor->GetVelocity());
+	actor->AccelerateRotation(disc.angularVelocity - actor->GetAngularVelocity());
+	actor->UpdateWorldInertia();
+	if (actor->IsAwake())
+		--m_awakeDiscs;
+	if (disc.awake)
+	{
+		// carrying on from the time it's been still in the plane
+		actor->Wake();
+		actor->UpdateStillTime(disc.stillTime);
+	}
+	else
+		actor->Sleep();
+	m_discIndices[BodyOf(actor)] = -1;
+	disc.actor = nullptr;
+}
+
+void Scene::ReleaseDiscs()
+{
+	for (unsigned int i = 0; i < m_discs.size(); ++i)
+	{
+		if (nullptr != m_discs[i].actor)
+			ReleaseDisc(i);
+	}
+	m_discIndices.clear();
+	if (0 < m_discSteps)
+		UpdateTree();
+}
@@ -0,0 +1,69 @@
+#include "Scene.h"
+
+// Each query walks the bounding volume tree, so a batch of n queries against
+// m actors costs O(n log m) instead of testing every actor for every query.
+
+unsigned int Scene::Raycast(const Ray* a_rays, unsigned int a_count, Hit* a_hits) const
+{
+	return SphereCast(a_rays, a_count, 0, a_hits);
+}
+
+unsigned int Scene::SphereCast(const Ray* a_rays, unsigned int a_count, float a_radius,
+							   Hit* a_hits) const
+{
+	unsigned int hitCount = 0;
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		const Ray& ray = a_rays[i];
+		Hit& hit = a_hits[i];
+		hit = Hit();
+		if (glm::vec3(0) == ray.direction)
+			continue;
+		glm::vec3 direction = glm::normalize(ray.direction);
+
+		// exact test for each leaf the ray reaches, keeping the nearest hit
+		m_tree.Raycast(ray.origin, direction, ray.maxDistance, a_radius,
+					   [&](int a_proxy, float a_maxDistance)
+		{
+			Actor* actor = m_tree.GetActor(a_proxy);
+			float distance;
+			glm::vec3 normal;
+			if (actor == ray.ignore ||
+				!(0 < a_radius ? actor->GetGeometry().SphereCast(ray.origin, direction, a_radius,
+																 a_maxDistance, &distance, &normal)
+							   : actor->GetGeometry().Raycast(ray.origin, direction,
+															  a_maxDistance, &distance, &normal)))
+				return a_maxDistance;
+			hit.actor = actor;
+			hit.distance = distance;
+			hit.normal = normal;
+			return distance;
+		});
+
+		if (nullptr != hit.actor)
+		{
+			hit.point = ray.origin + direction * hit.distance - hit.normal * a_radius;
+			++hitCount;
+		}
+	}
+	return hitCount;
+}
+
+unsigned int Scene::Overlap(const Geometry::Sphere* a_spheres, unsigned int a_count,
+							std::vector<OverlapResult>& a_results) const
+{
+	unsigned int resultCount = a_results.size();
+	for (unsigned int i = 0; i < a_count; ++i)
+	{
+		const Geometry::Sphere& sphere = a_spheres[i];
+		glm::vec3 extents(sphere.radius);
+		m_tree.Query(sphere.position - extents, sphere.position + extents, [&](int a_proxy)
+		{
+			Actor* actor = m_tree.GetActor(a_proxy);
+			if (Geometry::DetectCollision(sphere, actor->GetGeometry()))
+				a_results.push_back(OverlapResult(i, actor));
+			return true;
+		});
+	}
+	return a_results.size() - resultCount;
+}
@@ -0,0 +1,450 @@
+#include "Scene.h"
+#include <algorithm>
+
+// The solver works on every touching pair of an island at once, with a
+// contact for each point the pair touches at.  Each contact is first set up
+// with everything that stays the same over the step, and given the impulses
+// its point ended the last step with.  The velocity
+// iterations then apply corrective impulses one contact after another,
+// keeping a running total per contact that is clamped rather than each
+// correction on its own - so a contact can take back impulse an earlier
+// iteration gave it too much of, but never pull its actors together.  Only
+// then is interpenetration pushed out, which changes no velocities.
+
+// approach speeds below this don't bounce, so resting contacts stay at rest
+static const float BOUNCE_THRESHOLD = 1.0f;
+// interpenetration that is left alone, so resting contacts stay touching
+static const float PENETRATION_SLOP = 0.005f;
+// share of the rest that is pushed out each step
+static const float PENETRATION_CORRECTION = 0.8f;
+
+// The math for a single contact point is written once for either precision
+// and for any kind of body, through an accessor with the body's state - the
+// scene's goes to its actors, and a sphere batch's to its arrays.
+struct ActorAccess
+{
+	typedef Actor* Body;
+	bool IsDynamic(const Actor* a_actor) const { return a_actor->IsDynamic(); }
+	const glm::vec3& Position(const Actor* a_actor) const { return a_actor->GetPosition(); }
+	const glm::vec3& Velocity(const Actor* a_actor) const { return a_actor->GetVelocity(); }
+	const glm::vec3& AngularVelocity(const Actor* a_actor) const { return a_actor->GetAngularVelocity(); }
+	float InverseMass(const Actor* a_actor) const
+	{
+		return (a_actor->IsDynamic() ? a_actor->GetInverseMass() : 0);
+	}
+	glm::mat3 InverseInertia(const Actor* a_actor) const
+	{
+		return (a_actor->IsDynamic() ? a_actor->GetInverseInertia() : glm::mat3(0));
+	}
+	void Accelerate(Actor* a_actor, const glm::vec3& a_deltaV, const glm::vec3& a_deltaAV) const
+	{
+		a_actor->Accelerate(a_deltaV);
+		a_actor->AccelerateRotation(a_deltaAV);
+	}
+	void Move(Actor* a_actor, const glm::vec3& a_displacement) const { a_actor->Move(a_displacement); }
+};
+
+template<typename Real>
+static Real EffectiveMass(const Scene::BasicSolverContact<Real>& a_contact,
+						  const typename Geometry::Precision<Real>::vec3& a_direction)
+{
+	Real k = a_contact.inverseMass1 + a_contact.inverseMass2 +
+			 glm::dot(a_direction, glm::cross(a_contact.inverseInertia1 *
+											  glm::cross(a_contact.r1, a_direction), a_contact.r1)) +
+			 glm::dot(a_direction, glm::cross(a_contact.inverseInertia2 *
+											  glm::cross(a_contact.r2, a_direction), a_contact.r2));
+	return (0 < k ? (Real)1 / k : 0);
+}
+
+template<typename Real, typename Access>
+static typename Geometry::Precision<Real>::vec3 RelativeVelocity(const Access& a_access,
+																 typename Access::Body a_body1,
+																 typename Access::Body a_body2,
+																 const Scene::BasicSolverContact<Real>& a_contact)
+{
+	return (a_access.Velocity(a_body2) + glm::cross(a_access.AngularVelocity(a_body2), a_contact.r2)) -
+		   (a_access.Velocity(a_body1) + glm::cross(a_access.AngularVelocity(a_body1), a_contact.r1));
+}
+
+// impulse acts on body2, and the opposite on body1
+template<typename Real, typename Access>
+static void ApplyContactImpulse(const Access& a_access, typename Access::Body a_body1,
+								typename Access::Body a_body2, const Scene::BasicSolverContact<Real>& a_contact,
+								const typename Geometry::Precision<Real>::vec3& a_impulse)
+{
+	if (a_access.IsDynamic(a_body1))
+		a_access.Accelerate(a_body1, -a_impulse * a_contact.inverseMass1,
+							a_contact.inverseInertia1 * glm::cross(a_contact.r1, -a_impulse));
+	if (a_access.IsDynamic(a_body2))
+		a_access.Accelerate(a_body2, a_impulse * a_contact.inverseMass2,
+							a_contact.inverseInertia2 * glm::cross(a_contact.r2, a_impulse));
+}
+
+// everything about a point that stays the same over the step, with no impulse yet
+template<typename Real, typename Access>
+static void PreparePoint(const Access& a_access, typename Access::Body a_body1, typename Access::Body a_body2,
+						 const typename Geometry::Precision<Real>::vec3& a_point,
+						 const typename Geometry::Precision<Real>::vec3& a_normal, Real a_interpenetration,
+						 Real a_friction, Real a_elasticity, Scene::BasicSolverContact<Real>& a_contact)
+{
+	typedef typename Geometry::Precision<Real>::vec3 Vec3;
+	const Vec3& n = a_normal;
+	a_contact.normal = n;
+	a_contact.tangent1 = (fabs(n.x) >= (Real)0.57735f ? Geometry::Normalize(Vec3(n.y, -n.x, 0)) :
+														Geometry::Normalize(Vec3(0, n.z, -n.y)));
+	a_contact.tangent2 = glm::cross(n, a_contact.tangent1);
+	a_contact.r1 = a_point - a_access.Position(a_body1);
+	a_contact.r2 = a_point - a_access.Position(a_body2);
+	a_contact.inverseMass1 = a_access.InverseMass(a_body1);
+	a_contact.inverseMass2 = a_access.InverseMass(a_body2);
+	a_contact.inverseInertia1 = a_access.InverseInertia(a_body1);
+	a_contact.inverseInertia2 = a_access.InverseInertia(a_body2);
+	a_contact.normalMass = EffectiveMass(a_contact, a_contact.normal);
+	a_contact.tangentMass1 = EffectiveMass(a_contact, a_contact.tangent1);
+	a_contact.tangentMass2 = EffectiveMass(a_contact, a_contact.tangent2);
+	a_contact.friction = a_friction;
+	a_contact.interpenetration = a_interpenetration;
+
+	// the bounce depends on how fast the actors were approaching before any
+	// impulses, so it's worked out once rather than every iteration
+	Real approachSpeed = -glm::dot(RelativeVelocity(a_access, a_body1, a_body2, a_contact), n);
+	a_contact.bounceSpeed = (approachSpeed > BOUNCE_THRESHOLD ? approachSpeed * a_elasticity : 0);
+
+	a_contact.normalImpulse = 0;
+	a_contact.tangentImpulse = typename Geometry::Precision<Real>::vec2(0);
+}
+
+// one iteration's corrective impulses for a point
+template<typename Real, typename Access>
+static void SolvePoint(const Access& a_access, typename Access::Body a_body1, typename Access::Body a_body2,
+					   Scene::BasicSolverContact<Real>& a_contact)
+{
+	typedef typename Geometry::Precision<Real>::vec2 Vec2;
+	typedef typename Geometry::Precision<Real>::vec3 Vec3;
+	Scene::BasicSolverContact<Real>& contact = a_contact;
+
+	// friction, limited to what the current normal impulse allows
+	Vec3 velocity = RelativeVelocity(a_access, a_body1, a_body2, contact);
+	Vec2 oldImpulse = contact.tangentImpulse;
+	contact.tangentImpulse -= Vec2(glm::dot(velocity, contact.tangent1) * contact.tangentMass1,
+								   glm::dot(velocity, contact.tangent2) * contact.tangentMass2);
+	Real maxFriction = contact.friction * contact.normalImpulse;
+	if (glm::length2(contact.tangentImpulse) > maxFriction * maxFriction)
+		contact.tangentImpulse = (0 < maxFriction ? glm::normalize(contact.tangentImpulse) * maxFriction : Vec2(0));
+	Vec2 impulse = contact.tangentImpulse - oldImpulse;
+	ApplyContactImpulse(a_access, a_body1, a_body2, contact,
+						contact.tangent1 * impulse.x + contact.tangent2 * impulse.y);
+
+	// normal impulse, which can only ever push the actors apart
+	velocity = RelativeVelocity(a_access, a_body1, a_body2, contact);
+	Real oldNormalImpulse = contact.normalImpulse;
+	contact.normalImpulse = fmax((Real)0, contact.normalImpulse + contact.normalMass *
+										  (contact.bounceSpeed - glm::dot(velocity, contact.normal)));
+	ApplyContactImpulse(a_access, a_body1, a_body2, contact,
+						contact.normal * (contact.normalImpulse - oldNormalImpulse));
+}
+
+// the pair is pushed apart once by its deepest interpenetration, however
+// many points it touches at
+template<typename Real, typename Access>
+static void CorrectPoints(const Access& a_access, typename Access::Body a_body1, typename Access::Body a_body2,
+						  const Scene::BasicSolverContact<Real>* a_contacts, unsigned int a_count)
+{
+	const Scene::BasicSolverContact<Real>& contact = a_contacts[0];
+	Real interpenetration = 0;
+	for (unsigned int i = 0; i < a_count; ++i)
+		interpenetration = fmax(interpenetration, a_contacts[i].interpenetration);
+	Real inverseMass = contact.inverseMass1 + contact.inverseMass2;
+	Real correction = fmax((Real)0, interpenetration - PENETRATION_SLOP) * PENETRATION_CORRECTION;
+	if (0 >= correction || 0 >= inverseMass)
+		return;
+	typename Geometry::Precision<Real>::vec3 push = contact.normal * (correction / inverseMass);
+	if (a_access.IsDynamic(a_body1))
+		a_access.Move(a_body1, -push * contact.inverseMass1);
+	if (a_access.IsDynamic(a_body2))
+		a_access.Move(a_body2, push * contact.inverseMass2);
+}
+
+void Scene::SolveContacts()
+{
+	m_firstSolverContacts.resize(m_pairs.size() + 1);
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		m_firstSolverContacts[i] = count;
+		if (m_detections[i].touching)
+			count += m_detections[i].collision.pointCount;
+	}
+	m_firstSolverContacts[m_pairs.size()] = count;
+	m_solverContacts.resize(count);
+	m_workers.ParallelFor(m_islands.size(), 1, [this](unsigned int a_begin, unsigned int a_end)
+	{
+		for (unsigned int i = a_begin; i < a_end; ++i)
+		{
+			const Island& island = m_islands[i];
+			const unsigned int* pairs = &m_islandPairs[island.firstPair];
+			for (unsigned int j = 0; j < island.pairCount; ++j)
+				PrepareContact(pairs[j]);
+			for (unsigned int k = 0; k < m_solverIterations; ++k)
+			{
+				for (unsigned int j = 0; j < island.pairCount; ++j)
+					SolveContact(pairs[j]);
+			}
+			for (unsigned int j = 0; j < island.pairCount; ++j)
+				CorrectContact(pairs[j]);
+
+			// as with any other impulse, whatever is left too slow to notice stops
+			for (unsigned int j = 0; j < island.pairCount; ++j)
+			{
+				m_pairs[pairs[j]].actor1->EnforceMinSpeed();
+				m_pairs[pairs[j]].actor2->EnforceMinSpeed();
+			}
+		}
+	});
+	UpdateImpulseCache();
+}
+
+void Scene::PrepareContact(unsigned int a_pair)
+{
+	const Pair& pair = m_pairs[a_pair];
+	const Detection& detection = m_detections[a_pair];
+	if (!detection.touching)
+		return;
+
+	// anything awake touching a sleeping actor wakes it up
+	if (pair.actor1->IsAwake() && !pair.actor2->IsAwake())
+		pair.actor2->Wake();
+	else if (pair.actor2->IsAwake() && !pair.actor1->IsAwake())
+		pair.actor1->Wake();
+
+	// find the impulses the pair ended the last step with
+	CachedImpulse key;
+	key.actor1 = pair.actor1;
+	key.actor2 = pair.actor2;
+	bool swapped = std::less<Actor*>()(pair.actor2, pair.actor1);
+	if (swapped)
+		std::swap(key.actor1, key.actor2);
+	auto cached = std::lower_bound(m_impulseCache.begin(), m_impulseCache.end(), key);
+	if (m_impulseCache.end() != cached &&
+		(cached->actor1 != key.actor1 || cached->actor2 != key.actor2))
+		cached = m_impulseCache.end();
+
+	// when the pair touches at a different number of points than it did,
+	// there's no telling which point is which, so each gets an equal share
+	unsigned int count = detection.collision.pointCount;
+	float sharedNormalImpulse = 0;
+	glm::vec3 sharedTangentImpulse(0);
+	if (m_impulseCache.end() != cached && cached->pointCount != count)
+	{
+		for (unsigned int i = 0; i < cached->pointCount; ++i)
+		{
+			sharedNormalImpulse += cached->normalImpulses[i] / count;
+			sharedTangentImpulse += cached->tangentImpulses[i] / (float)count;
+		}
+	}
+
+	const glm::vec3& n = detection.collision.normal;
+	const Actor::Material& material1 = pair.actor1->GetMaterial();
+	const Actor::Material& material2 = pair.actor2->GetMaterial();
+	float friction = (material1.dynamicFriction + material2.dynamicFriction) / 2;
+	float elasticity = fmin(material1.elasticity, material2.elasticity);
+	ActorAccess actors;
+	for (unsigned int i = 0; i < count; ++i)
+		PreparePoint(actors, pair.actor1, pair.actor2, detection.collision.points[i], n,
+					 detection.collision.depths[i], friction, elasticity,
+					 m_solverContacts[m_firstSolverContacts[a_pair] + i]);
+
+	// warm start from the impulses the points ended the last step with, once
+	// every point's bounce has been worked out from the velocities before it
+	if (m_impulseCache.end() == cached)
+		return;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		SolverContact& contact = m_solverContacts[m_firstSolverContacts[a_pair] + i];
+		bool same = (cached->pointCount == count);
+		glm::vec3 tangentImpulse = (same ? cached->tangentImpulses[i] : sharedTangentImpulse);
+		if (swapped)
+			tangentImpulse *= -1.0f;
+		contact.normalImpulse = (same ? cached->normalImpulses[i] : sharedNormalImpulse);
+		contact.tangentImpulse = glm::vec2(glm::dot(tangentImpulse, contact.tangent1),
+										   glm::dot(tangentImpulse, contact.tangent2));
+		ApplyContactImpulse(actors, pair.actor1, pair.actor2, contact,
+							n * contact.normalImpulse +
+							contact.tangent1 * contact.tangentImpulse.x +
+							contact.tangent2 * contact.tangentImpulse.y);
+	}
+}
+
+void Scene::SolveContact(unsigned int a_pair)
+{
+	const Pair& pair = m_pairs[a_pair];
+	ActorAccess actors;
+	for (unsigned int i = m_firstSolverContacts[a_pair]; i < m_firstSolverContacts[a_pair + 1]; ++i)
+		SolvePoint(actors, pair.actor1, pair.actor2, m_solverContacts[i]);
+}
+
+void Scene::CorrectContact(unsigned int a_pair)
+{
+	if (!m_detections[a_pair].touching)
+		return;
+	const Pair& pair = m_pairs[a_pair];
+	CorrectPoints(ActorAccess(), pair.actor1, pair.actor2, &m_solverContacts[m_firstSolverContacts[a_pair]],
+				  m_firstSolverContacts[a_pair + 1] - m_firstSolverContacts[a_pair]);
+}
+
+void Scene::UpdateImpulseCache()
+{
+	// the cache keeps its capacity between steps, so this doesn't allocate
+	// once the scene has settled into its usual number of contacts
+	m_impulseCache.clear();
+	CachedImpulse entry;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (!m_detections[i].touching)
+			continue;
+		entry.actor1 = m_pairs[i].actor1;
+		entry.actor2 = m_pairs[i].actor2;
+		bool swapped = std::less<Actor*>()(entry.actor2, entry.actor1);
+		if (swapped)
+			std::swap(entry.actor1, entry.actor2);
+		entry.pointCount = m_firstSolverContacts[i + 1] - m_firstSolverContacts[i];
+		for (unsigned int j = 0; j < entry.pointCount; ++j)
+		{
+			const SolverContact& contact = m_solverContacts[m_firstSolverContacts[i] + j];
+			entry.normalImpulses[j] = contact.normalImpulse;
+			entry.tangentImpulses[j] = contact.tangent1 * contact.tangentImpulse.x +
+									   contact.tangent2 * contact.tangentImpulse.y;
+			if (swapped)
+				entry.tangentImpulses[j] *= -1.0f;
+		}
+		m_impulseCache.push_back(entry);
+	}
+	std::sort(m_impulseCache.begin(), m_impulseCache.end());
+}
+
+// so a new actor that happens to get a destroyed one's address doesn't
+// inherit its impulses
+void Scene::ForgetImpulses(Actor* a_actor)
+{
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_impulseCache.size(); ++i)
+	{
+		if (m_impulseCache[i].actor1 != a_actor && m_impulseCache[i].actor2 != a_actor)
+			m_impulseCache[kept++] = m_impulseCache[i];
+	}
+	m_impulseCache.resize(kept);
+}
+
+// A sphere batch's bodies are its array indices, with -1 for the plane,
+// which is the only static body and never moves.
+template<typename Real>
+struct SphereAccess
+{
+	typedef int Body;
+	typedef typename Geometry::Precision<Real>::vec3 Vec3;
+	typedef typename Geometry::Precision<Real>::mat3 Mat3;
+	Scene::BasicSpheres<Real>& spheres;
+	explicit SphereAccess(Scene::BasicSpheres<Real>& a_spheres) : spheres(a_spheres) {}
+
+	bool IsDynamic(int a_body) const { return 0 <= a_body; }
+	Vec3 Position(int a_body) const
+	{
+		const Scene::BasicBodies<Real>& b = spheres.bodies;
+		return (0 <= a_body ? Vec3(b.x[a_body], b.y[a_body], b.z[a_body]) : spheres.planePosition);
+	}
+	Vec3 Velocity(int a_body) const
+	{
+		const Scene::BasicBodies<Real>& b = spheres.bodies;
+		return (0 <= a_body ? Vec3(b.vx[a_body], b.vy[a_body], b.vz[a_body]) : Vec3(0));
+	}
+	Vec3 AngularVelocity(int a_body) const
+	{
+		const Scene::BasicBodies<Real>& b = spheres.bodies;
+		return (0 <= a_body ? Vec3(b.wx[a_body], b.wy[a_body], b.wz[a_body]) : Vec3(0));
+	}
+	Real InverseMass(int a_body) const { return (0 <= a_body ? 1 / spheres.bodies.mass[a_body] : 0); }
+	Mat3 InverseInertia(int a_body) const
+	{
+		return Mat3(0 <= a_body ? 1 / spheres.bodies.rotationalInertia[a_body] : 0);
+	}
+	void Accelerate(int a_body, const Vec3& a_deltaV, const Vec3& a_deltaAV) const
+	{
+		Scene::BasicBodies<Real>& b = spheres.bodies;
+		b.vx[a_body] += a_deltaV.x;
+		b.vy[a_body] += a_deltaV.y;
+		b.vz[a_body] += a_deltaV.z;
+		b.wx[a_body] += a_deltaAV.x;
+		b.wy[a_body] += a_deltaAV.y;
+		b.wz[a_body] += a_deltaAV.z;
+	}
+	void Move(int a_body, const Vec3& a_displacement) const
+	{
+		Scene::BasicBodies<Real>& b = spheres.bodies;
+		b.x[a_body] += a_displacement.x;
+		b.y[a_body] += a_displacement.y;
+		b.z[a_body] += a_displacement.z;
+	}
+};
+
+// The batch is integrated first, as the scene's actors are, then swept along
+// x for touching pairs, and every sphere is tested against the plane.  Each
+// touching pair is one point, set up as it's found, since nothing has been
+// applied yet that would change the bounce.
+template<typename Real>
+void Scene::StepSpheres(BasicSpheres<Real>& a_spheres, Real a_deltaTime, unsigned int a_iterations)
+{
+	BasicSpheres<Real>& s = a_spheres;
+	const BasicBodies<Real>& b = s.bodies;
+	unsigned int count = s.size();
+	IntegrateBodies(s.bodies, 0, count, a_deltaTime);
+
+	s.order.resize(count);
+	for (unsigned int i = 0; i < count; ++i)
+		s.order[i] = i;
+	std::sort(s.order.begin(), s.order.end(), [&s, &b](unsigned int a_body1, unsigned int a_body2)
+	{
+		return b.x[a_body1] - s.radius[a_body1] < b.x[a_body2] - s.radius[a_body2];
+	});
+
+	SphereAccess<Real> spheres(s);
+	s.contacts.clear();
+	s.contactBodies.clear();
+	Geometry::BasicContact<Real> found;
+	BasicSolverContact<Real> contact;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		int body1 = s.order[i];
+		typename Geometry::Precision<Real>::vec3 center1 = spheres.Position(body1);
+		if (Geometry::DetectPlaneSphere(s.planeNormal, s.planePosition, center1, s.radius[body1], &found))
+		{
+			PreparePoint(spheres, -1, body1, found.point, found.normal, found.interpenetration,
+						 s.friction, s.elasticity, contact);
+			s.contacts.push_back(contact);
+			s.contactBodies.push_back(-1);
+			s.contactBodies.push_back(body1);
+		}
+		Real maxX = b.x[body1] + s.radius[body1];
+		for (unsigned int j = i + 1; j < count && b.x[s.order[j]] - s.radius[s.order[j]] <= maxX; ++j)
+		{
+			int body2 = s.order[j];
+			if (!Geometry::DetectSpheres(center1, s.radius[body1], spheres.Position(body2), s.radius[body2],
+										 &found))
+				continue;
+			PreparePoint(spheres, body1, body2, found.point, found.normal, found.interpenetration,
+						 s.friction, s.elasticity, contact);
+			s.contacts.push_back(contact);
+			s.contactBodies.push_back(body1);
+			s.contactBodies.push_back(body2);
+		}
+	}
+
+	for (unsigned int k = 0; k < a_iterations; ++k)
+	{
+		for (unsigned int i = 0; i < s.contacts.size(); ++i)
+			SolvePoint(spheres, s.contactBodies[2 * i], s.contactBodies[2 * i + 1], s.contacts[i]);
+	}
+	for (unsigned int i = 0; i < s.contacts.size(); ++i)
+		CorrectPoints(spheres, s.contactBodies[2 * i], s.contactBodies[2 * i + 1], &s.contacts[i], 1);
+}
+template void Scene::StepSpheres(BasicSpheres<float>&, float, unsigned int);
+template void Scene::StepSpheres(BasicSpheres<double>&, double, unsigned int);
@@ -0,0 +1,77 @@
+#include "Scene.h"
+#include <algorithm>
+
+// Balls spend most of their time rolling on the bed, and a contact with it
+// every step - found by the broadphase, detected, solved and pushed out
+// again - is most of the work in a pool table scene.  Once a dynamic sphere
+// rests on the flat top of a static box or plane, it's given that actor as
+// its support instead: the sphere rolls along the face in its own update,
+// and the pair is dropped as soon as the broadphase finds it.  The sphere
+// lets its support go when it's no longer over the face - over a pocket, say
+// - or is knocked off it, and from then on it's an ordinary contact again.
+
+// cosine of the steepest slope a sphere can be supported on
+static const float SUPPORT_SLOPE = 0.999f;
+// fastest a sphere can be moving into or away from a face and be supported by it
+static const float SUPPORT_SPEED = 0.1f;
+
+void Scene::SetSupportingSpheres(bool a_supporting)
+{
+	m_supportingSpheres = a_supporting;
+	if (IsSupportingSpheres())
+		return;
+	for (auto actor : m_actors)
+		actor->ClearSupport();
+}
+
+void Scene::DropSupportPairs()
+{
+	if (!IsSupportingSpheres())
+		return;
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		const Pair& pair = m_pairs[i];
+		if (pair.actor1->GetSupport() != pair.actor2 && pair.actor2->GetSupport() != pair.actor1)
+			m_pairs[kept++] = pair;
+	}
+	m_pairs.resize(kept);
+}
+
+// spheres touching a face that's level enough and barely moving into or
+// away from it are given it as their support
+void Scene::UpdateSupports()
+{
+	if (!IsSupportingSpheres() || glm::vec3(0) == m_gravity)
+		return;
+	glm::vec3 up = -glm::normalize(m_gravity);
+	for (unsigned int i = 0; i < m_pairs.size(); ++i)
+	{
+		if (!m_detections[i].touching)
+			continue;
+		Actor* sphere = m_pairs[i].actor1;
+		Actor* support = m_pairs[i].actor2;
+		glm::vec3 normal = -m_detections[i].collision.normal;
+		if (!sphere->IsDynamic())
+		{
+			std::swap(sphere, support);
+			normal = -normal;
+		}
+		if (!sphere->IsDynamic() || support->IsDynamic() || nullptr != sphere->GetSupport() ||
+			Geometry::SPHERE != sphere->GetGeometry().GetShape() ||
+			SUPPORT_SLOPE > glm::dot(normal, up) ||
+			SUPPORT_SPEED < fabs(glm::dot(sphere->GetVelocity(), normal)))
+			continue;
+		sphere->SetSupport(support, normal);
+	}
+}
+
+// so no sphere is left rolling on an actor that's been destroyed
+void Scene::ForgetSupport(const Actor* a_support)
+{
+	for (auto actor : m_actors)
+	{
+		if (actor->GetSupport() == a_support)
+			actor->ClearSupport();
+	}
+}
@@ -0,0 +1,172 @@
+#include "SelfCheck.h"
+#include "Scene.h"
+#include <cmath>
+#include <stdio.h>
+
+static bool Check(bool a_passed, const char* a_name)
+{
+	if (!a_passed)
+		printf("Self check failed: %s\n", a_name);
+	return a_passed;
+}
+
+static Scene::Proxy MakeProxy(const glm::vec3& a_min, const glm::vec3& a_max)
+{
+	Scene::Proxy proxy;
+	proxy.min = a_min;
+	proxy.max = a_max;
+	return proxy;
+}
+
+bool SelfCheck::Run()
+{
+	bool passed = true;
+	passed &= Broadphase();
+	passed &= SphereFilter();
+	passed &= FastMath();
+	return passed;
+}
+
+// both broadphases against each other on cases sweep and prune once got wrong
+bool SelfCheck::Broadphase()
+{
+	bool passed = true;
+
+	// a static proxy that starts inside the last dynamic one along the sweep
+	// axis is only reached after every dynamic proxy has been visited
+	std::vector<Scene::Proxy> dynamic, statics;
+	std::vector<Scene::Pair> pairs;
+	dynamic.push_back(MakeProxy(glm::vec3(0), glm::vec3(10, 1, 1)));
+	statics.push_back(MakeProxy(glm::vec3(5, 0, 0), glm::vec3(15, 1, 1)));
+	Scene::SweepAndPrune sweepAndPrune;
+	sweepAndPrune.FindPairs(dynamic, statics, pairs);
+	passed &= Check(1 == pairs.size(), "sweep and prune misses a static proxy past the last dynamic one");
+
+	// and several of them, past several dynamic proxies, along with one that
+	// doesn't touch anything
+	dynamic.push_back(MakeProxy(glm::vec3(2, 2, 0), glm::vec3(4, 3, 1)));
+	statics.push_back(MakeProxy(glm::vec3(8, 0, 0), glm::vec3(9, 1, 1)));
+	statics.push_back(MakeProxy(glm::vec3(11, 0, 0), glm::vec3(12, 1, 1)));
+	pairs.clear();
+	Scene::SweepAndPrune().FindPairs(dynamic, statics, pairs);
+	std::vector<Scene::Pair> gridPairs;
+	Scene::UniformGrid().FindPairs(dynamic, statics, gridPairs);
+	passed &= Check(2 == pairs.size() && pairs.size() == gridPairs.size(),
+					"sweep and prune and the uniform grid disagree");
+
+	return passed;
+}
+
+// lets the checks reach the scene's sphere arrays and pair filter
+struct SelfCheckScene : public Scene
+{
+	using Scene::m_spheres;
+	using Scene::m_pairs;
+	using Scene::FilterSpherePairs;
+};
+
+// The batched filter has to keep exactly the pairs the scalar detector finds,
+// including pairs that just touch.  Counts that aren't a multiple of the batch
+// size check the leftovers each batch passes on to the narrower ones.
+bool SelfCheck::SphereFilter()
+{
+	bool passed = true;
+	unsigned int seed = 12345;
+	auto random = [&seed](float a_min, float a_max)
+	{
+		seed = seed * 1664525 + 1013904223;
+		return a_min + (a_max - a_min) * (float)(seed >> 8) / (float)(1 << 24);
+	};
+	unsigned int counts[] = { 0, 1, 3, 4, 7, 8, 13, 64, 1003 };
+	for (auto count : counts)
+	{
+		// spheres in pairs, every third pair touching exactly or only just not
+		std::vector<Geometry::Sphere> spheres;
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			if (2 == i % 3)
+			{
+				// at x = 0, so the gap comes out exactly along x
+				glm::vec3 center(0, (float)i, 0);
+				float gap = (0 == i % 2 ? 2.0f : nextafterf(2.0f, 3.0f));
+				spheres.push_back(Geometry::Sphere(0.5f, center));
+				spheres.push_back(Geometry::Sphere(1.5f, center + glm::vec3(gap, 0, 0)));
+				continue;
+			}
+			spheres.push_back(Geometry::Sphere(random(0.25f, 1.25f),
+											   glm::vec3(random(0, 4), random(0, 4), random(0, 4))));
+			spheres.push_back(Geometry::Sphere(random(0.25f, 1.25f),
+											   glm::vec3(random(0, 4), random(0, 4), random(0, 4))));
+		}
+
+		SelfCheckScene scene;
+		std::vector<Scene::Pair> expected;
+		for (unsigned int i = 0; i < spheres.size(); ++i)
+			scene.m_spheres.Add(spheres[i]);
+		for (unsigned int i = 0; i < count; ++i)
+		{
+			Scene::Pair pair;
+			pair.sphere1 = 2 * i;
+			pair.sphere2 = 2 * i + 1;
+			scene.m_pairs.push_back(pair);
+			if (Geometry::DetectCollision(spheres[pair.sphere1], spheres[pair.sphere2]))
+				expected.push_back(pair);
+		}
+		scene.FilterSpherePairs();
+		bool same = (expected.size() == scene.m_pairs.size());
+		for (unsigned int i = 0; same && i < expected.size(); ++i)
+		{
+			same = (expected[i].sphere1 == scene.m_pairs[i].sphere1 &&
+					expected[i].sphere2 == scene.m_pairs[i].sphere2);
+		}
+		passed &= Check(same, "batched sphere filter disagrees with the sphere/sphere detector");
+	}
+	return passed;
+}
+
+// The fast paths have to stay within the error bounds Geometry gives for
+// them, checked against double precision over the ranges they're used on.
+bool SelfCheck::FastMath()
+{
+	bool passed = true;
+	bool fastMath = Geometry::IsFastMath();
+	Geometry::SetFastMath(true);
+
+	bool within = true;
+	for (double value = 1e-6; value < 1e6; value *= 1.1)
+	{
+		double exact = 1 / sqrt((double)(float)value);
+		within &= (fabs(Geometry::InverseSqrt((float)value) - exact) <= Geometry::ERR_RSQRT * exact);
+	}
+	passed &= Check(within, "fast inverse square root is outside its error bound");
+
+	within = true;
+	for (float angle = -1000; angle <= 1000; angle += 0.37f)
+	{
+		float sine, cosine;
+		Geometry::SinCos(angle, sine, cosine);
+		within &= (fabs(sine - sin((double)angle)) <= Geometry::ERR_SINCOS &&
+				   fabs(cosine - cos((double)angle)) <= Geometry::ERR_SINCOS);
+	}
+	passed &= Check(within, "fast sine and cosine are outside their error bound");
+
+	// small rotations about every axis, up to where the first order
+	// quaternion stops being used
+	within = true;
+	for (float angle = 0.0005f; angle < 0.02f; angle += 0.0005f)
+	{
+		glm::vec3 axes[] = { glm::vec3(1, 0, 0), glm::normalize(glm::vec3(1, 2, 3)),
+							 glm::normalize(glm::vec3(-3, 1, -1)) };
+		for (auto& axis : axes)
+		{
+			glm::quat rotation = Geometry::Rotation(axis * angle);
+			double turned = 2 * atan2((double)glm::length(glm::vec3(rotation.x, rotation.y, rotation.z)),
+									  (double)rotation.w);
+			within &= (fabs(turned - glm::length(axis * angle)) <= Geometry::ERR_SMALL);
+		}
+	}
+	passed &= Check(within, "fast small rotations are outside their error bound");
+
+	Geometry::SetFastMath(fastMath);
+	return passed;
+}
@@ -0,0 +1,15 @@
+#ifndef _SELF_CHECK_H_
+#define _SELF_CHECK_H_
+
+// Checks of the physics that are cheap enough to run every time a debug build
+// starts.  Each prints what failed and returns false if anything did.
+namespace SelfCheck
+{
+	bool Run();
+
+	bool Broadphase();
+	bool SphereFilter();
+	bool FastMath();
+}
+
+#endif	// _SELF_CHECK_H_
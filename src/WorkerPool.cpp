@@ -0,0 +1,93 @@
+#include "WorkerPool.h"
+
+void WorkerPool::SetThreadCount(unsigned int a_threadCount)
+{
+	if (0 == a_threadCount)
+		a_threadCount = std::thread::hardware_concurrency();
+	if (0 == a_threadCount)
+		a_threadCount = 1;
+	if (a_threadCount == GetThreadCount())
+		return;
+	Stop();
+	m_quit = false;
+	m_generation = 0;
+	m_busy = 0;
+	for (unsigned int i = 1; i < a_threadCount; ++i)
+		m_threads.push_back(std::thread(&WorkerPool::Work, this));
+}
+
+void WorkerPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_start.notify_all();
+	for (auto& thread : m_threads)
+		thread.join();
+	m_threads.clear();
+}
+
+void WorkerPool::ParallelFor(unsigned int a_count, unsigned int a_minChunk, const Job& a_job)
+{
+	if (0 == a_count)
+		return;
+
+	// not worth waking the workers for
+	if (m_threads.empty() || a_count <= a_minChunk)
+	{
+		a_job(0, a_count);
+		return;
+	}
+
+	// a few chunks per thread, so a slow chunk doesn't hold everyone up
+	unsigned int chunk = a_count / (GetThreadCount() * 4);
+	m_chunk = (chunk > a_minChunk ? chunk : (0 < a_minChunk ? a_minChunk : 1));
+	m_count = a_count;
+	m_next = 0;
+	m_job = &a_job;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_busy = m_threads.size();
+		++m_generation;
+	}
+	m_start.notify_all();
+	RunChunks();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finish.wait(lock, [this]() { return 0 == m_busy; });
+	m_job = nullptr;
+}
+
+void WorkerPool::RunChunks()
+{
+	for (;;)
+	{
+		unsigned int begin = m_next.fetch_add(m_chunk);
+		if (begin >= m_count)
+			return;
+		unsigned int end = (m_count - begin > m_chunk ? begin + m_chunk : m_count);
+		(*m_job)(begin, end);
+	}
+}
+
+void WorkerPool::Work()
+{
+	unsigned int generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_start.wait(lock, [&]() { return m_quit || generation != m_generation; });
+			if (m_quit)
+				return;
+			generation = m_generation;
+		}
+		RunChunks();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_busy;
+		}
+		m_finish.notify_one();
+	}
+}
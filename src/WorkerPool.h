@@ -0,0 +1,60 @@
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads that split a range of indices between them.  The
+// thread calling ParallelFor works on the range too, so a pool of one thread
+// starts no threads at all and just runs the job in place.
+class WorkerPool
+{
+public:
+
+	typedef std::function<void(unsigned int a_begin, unsigned int a_end)> Job;
+
+	WorkerPool(unsigned int a_threadCount = 1)
+		: m_generation(0), m_busy(0), m_quit(false), m_job(nullptr), m_count(0), m_chunk(1)
+	{
+		SetThreadCount(a_threadCount);
+	}
+	~WorkerPool() { Stop(); }
+
+	// zero means one thread per hardware thread
+	void SetThreadCount(unsigned int a_threadCount);
+	unsigned int GetThreadCount() const { return m_threads.size() + 1; }
+
+	// calls a_job on chunks of [0, a_count) of at least a_minChunk indices and
+	// returns once every chunk is done - which thread gets which chunk varies,
+	// so jobs should only write to the indices they are given
+	void ParallelFor(unsigned int a_count, unsigned int a_minChunk, const Job& a_job);
+
+private:
+
+	WorkerPool(const WorkerPool&);
+	WorkerPool& operator=(const WorkerPool&);
+
+	void Stop();
+	void Work();
+	void RunChunks();
+
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_start;
+	std::condition_variable m_finish;
+	unsigned int m_generation;
+	unsigned int m_busy;
+	bool m_quit;
+
+	// the job in progress
+	const Job* m_job;
+	unsigned int m_count;
+	unsigned int m_chunk;
+	std::atomic<unsigned int> m_next;
+};
+
+#endif	// _WORKER_POOL_H_
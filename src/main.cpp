@@ -1,9 +1,23 @@
 #include "PoolTable.h"
 #include "Engine.h"
+#include "Benchmark.h"
+#include "SelfCheck.h"
+#include <string.h>
 
 // main that controls the creation/destruction of an application
 int main(int argc, char* argv[])
 {
+#ifdef _DEBUG
+	SelfCheck::Run();
+#endif
+
+	// timings only, without the game
+	if (1 < argc && 0 == strcmp(argv[1], "-benchmark"))
+	{
+		Benchmark::Run();
+		return 0;
+	}
+
 	// create a poolTable
 	PoolTable* poolTable = new PoolTable();
 